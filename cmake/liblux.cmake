@@ -71,6 +71,7 @@ SET(lux_core_src
 	core/igiio.cpp
 	core/imagereader.cpp
 	core/light.cpp
+	core/loadprofiler.cpp
 	core/material.cpp
 	core/osfunc.cpp
 	core/paramset.cpp
@@ -82,8 +83,10 @@ SET(lux_core_src
 	core/renderinghints.cpp
 	core/sampling.cpp
 	core/scene.cpp
+	core/sceneparser.cpp
 	core/shape.cpp
 	core/texture.cpp
+	core/texturecache.cpp
 	core/tgaio.cpp
 	core/timer.cpp
 	core/tigerhash.cpp
@@ -91,6 +94,7 @@ SET(lux_core_src
 	core/util.cpp
 	core/volume.cpp
 	core/scheduler.cpp
+	server/filecache.cpp
 	server/renderserver.cpp
 	)
 SOURCE_GROUP("Source Files\\Core" FILES ${lux_core_src})
@@ -322,6 +326,7 @@ SET(lux_shapes_src
 	shapes/deferred.cpp
 	shapes/disk.cpp
 	shapes/hairfile.cpp
+	shapes/hairstrandsegment.cpp
 	shapes/heightfield.cpp
 	shapes/hyperboloid.cpp
 	shapes/lenscomponent.cpp
@@ -383,6 +388,7 @@ SOURCE_GROUP("Source Files\\Textures\\Fresnel" FILES ${lux_fresnel_textures_src}
 
 SET(lux_textures_src
 	textures/add.cpp
+	textures/bake.cpp
 	textures/band.cpp
 	textures/bilerp.cpp
 	textures/brick.cpp
@@ -493,6 +499,7 @@ SET(lux_core_hdr
 	core/imagereader.h
 	core/kdtree.h
 	core/light.h
+	core/loadprofiler.h
 	core/lux.h
 	core/material.h
 	core/mipmap.h
@@ -509,9 +516,11 @@ SET(lux_core_hdr
 	core/renderinghints.h
 	core/sampling.h
 	core/scene.h
+	core/sceneparser.h
 	core/shape.h
 	core/streamio.h
 	core/texture.h
+	core/texturecache.h
 	core/texturecolor.h
 	core/tgaio.h
 	core/timer.h
@@ -520,6 +529,7 @@ SET(lux_core_hdr
 	core/transport.h
 	core/version.h
 	core/volume.h
+	server/filecache.h
 	server/renderserver.h
 	)
 SOURCE_GROUP("Header Files\\Core" FILES ${lux_core_hdr})
@@ -747,6 +757,7 @@ SET(lux_shapes_hdr
 	)
 SOURCE_GROUP("Header Files\\Shapes" FILES ${lux_shapes_hdr})
 SET(lux_textures_hdr
+	textures/bake.h
 	textures/band.h
 	textures/bilerp.h
 	textures/brick.h
@@ -76,11 +76,15 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 					("minepsilon,e",     po::value< float >()->default_value(-1.f), "Set minimum epsilon")
 					("maxepsilon,E",     po::value< float >()->default_value(-1.f), "Set maximum epsilon")
 					("list-file,L",      po::value< std::vector< std::string > >(), "Specify queue list files")
+					("fastparser",       "Use the multithreaded parser for scene files")
 					;
 
 			if (!(features & featureSet::INTERACTIVE))
 				optStandalone.add_options()
 					("bindump,b",        "Dump binary RGB framebuffer to stdout when finished")
+					("loadreport",       po::value< std::string >(), "Append a JSON profile of each scene load to the given file")
+					("animation",        "Keep unchanged meshes between the scenes of the queue")
+					("sharemeshes",      "Store identical meshes once and instance them")
 					;
 		}
 
@@ -105,7 +109,9 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 					("server,s",         "Run as a slave node")
 					("serverport,p",     po::value < unsigned int >()->default_value(config.tcpPort), "Specify the tcp port to listen on")
 					("serverwriteflm,W", "Write film to disk before transmitting")
+					("serverqueue,Q",    po::value < unsigned int >()->default_value(0), "Number of sessions to queue while busy, their files upload during the current rendering")
 					("cachedir,c",       po::value< std::string >()->default_value((getDefaultWorkingDirectory() / "cache").string()), "Specify the cache directory to use")
+					("cachesize",        po::value < unsigned int >()->default_value(0), "Maximum size in Mbytes of the cache directory, least recently used files are removed first (0 = unlimited)")
 					;
 		}
 
@@ -125,6 +131,9 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 		if (features & featureSet::RENDERER)
 			optConfig.add_options()
 				("threads,t",     po::value< unsigned int >(), "Specify the number of threads to run in parallel")
+				("texturecache",  po::value< unsigned int >(), "Memory budget in Mbytes for image maps, larger maps are paged in tiles from disk")
+				("texturecachedir", po::value< std::string >(), "Directory where the mipmaps built from image maps are kept for later renders")
+				("texturecompression", po::value< unsigned int >(), "Size in Mbytes from which float image maps are stored compressed in memory")
 				;
 
 		if (features & (featureSet::MASTERNODE | featureSet::SLAVENODE))
@@ -245,6 +254,21 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 			config.threadCount = std::max<unsigned int>(1, boost::thread::hardware_concurrency());
 		LOG(LUX_INFO,LUX_NOERROR) << "Threads: " << config.threadCount;
 
+		if (vm.count("texturecache")) {
+			luxSetIntAttribute("texture_cache", "budget", vm["texturecache"].as<unsigned int>());
+			LOG(LUX_INFO,LUX_NOERROR) << "Texture cache: " << vm["texturecache"].as<unsigned int>() << " Mbytes";
+		}
+
+		if (vm.count("texturecachedir")) {
+			luxSetStringAttribute("texture_cache", "directory", vm["texturecachedir"].as<std::string>().c_str());
+			LOG(LUX_INFO,LUX_NOERROR) << "Texture cache directory: " << vm["texturecachedir"].as<std::string>();
+		}
+
+		if (vm.count("texturecompression")) {
+			luxSetIntAttribute("texture_cache", "compression", vm["texturecompression"].as<unsigned int>());
+			LOG(LUX_INFO,LUX_NOERROR) << "Texture compression: " << vm["texturecompression"].as<unsigned int>() << " Mbytes";
+		}
+
 		config.password = vm["password"].as<std::string>();
 
 		// BEGIN Handling standalone and standalone / master node options
@@ -275,6 +299,9 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 			// Any call to Lux API must be done _after_ luxAddServer
 			luxSetEpsilon(vm["minepsilon"].as<float>(), vm["maxepsilon"].as<float>());
 
+			if (vm.count("fastparser"))
+				luxSetFastParser(true);
+
 			if (vm.count("resume"))
 				luxOverrideResumeFLM("");
 
@@ -334,6 +361,17 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 
 			if (vm.count("bindump"))
 				config.binDump = true;
+
+			if (vm.count("animation"))
+				luxSetAnimationMode(true);
+			if (vm.count("sharemeshes"))
+				luxSetMeshSharing(true);
+
+			// The working directory changes with each scene in the queue
+			if (vm.count("loadreport")) {
+				luxSetLoadProfiling(true);
+				config.loadReportFile = boost::filesystem::system_complete(vm["loadreport"].as<std::string>()).string();
+			}
 		// END Handling standalone and standalone / master node options
 
 		// BEGIN Handling slave node options
@@ -349,6 +387,8 @@ bool ProcessCommandLine(int argc, char **argv, clConfig& config, unsigned int fe
 
 			config.tcpPort = vm["serverport"].as<unsigned int>();
 			config.writeFlmFile = vm.count("serverwriteflm") != 0;
+			config.queueSize = vm["serverqueue"].as<unsigned int>();
+			config.cacheSize = vm["cachesize"].as<unsigned int>();
 
 			std::string cachedir = vm["cachedir"].as<std::string>();
 			boost::filesystem::path cachePath(cachedir);
@@ -40,7 +40,8 @@ struct clConfig
 	clConfig() :
 		slave(false), binDump(false), log2console(false), writeFlmFile(false),
 		verbosity(0), pollInterval(luxGetIntAttribute("render_farm", "pollingInterval")),
-		tcpPort(luxGetIntAttribute("render_farm", "defaultTcpPort")), threadCount(0) {};
+		tcpPort(luxGetIntAttribute("render_farm", "defaultTcpPort")), threadCount(0),
+		queueSize(0), cacheSize(0) {};
 
 	boost::program_options::variables_map vm;
 
@@ -53,8 +54,11 @@ struct clConfig
 	unsigned int pollInterval;
 	unsigned int tcpPort;
 	unsigned int threadCount;
+	unsigned int queueSize;
+	unsigned int cacheSize;
 	std::string password;
 	std::string cacheDir;
+	std::string loadReportFile;
 	std::vector< std::string > queueFiles;
 	std::vector< std::string > inputFiles;
 	std::vector< std::string > slaveNodeList;
@@ -22,6 +22,7 @@
 
 #include <exception>
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -161,6 +162,17 @@ int main(int argc, char **argv) {
 				continue;
 			}
 
+			if (!config.loadReportFile.empty()) {
+				// One JSON object per line, one line per scene
+				std::vector<char> report(1 << 20, '\0');
+				luxGetStringAttribute("load_profiler", "report", &report[0], static_cast<unsigned int>(report.size()));
+				std::ofstream reportFile(config.loadReportFile.c_str(), std::ios::out | std::ios::app);
+				if (reportFile)
+					reportFile << &report[0] << std::endl;
+				else
+					LOG(LUX_ERROR,LUX_NOFILE) << "Unable to write load report to '" << config.loadReportFile << "'";
+			}
+
 			// add rendering threads
 			int threadsToAdd = config.threadCount;
 			while (--threadsToAdd)
@@ -206,7 +218,7 @@ int main(int argc, char **argv) {
 			luxCleanup();
 		}
 	} else {
-		renderServer = new RenderServer(config.threadCount, config.password, config.tcpPort, config.writeFlmFile);
+		renderServer = new RenderServer(config.threadCount, config.password, config.tcpPort, config.writeFlmFile, config.queueSize, config.cacheSize);
 
 		prevErrorHandler = luxError;
 		luxErrorHandler(serverErrorHandler);
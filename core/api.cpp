@@ -24,7 +24,9 @@
 
 #include "api.h"
 #include "context.h"
+#include "loadprofiler.h"
 #include "paramset.h"
+#include "sceneparser.h"
 #include "error.h"
 #include "version.h"
 #include "osfunc.h"
@@ -484,6 +486,12 @@ extern "C" void luxWorldEnd() {
 extern "C" void luxParseEnd() {
 	Context::GetActive()->ParseEnd();
 }
+extern "C" void luxEditBegin() {
+	Context::GetActive()->EditBegin();
+}
+extern "C" void luxEditEnd() {
+	Context::GetActive()->EditEnd();
+}
 extern "C" const char *luxVersion()
 {
 	static const char version[] = LUX_VERSION_STRING;
@@ -527,8 +535,23 @@ extern "C" void luxInit()
 	lux::fpdebug::enable();
 }
 
+static bool useFastParser = false;
+
 bool parseFile(const char *filename) {
 	//TODO jromang - add thread lock here (we can only parse in one context)
+	if (Context::GetActiveLoadProfiler())
+		Context::GetActiveLoadProfiler()->BeginScene(filename);
+	// The fast parser needs a regular file to map
+	if (useFastParser && strcmp(filename, "-") != 0) {
+		bool parse_success = false;
+		try {
+			parse_success = ParseSceneFile(filename);
+		} catch (std::runtime_error& e) {
+			LOG(LUX_SEVERE, LUX_SYSTEM) << "Exception during parsing (file '" << filename << "'): " << e.what();
+		}
+		return parse_success;
+	}
+
 	extern FILE *yyin;
 	extern int yyparse(void);
 	extern void yyrestart( FILE *new_file );
@@ -600,6 +623,10 @@ void luxStartRenderingAfterParse(const bool start) {
 	Context::GetActive()->StartRenderingAfterParse(start);
 }
 
+void luxSetFastParser(const bool enable) {
+	useFastParser = enable;
+}
+
 // Load/save FLM file
 extern "C" void luxLoadFLM(const char* name)
 {
@@ -1165,6 +1192,26 @@ extern "C" void luxDisableRandomMode()
 	Context::GetActive()->DisableRandomMode();
 }
 
+extern "C" void luxSetAnimationMode(const bool enable)
+{
+	Context::GetActive()->SetAnimationMode(enable);
+}
+
+extern "C" void luxSetMeshSharing(const bool enable)
+{
+	Context::GetActive()->SetMeshSharing(enable);
+}
+
+extern "C" void luxSetSceneEditing(const bool enable)
+{
+	Context::GetActive()->SetSceneEditing(enable);
+}
+
+extern "C" void luxSetLoadProfiling(const bool enable)
+{
+	Context::GetActive()->SetLoadProfiling(enable);
+}
+
 extern "C" void luxUpdateFilmFromNetwork()
 {
 	Context::GetActive()->UpdateFilmFromNetwork();
@@ -59,6 +59,8 @@ LUX_EXPORT int luxParsePartial(const char *filename);
 LUX_EXPORT void luxStartRenderingAfterParse(const bool start);
 // Used to end the parse phase with luxStartRenderingAfterParse(false);
 LUX_EXPORT void luxParseEnd();
+/* Use the memory mapped, multithreaded parser for scene files (default is false) */
+LUX_EXPORT void luxSetFastParser(const bool enable);
 LUX_EXPORT void luxCleanup();
 LUX_EXPORT void resetFlm();
 
@@ -124,6 +126,12 @@ LUX_EXPORT void luxObjectInstance(const char *name);
 LUX_EXPORT void luxPortalInstance(const char *name);
 LUX_EXPORT void luxMotionInstance(const char *name, float startTime, float endTime, const char *toTransform);
 LUX_EXPORT void luxWorldEnd();
+/* Edit the scene while it is being rendered, the scene description calls
+ * made between luxEditBegin() and luxEditEnd() replace the camera, named
+ * materials and textures, or move object instances, the materials and
+ * textures using an edited texture are recreated, see luxSetSceneEditing() */
+LUX_EXPORT void luxEditBegin();
+LUX_EXPORT void luxEditEnd();
 
 /* Load/Save FLM file */
 LUX_EXPORT void luxLoadFLM(const char* name);
@@ -343,6 +351,19 @@ LUX_EXPORT void luxUpdateStatisticsWindow();
 // Dade - enable debug mode
 LUX_EXPORT void luxEnableDebugMode();
 LUX_EXPORT void luxDisableRandomMode();
+/* Keep unchanged meshes and their accelerators from one scene to the next,
+ * for rendering the frames of an animation in sequence (default is false) */
+LUX_EXPORT void luxSetAnimationMode(const bool enable);
+/* Store identical meshes declared several times once, the copies becoming
+ * instances of it, at the cost of hashing every mesh (default is false) */
+LUX_EXPORT void luxSetMeshSharing(const bool enable);
+/* Keep the texture and material descriptions needed to recreate them
+ * in scene edits, must be enabled before loading a scene to be edited
+ * with luxEditBegin() (default is false) */
+LUX_EXPORT void luxSetSceneEditing(const bool enable);
+/* Profile the time and memory of each scene load phase, the profile is
+ * available as the attributes of "load_profiler" (default is false) */
+LUX_EXPORT void luxSetLoadProfiling(const bool enable);
 
 /* Error Handlers */
 LUX_EXPORT extern int luxLastError; /*  Keeps track of the last error code */
@@ -194,3 +194,13 @@ SceneCamera::~SceneCamera()
 	delete camera->film;
 	delete camera;
 }
+
+void SceneCamera::SetCamera(Camera *cam)
+{
+	if (cam->film != camera->film)
+		delete camera->film;
+	delete camera;
+	camera = cam;
+	// Attributes with the same names are replaced
+	camera->AddAttributes(this);
+}
@@ -269,6 +269,8 @@ public:
 	SceneCamera(Camera *cam);
 	~SceneCamera();
 	Camera *operator()() const { return camera; }
+	// Replaces the camera, keeping the film of the previous one
+	void SetCamera(Camera *cam);
 
 private:
 	Camera *camera;
@@ -34,7 +34,10 @@
 #include "volume.h"
 #include "material.h"
 #include "renderfarm.h"
+#include "loadprofiler.h"
+#include "texturecache.h"
 #include "film/fleximage.h"
+#include "textures/imagemap.h"
 #include "luxrays/core/epsilon.h"
 using luxrays::MachineEpsilon;
 #include "renderers/samplerrenderer.h"
@@ -44,6 +47,7 @@ using luxrays::MachineEpsilon;
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/filesystem.hpp>
+#include <set>
 
 using namespace boost::iostreams;
 using namespace lux;
@@ -80,12 +84,47 @@ if (inMotionBlock) { \
 	return; \
 }
 
+#define VERIFY_NOT_EDITING(func) \
+if (sceneEdit) { \
+	LOG(LUX_ERROR,LUX_ILLSTATE)<<"'"<<func<<"' not allowed inside scene edit. Ignoring."; \
+	return; \
+}
+
+// Shapes whose geometry is fully described by their parameters
+static bool IsSharableMesh(const string &n)
+{
+	return n == "trianglemesh" || n == "mesh" ||
+		n == "waldtrianglemesh" || n == "barytrianglemesh" ||
+		n == "loopsubdiv";
+}
+
+// Identifies the content of the file of a PLY mesh without reading it
+static string PlyFileStamp(const ParamSet &params)
+{
+	const string filename(AdjustFilename(params.FindOneString("filename",
+		"none"), true));
+	std::stringstream ss;
+	ss << "@" << filename;
+	try {
+		boost::filesystem::path path(boost::filesystem::system_complete(filename));
+		ss << "@" << path.string() << "@" <<
+			boost::filesystem::last_write_time(path) << "@" <<
+			boost::filesystem::file_size(path);
+	} catch (boost::filesystem::filesystem_error &) {
+		// The shape will report the missing file
+	}
+	return ss.str();
+}
+
 boost::shared_ptr<lux::Texture<float> > lux::Context::GetFloatTexture(const string &n) const
 {
 	if (n != "") {
 		if (graphicsState->floatTextures.find(n) !=
-			graphicsState->floatTextures.end())
+			graphicsState->floatTextures.end()) {
+			if (graphicsState->floatTextures[n])
+				graphicsState->floatTextures[n]->Resolve();
 			return graphicsState->floatTextures[n];
+		}
 		LOG(LUX_ERROR,LUX_BADTOKEN) << "Couldn't find float texture named '" << n << "'";
 	}
 	return boost::shared_ptr<lux::Texture<float> >();
@@ -94,8 +133,11 @@ boost::shared_ptr<lux::Texture<SWCSpectrum> > lux::Context::GetColorTexture(cons
 {
 	if (n != "") {
 		if (graphicsState->colorTextures.find(n) !=
-			graphicsState->colorTextures.end())
+			graphicsState->colorTextures.end()) {
+			if (graphicsState->colorTextures[n])
+				graphicsState->colorTextures[n]->Resolve();
 			return graphicsState->colorTextures[n];
+		}
 		LOG(LUX_ERROR,LUX_BADTOKEN) << "Couldn't find color texture named '" << n << "'";
 	}
 	return boost::shared_ptr<lux::Texture<SWCSpectrum> >();
@@ -104,8 +146,11 @@ boost::shared_ptr<lux::Texture<FresnelGeneral> > lux::Context::GetFresnelTexture
 {
 	if (n != "") {
 		if (graphicsState->fresnelTextures.find(n) !=
-			graphicsState->fresnelTextures.end())
+			graphicsState->fresnelTextures.end()) {
+			if (graphicsState->fresnelTextures[n])
+				graphicsState->fresnelTextures[n]->Resolve();
 			return graphicsState->fresnelTextures[n];
+		}
 		LOG(LUX_ERROR,LUX_BADTOKEN) << "Couldn't find fresnel texture named '" << n << "'";
 	}
 	return boost::shared_ptr<lux::Texture<FresnelGeneral> >();
@@ -137,8 +182,15 @@ void lux::Context::Init() {
 	pushedGraphicsStates.clear();
 	pushedTransforms.clear();
 	renderFarm = new RenderFarm(this);
+	loadProfiler = loadProfiling ? new LoadProfiler() : NULL;
+	textureCache.reset(new TextureCache());
 	filmOverrideParams = NULL;
+	sceneEdit = NULL;
 	shapeNo = 0;
+	if (animationMode)
+		++animationFrame;
+	meshCacheHits = 0;
+	meshCacheMisses = 0;
 }
 
 void lux::Context::ResetFLM()
@@ -165,8 +217,16 @@ void lux::Context::Free() {
 	delete renderFarm;
 	renderFarm = NULL;
 
+	delete loadProfiler;
+	loadProfiler = NULL;
+
+	textureCache.reset();
+
 	delete filmOverrideParams;
 	filmOverrideParams = NULL;
+
+	delete sceneEdit;
+	sceneEdit = NULL;
 }
 
 // API Function Definitions
@@ -339,6 +399,37 @@ void lux::Context::DisableRandomMode() {
     renderOptions->randomMode = false;
 }
 
+void lux::Context::SetAnimationMode(const bool enable) {
+	VERIFY_OPTIONS("SetAnimationMode");
+	animationMode = enable;
+	if (!animationMode) {
+		meshCache.clear();
+		mipmapCache.clear();
+		ImageTexture::ReleaseUnused();
+	}
+}
+
+void lux::Context::SetMeshSharing(const bool enable) {
+	VERIFY_OPTIONS("SetMeshSharing");
+	meshSharing = enable;
+}
+
+void lux::Context::SetSceneEditing(const bool enable) {
+	VERIFY_OPTIONS("SetSceneEditing");
+	sceneEditing = enable;
+}
+
+void lux::Context::SetLoadProfiling(const bool enable) {
+	VERIFY_OPTIONS("SetLoadProfiling");
+	loadProfiling = enable;
+	if (loadProfiling && !loadProfiler)
+		loadProfiler = new LoadProfiler();
+	else if (!loadProfiling) {
+		delete loadProfiler;
+		loadProfiler = NULL;
+	}
+}
+
 void lux::Context::PixelFilter(const string &n, const ParamSet &params) {
 	VERIFY_OPTIONS("PixelFilter");
 	renderFarm->send("luxPixelFilter", n, params);
@@ -379,8 +470,13 @@ void lux::Context::VolumeIntegrator(const string &n, const ParamSet &params) {
 	renderOptions->volIntegratorParams = params;
 }
 void lux::Context::Camera(const string &n, const ParamSet &params) {
-	VERIFY_OPTIONS("Camera");
-	renderFarm->send("luxCamera", n, params);
+	if (sceneEdit) {
+		// The camera is rebuilt by EditEnd()
+		sceneEdit->camera = true;
+	} else {
+		VERIFY_OPTIONS("Camera");
+		renderFarm->send("luxCamera", n, params);
+	}
 	renderOptions->cameraName = n;
 	renderOptions->cameraParams = params;
 
@@ -418,6 +514,10 @@ void lux::Context::WorldBegin() {
 	curTransform = lux::Transform();
 	namedCoordinateSystems["world"] = curTransform;
 	shapeNo = 0;
+	// LuxCore copies whole image maps
+	if (renderOptions->rendererName == "luxcore" ||
+		renderOptions->rendererName == "slg")
+		textureCache->Disable();
 }
 void lux::Context::AttributeBegin() {
 	VERIFY_WORLD("AttributeBegin");
@@ -476,48 +576,86 @@ void lux::Context::MotionEnd() {
 	}
 	curTransform = curTransform * motionTransform;
 }
+// Returns the object named n in objects, NULL if there is none
+template <class T> static boost::shared_ptr<T> FindNamed(
+	const map<string, boost::shared_ptr<T> > &objects, const string &n)
+{
+	typename map<string, boost::shared_ptr<T> >::const_iterator o(objects.find(n));
+	return o != objects.end() ? o->second : boost::shared_ptr<T>();
+}
+
 void lux::Context::Texture(const string &n, const string &type,
 	const string &texname, const ParamSet &params) {
 	VERIFY_WORLD("Texture");
 	renderFarm->send("luxTexture", n, type, texname, params);
+	Replacements replaced;
 	if (type == "float") {
 		// Create _float_ texture and store in _floatTextures_
-		if (graphicsState->floatTextures.find(n) !=
-			graphicsState->floatTextures.end()) {
+		boost::shared_ptr<lux::Texture<float> > old(
+			FindNamed(graphicsState->floatTextures, n));
+		if (!sceneEdit && old) {
 			LOG(LUX_WARNING,LUX_SYNTAX) << "Float texture '" << n << "' being redefined.";
 		}
 		boost::shared_ptr<lux::Texture<float> > ft(
 			MakeFloatTexture(texname, curTransform.StaticTransform(), params));
-		if (ft)
+		if (ft) {
+			if (sceneEditing)
+				Define(RenderOptions::Definition::FLOAT_TEXTURE, n,
+					texname, params, old.get()).floatTexture = ft;
 			graphicsState->floatTextures[n] = ft;
+			if (old)
+				replaced.floatTextures[old] = ft;
+		}
 	} else if (type == "color") {
 		// Create _color_ texture and store in _colorTextures_
-		if (graphicsState->colorTextures.find(n) !=
-			graphicsState->colorTextures.end()) {
+		boost::shared_ptr<lux::Texture<SWCSpectrum> > old(
+			FindNamed(graphicsState->colorTextures, n));
+		if (!sceneEdit && old) {
 			LOG(LUX_WARNING,LUX_SYNTAX) << "Color texture '" << n << "' being redefined.";
 		}
 		boost::shared_ptr<lux::Texture<SWCSpectrum> > st(
 			MakeSWCSpectrumTexture(texname, curTransform.StaticTransform(), params));
-		if (st)
+		if (st) {
+			if (sceneEditing)
+				Define(RenderOptions::Definition::COLOR_TEXTURE, n,
+					texname, params, old.get()).colorTexture = st;
 			graphicsState->colorTextures[n] = st;
+			if (old)
+				replaced.colorTextures[old] = st;
+		}
 	} else if (type == "fresnel") {
 		// Create _fresnel_ texture and store in _fresnelTextures_
-		if (graphicsState->fresnelTextures.find(n) !=
-			graphicsState->fresnelTextures.end()) {
+		boost::shared_ptr<lux::Texture<FresnelGeneral> > old(
+			FindNamed(graphicsState->fresnelTextures, n));
+		if (!sceneEdit && old) {
 			LOG(LUX_WARNING,LUX_SYNTAX) << "Fresnel texture '" << n << "' being redefined.";
 		}
 		boost::shared_ptr<lux::Texture<FresnelGeneral> > fr(
 			MakeFresnelTexture(texname, curTransform.StaticTransform(), params));
-		if (fr)
+		if (fr) {
+			if (sceneEditing)
+				Define(RenderOptions::Definition::FRESNEL_TEXTURE, n,
+					texname, params, old.get()).fresnelTexture = fr;
 			graphicsState->fresnelTextures[n] = fr;
+			if (old)
+				replaced.fresnelTextures[old] = fr;
+		}
 	} else {
 		LOG(LUX_ERROR,LUX_SYNTAX) << "Texture type '" << type << "' unknown";
+		return;
 	}
+	// Materials and textures hold their textures, recreate the ones
+	// depending on the edited texture to use the new one
+	if (sceneEdit)
+		RebuildDependents(replaced);
 }
 void lux::Context::Material(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("Material");
 	renderFarm->send("luxMaterial", n, params);
 	graphicsState->material = MakeMaterial(n, curTransform.StaticTransform(), params);
+	if (sceneEditing && !sceneEdit && graphicsState->material)
+		Define(RenderOptions::Definition::MATERIAL, "", n, params,
+			NULL).material = graphicsState->material;
 }
 
 void lux::Context::MakeNamedMaterial(const string &n, const ParamSet &_params)
@@ -525,14 +663,171 @@ void lux::Context::MakeNamedMaterial(const string &n, const ParamSet &_params)
 	VERIFY_WORLD("MakeNamedMaterial");
 	ParamSet params=_params;
 	renderFarm->send("luxMakeNamedMaterial", n, params);
-	if (graphicsState->namedMaterials.find(n) !=
-		graphicsState->namedMaterials.end()) {
+	boost::shared_ptr<lux::Material> old(
+		FindNamed(graphicsState->namedMaterials, n));
+	if (!sceneEdit && old) {
 		LOG(LUX_WARNING,LUX_SYNTAX) << "Named material '" << n << "' being redefined.";
 	}
 	string type = params.FindOneString("type", "matte");
 	params.EraseString("type");
-	graphicsState->namedMaterials[n] = MakeMaterial(type, curTransform.StaticTransform(),
-		params);
+	boost::shared_ptr<lux::Material> m(MakeMaterial(type,
+		curTransform.StaticTransform(), params));
+	if (m && sceneEditing)
+		Define(RenderOptions::Definition::NAMED_MATERIAL, n, type, params,
+			old.get()).material = m;
+	graphicsState->namedMaterials[n] = m;
+	if (sceneEdit && old && m) {
+		sceneEdit->materials.push_back(std::make_pair(old, m));
+		// Materials mixing the edited one are recreated too
+		Replacements replaced;
+		replaced.materials[old] = m;
+		RebuildDependents(replaced);
+	}
+}
+
+// Copies the objects of current named in names to declared
+template <class T> static void Snapshot(map<string, T> &declared,
+	const map<string, T> &current, const vector<string> &names)
+{
+	for (u_int i = 0; i < names.size(); ++i) {
+		typename map<string, T>::const_iterator c(current.find(names[i]));
+		if (c != current.end())
+			declared[c->first] = c->second;
+	}
+}
+
+lux::Context::RenderOptions::Definition &lux::Context::Define(
+	RenderOptions::Definition::Kind kind, const string &n,
+	const string &type, const ParamSet &params, const void *replaced)
+{
+	std::list<RenderOptions::Definition> &defs(renderOptions->definitions);
+	std::list<RenderOptions::Definition>::iterator def(defs.end());
+	if (sceneEdit && replaced) {
+		for (def = defs.begin(); def != defs.end(); ++def) {
+			if (def->floatTexture.get() == replaced ||
+				def->colorTexture.get() == replaced ||
+				def->fresnelTexture.get() == replaced ||
+				def->material.get() == replaced)
+				break;
+		}
+	}
+	// Keep the declaration order so that the dependents of the
+	// replaced object still come after it
+	if (def == defs.end())
+		def = defs.insert(defs.end(), RenderOptions::Definition());
+	else
+		*def = RenderOptions::Definition();
+	def->kind = kind;
+	def->name = n;
+	def->type = type;
+	def->transform = curTransform.StaticTransform();
+	def->params = params;
+	const vector<string> textureNames(params.GetTextureNames());
+	Snapshot(def->floatTextures, graphicsState->floatTextures, textureNames);
+	Snapshot(def->colorTextures, graphicsState->colorTextures, textureNames);
+	Snapshot(def->fresnelTextures, graphicsState->fresnelTextures, textureNames);
+	Snapshot(def->namedMaterials, graphicsState->namedMaterials,
+		params.GetStringValues());
+	return *def;
+}
+
+// Substitutes the replaced objects in declared,
+// returns true if any of them was referenced
+template <class T> static bool Substitute(
+	map<string, boost::shared_ptr<T> > &declared,
+	const map<boost::shared_ptr<T>, boost::shared_ptr<T> > &replaced)
+{
+	bool uses = false;
+	for (typename map<string, boost::shared_ptr<T> >::iterator d = declared.begin();
+		d != declared.end(); ++d) {
+		typename map<boost::shared_ptr<T>, boost::shared_ptr<T> >::const_iterator r(
+			replaced.find(d->second));
+		if (r != replaced.end()) {
+			d->second = r->second;
+			uses = true;
+		}
+	}
+	return uses;
+}
+
+// Replaces the object of a definition by its recreation, in the current
+// named objects too unless the name has been redefined since
+template <class T> static void Rebind(boost::shared_ptr<T> &object,
+	const boost::shared_ptr<T> &rebuilt, const string &n,
+	map<string, boost::shared_ptr<T> > &current,
+	map<boost::shared_ptr<T>, boost::shared_ptr<T> > &replaced)
+{
+	typename map<string, boost::shared_ptr<T> >::iterator c(current.find(n));
+	if (c != current.end() && c->second == object)
+		c->second = rebuilt;
+	replaced[object] = rebuilt;
+	object = rebuilt;
+}
+
+void lux::Context::RebuildDependents(Replacements &replaced)
+{
+	// Declaration order ensures that the objects depending on a
+	// recreated one come after it and get the new one
+	std::list<RenderOptions::Definition> &defs(renderOptions->definitions);
+	for (std::list<RenderOptions::Definition>::iterator def = defs.begin();
+		def != defs.end(); ++def) {
+		// No short circuit, all the references have to be substituted
+		bool uses = Substitute(def->floatTextures, replaced.floatTextures);
+		uses = Substitute(def->colorTextures, replaced.colorTextures) || uses;
+		uses = Substitute(def->fresnelTextures, replaced.fresnelTextures) || uses;
+		uses = Substitute(def->namedMaterials, replaced.materials) || uses;
+		if (!uses)
+			continue;
+
+		// Look the references up as they were when the object was
+		// declared, with the replacements
+		GraphicsState declared;
+		declared.floatTextures = def->floatTextures;
+		declared.colorTextures = def->colorTextures;
+		declared.fresnelTextures = def->fresnelTextures;
+		declared.namedMaterials = def->namedMaterials;
+		GraphicsState *current = graphicsState;
+		graphicsState = &declared;
+		boost::shared_ptr<lux::Texture<float> > ft;
+		boost::shared_ptr<lux::Texture<SWCSpectrum> > st;
+		boost::shared_ptr<lux::Texture<FresnelGeneral> > fr;
+		boost::shared_ptr<lux::Material> m;
+		switch (def->kind) {
+			case RenderOptions::Definition::FLOAT_TEXTURE:
+				ft = MakeFloatTexture(def->type, def->transform,
+					def->params);
+				break;
+			case RenderOptions::Definition::COLOR_TEXTURE:
+				st = MakeSWCSpectrumTexture(def->type, def->transform,
+					def->params);
+				break;
+			case RenderOptions::Definition::FRESNEL_TEXTURE:
+				fr = MakeFresnelTexture(def->type, def->transform,
+					def->params);
+				break;
+			case RenderOptions::Definition::NAMED_MATERIAL:
+			case RenderOptions::Definition::MATERIAL:
+				m = MakeMaterial(def->type, def->transform,
+					def->params);
+				break;
+		}
+		graphicsState = current;
+
+		if (ft)
+			Rebind(def->floatTexture, ft, def->name,
+				graphicsState->floatTextures, replaced.floatTextures);
+		if (st)
+			Rebind(def->colorTexture, st, def->name,
+				graphicsState->colorTextures, replaced.colorTextures);
+		if (fr)
+			Rebind(def->fresnelTexture, fr, def->name,
+				graphicsState->fresnelTextures, replaced.fresnelTextures);
+		if (m) {
+			sceneEdit->materials.push_back(std::make_pair(def->material, m));
+			Rebind(def->material, m, def->name,
+				graphicsState->namedMaterials, replaced.materials);
+		}
+	}
 }
 
 void lux::Context::MakeNamedVolume(const string &id, const string &name,
@@ -579,6 +874,7 @@ void lux::Context::LightGroup(const string &n, const ParamSet &params)
 
 void lux::Context::LightSource(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("LightSource");
+	VERIFY_NOT_EDITING("LightSource");
 	renderFarm->send("luxLightSource", n, params);
 	u_int lg = GetLightGroup();
 
@@ -690,6 +986,7 @@ void lux::Context::LightSource(const string &n, const ParamSet &params) {
 
 void lux::Context::AreaLightSource(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("AreaLightSource");
+	VERIFY_NOT_EDITING("AreaLightSource");
 	renderFarm->send("luxAreaLightSource", n, params);
 	graphicsState->areaLight = n;
 	graphicsState->areaLightParams = params;
@@ -697,6 +994,7 @@ void lux::Context::AreaLightSource(const string &n, const ParamSet &params) {
 
 void lux::Context::PortalShape(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("PortalShape");
+	VERIFY_NOT_EDITING("PortalShape");
 	renderFarm->send("luxPortalShape", n, params);
 	boost::shared_ptr<Primitive> sh(MakeShape(n, curTransform.StaticTransform(),
 		graphicsState->reverseOrientation, params));
@@ -715,6 +1013,7 @@ void lux::Context::PortalShape(const string &n, const ParamSet &params) {
 
 void lux::Context::Shape(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("Shape");
+	VERIFY_NOT_EDITING("Shape");
 	renderFarm->send("luxShape", n, params);
 	const u_int sIdx = shapeNo++;
 	u_int nItems;
@@ -729,6 +1028,47 @@ void lux::Context::Shape(const string &n, const ParamSet &params) {
 		const string sname = "'" + *sn + "'";
 		const_cast<ParamSet &>(params).AddString("name", &sname);
 	}
+	// With mesh sharing, identical meshes outside of object blocks
+	// are stored once, the duplicates become instances of the first
+	// declaration. In animation mode the meshes are kept for the next
+	// scenes too, including PLY meshes which are told apart by their
+	// file stamp. Both hash the whole mesh data, so they are opt-in
+	string meshKey;
+	size_t meshBytes = 0;
+	if (((meshSharing && IsSharableMesh(n)) || (animationMode &&
+		(IsSharableMesh(n) || n == "plymesh"))) &&
+		!renderOptions->currentInstanceRefined &&
+		graphicsState->areaLight == "" && curTransform.IsStatic() &&
+		params.FindTexture("displacementmap") == "") {
+		const lux::Transform &objectToWorld(curTransform.StaticTransform());
+		meshKey = n + (graphicsState->reverseOrientation ? "-" : "+") +
+			(objectToWorld.SwapsHandedness() ? "-" : "+") +
+			params.Digest("name", &meshBytes);
+		if (animationMode) {
+			if (n == "plymesh")
+				meshKey += PlyFileStamp(params);
+			if (InstanceCachedMesh(n, params,
+				renderOptions->acceleratorName + "/" + meshKey))
+				return;
+			meshKey = "";
+		} else {
+			// Instances only override non NULL volumes, so the
+			// duplicates must have the volumes of the original
+			std::stringstream volumes;
+			volumes << "/" << graphicsState->exterior.get() << "/" <<
+				graphicsState->interior.get();
+			meshKey += volumes.str();
+		}
+		map<string, RenderOptions::SharedMesh>::iterator it =
+			renderOptions->sharedMeshes.find(meshKey);
+		if (meshKey != "" && it != renderOptions->sharedMeshes.end() &&
+			InstanceSharedMesh(it->second)) {
+			params.MarkAllUsed();
+			++(renderOptions->sharedMeshCount);
+			renderOptions->sharedMeshBytes += meshBytes;
+			return;
+		}
+	}
 	boost::shared_ptr<lux::Shape> sh(MakeShape(n, curTransform.StaticTransform(),
 		graphicsState->reverseOrientation, params));
 	if (!sh)
@@ -761,7 +1101,9 @@ void lux::Context::Shape(const string &n, const ParamSet &params) {
 			boost::shared_ptr<Primitive> pr(sh);
 			boost::shared_ptr<AreaLightPrimitive> prim(new AreaLightPrimitive(pr, area));
 			vector<boost::shared_ptr<AreaLightPrimitive> > aList;
-			if (!prim->CanIntersect()) {
+			// Primitives which can't be sampled, like analytic
+			// heightfields, are refined for sampling as well
+			if (!prim->CanIntersect() || !prim->CanSample()) {
 				// When refining the primitive, there's no way
 				// To tell that all refined primitives will be
 				// AreaLightPrimitive, so do some pointer tricks
@@ -775,12 +1117,10 @@ void lux::Context::Shape(const string &n, const ParamSet &params) {
 				aList.push_back(prim);
 			renderOptions->currentAreaLightInstance->push_back(aList);
 		} else {
+			// Refinement is deferred to the first instanciation
+			// where all the instance shapes are refined in parallel
 			renderOptions->currentInstanceSource->push_back(sh);
-			if (!sh->CanIntersect())
-				sh->Refine(*(renderOptions->currentInstanceRefined),
-					PrimitiveRefinementHints(false), sh);
-			else
-				renderOptions->currentInstanceRefined->push_back(sh);
+			renderOptions->currentInstanceRefined->push_back(sh);
 		}
 	} else if (graphicsState->areaLight != "") {
 		u_int lg = GetLightGroup();
@@ -798,8 +1138,141 @@ void lux::Context::Shape(const string &n, const ParamSet &params) {
 		renderOptions->primitives.push_back(prim);
 		// Add area light for primitive to light vector
 		renderOptions->lights.push_back(area);
-	} else
+	} else {
+		if (meshKey != "" && renderOptions->sharedMeshes.find(meshKey) ==
+			renderOptions->sharedMeshes.end()) {
+			RenderOptions::SharedMesh &shared(renderOptions->sharedMeshes[meshKey]);
+			shared.index = renderOptions->primitives.size();
+			shared.objectToWorld = curTransform.StaticTransform();
+		}
 		renderOptions->primitives.push_back(sh);
+	}
+}
+bool lux::Context::InstanceCachedMesh(const string &n, const ParamSet &params,
+	const string &key) {
+	map<string, CachedMesh>::iterator it = meshCache.find(key);
+	if (it == meshCache.end()) {
+		// First use: build the mesh and its own aggregate, the mesh
+		// only gets a placeholder material since every use of it is
+		// an instance with the material of the declaration
+		boost::shared_ptr<lux::Shape> sh(MakeShape(n,
+			curTransform.StaticTransform(),
+			graphicsState->reverseOrientation, params));
+		if (!sh)
+			return true; // the shape has reported the error
+		params.ReportUnused();
+		sh->SetMaterial(MakeMaterial("matte",
+			curTransform.StaticTransform(), ParamSet()));
+		vector<boost::shared_ptr<Primitive> > source(1, sh);
+		vector<boost::shared_ptr<Primitive> > refined;
+		RefinePrimitives(source, refined,
+			PrimitiveRefinementHints(false));
+		boost::shared_ptr<Primitive> accel(MakeAccelerator(
+			renderOptions->acceleratorName, refined,
+			renderOptions->acceleratorParams));
+		if (!accel)
+			accel = MakeAccelerator("kdtree", refined, ParamSet());
+		if (!accel) {
+			LOG(LUX_SEVERE,LUX_BUG) <<
+				"Unable to find \"kdtree\" accelerator";
+			return false;
+		}
+		it = meshCache.insert(std::make_pair(key, CachedMesh())).first;
+		it->second.objectToWorld = curTransform.StaticTransform();
+		it->second.source.swap(source);
+		it->second.accel = accel;
+		++meshCacheMisses;
+	} else {
+		params.MarkAllUsed();
+		++meshCacheHits;
+	}
+	CachedMesh &cached(it->second);
+	cached.frame = animationFrame;
+
+	boost::shared_ptr<lux::Material> material(graphicsState->material);
+	if (!material)
+		material = MakeMaterial("matte", curTransform.StaticTransform(),
+			ParamSet());
+	const lux::Transform instanceToWorld(curTransform.StaticTransform() *
+		Inverse(cached.objectToWorld));
+	renderOptions->primitives.push_back(boost::shared_ptr<Primitive>(
+		new InstancePrimitive(cached.source, cached.accel,
+		instanceToWorld, material, graphicsState->exterior,
+		graphicsState->interior)));
+	return true;
+}
+void lux::Context::PruneMeshCache() {
+	u_int dropped = 0;
+	for (map<string, CachedMesh>::iterator it = meshCache.begin();
+		it != meshCache.end();) {
+		if (it->second.frame != animationFrame) {
+			meshCache.erase(it++);
+			++dropped;
+		} else
+			++it;
+	}
+	LOG(LUX_INFO, LUX_NOERROR) << "Animation mesh cache: " <<
+		meshCacheHits << " meshes reused, " << meshCacheMisses <<
+		" built, " << dropped << " dropped";
+}
+void lux::Context::KeepMIPMap(const boost::shared_ptr<PendingMIPMap> &mipmap) {
+	CachedMIPMap &cached(mipmapCache[mipmap.get()]);
+	cached.mipmap = mipmap;
+	cached.frame = animationFrame;
+}
+void lux::Context::PruneMIPMapCache() {
+	u_int dropped = 0;
+	for (map<const PendingMIPMap *, CachedMIPMap>::iterator it =
+		mipmapCache.begin(); it != mipmapCache.end();) {
+		if (it->second.frame != animationFrame) {
+			mipmapCache.erase(it++);
+			++dropped;
+		} else
+			++it;
+	}
+	// Release the dropped maps no texture is using anymore
+	ImageTexture::ReleaseUnused();
+	LOG(LUX_INFO, LUX_NOERROR) << "Animation image map cache: " <<
+		mipmapCache.size() << " maps kept, " << dropped << " dropped";
+}
+bool lux::Context::InstanceSharedMesh(RenderOptions::SharedMesh &shared) {
+	if (!shared.accel) {
+		// First duplicate: build an aggregate of the original mesh
+		// and replace the original with an identity instance of it
+		boost::shared_ptr<Primitive> original(renderOptions->primitives[shared.index]);
+		shared.source.push_back(original);
+		vector<boost::shared_ptr<Primitive> > refined;
+		RefinePrimitives(shared.source, refined,
+			PrimitiveRefinementHints(false));
+		shared.accel = MakeAccelerator(renderOptions->acceleratorName,
+			refined, renderOptions->acceleratorParams);
+		if (!shared.accel)
+			shared.accel = MakeAccelerator("kdtree", refined, ParamSet());
+		if (!shared.accel) {
+			LOG(LUX_SEVERE,LUX_BUG) <<
+				"Unable to find \"kdtree\" accelerator";
+			shared.source.clear();
+			return false;
+		}
+		boost::shared_ptr<lux::Material> noMaterial;
+		boost::shared_ptr<lux::Volume> noVolume;
+		renderOptions->primitives[shared.index] =
+			boost::shared_ptr<Primitive>(new InstancePrimitive(shared.source,
+			shared.accel, lux::Transform(), noMaterial, noVolume,
+			noVolume));
+	}
+	// The duplicate keeps its own material and volumes
+	boost::shared_ptr<lux::Material> material(graphicsState->material);
+	if (!material)
+		material = MakeMaterial("matte", curTransform.StaticTransform(),
+			ParamSet());
+	const lux::Transform instanceToWorld(curTransform.StaticTransform() *
+		Inverse(shared.objectToWorld));
+	renderOptions->primitives.push_back(boost::shared_ptr<Primitive>(
+		new InstancePrimitive(shared.source, shared.accel,
+		instanceToWorld, material, graphicsState->exterior,
+		graphicsState->interior)));
+	return true;
 }
 void lux::Context::Renderer(const string &n, const ParamSet &params) {
 	VERIFY_OPTIONS("Renderer");
@@ -814,6 +1287,7 @@ void lux::Context::ReverseOrientation() {
 }
 void lux::Context::Volume(const string &n, const ParamSet &params) {
 	VERIFY_WORLD("Volume");
+	VERIFY_NOT_EDITING("Volume");
 	renderFarm->send("luxVolume", n, params);
 	Region *vr = MakeVolumeRegion(n, curTransform.StaticTransform(), params);
 	if (vr)
@@ -853,6 +1327,7 @@ void lux::Context::Interior(const string &n) {
 }
 void lux::Context::ObjectBegin(const string &n) {
 	VERIFY_WORLD("ObjectBegin");
+	VERIFY_NOT_EDITING("ObjectBegin");
 	renderFarm->send("luxObjectBegin", n);
 	AttributeBegin();
 	if (renderOptions->currentInstanceRefined) {
@@ -885,6 +1360,22 @@ void lux::Context::ObjectEnd() {
 }
 void lux::Context::ObjectInstance(const string &n) {
 	VERIFY_WORLD("ObjectInstance");
+	if (sceneEdit) {
+		// Move the instances of the object
+		if (!curTransform.IsStatic()) {
+			LOG(LUX_ERROR,LUX_ILLSTATE) << "Instance '" << n << "' can only be moved with a static transform";
+			return;
+		}
+		vector<boost::shared_ptr<InstancePrimitive> > &instances(renderOptions->objectInstances[n]);
+		if (instances.empty()) {
+			LOG(LUX_ERROR,LUX_BADTOKEN) << "Unable to find instance named '" << n << "'";
+			return;
+		}
+		for (u_int i = 0; i < instances.size(); ++i)
+			instances[i]->SetTransform(curTransform.StaticTransform());
+		sceneEdit->instances = true;
+		return;
+	}
 	renderFarm->send("luxObjectInstance", n);
 	// Object instance error checking
 	if (renderOptions->instancesRefined.find(n) == renderOptions->instancesRefined.end()) {
@@ -946,11 +1437,14 @@ void lux::Context::ObjectInstance(const string &n) {
 	if (in.size() != 0) {
 		if (in.size() > 1 || !in[0]->CanIntersect()) {
 			// Refine instance _Primitive_s and create aggregate
+			vector<boost::shared_ptr<Primitive> > refined;
+			RefinePrimitives(in, refined,
+				PrimitiveRefinementHints(false));
 			boost::shared_ptr<Primitive> accel(
 				MakeAccelerator(renderOptions->acceleratorName,
-				in, renderOptions->acceleratorParams));
+				refined, renderOptions->acceleratorParams));
 			if (!accel)
-				accel = MakeAccelerator("kdtree", in,
+				accel = MakeAccelerator("kdtree", refined,
 					ParamSet());
 			if (!accel)
 				LOG(LUX_SEVERE,LUX_BUG) <<
@@ -961,11 +1455,15 @@ void lux::Context::ObjectInstance(const string &n) {
 
 		boost::shared_ptr<Primitive> o;
 		if (curTransform.IsStatic()) {
-			o = boost::shared_ptr<Primitive>(new InstancePrimitive(inSource, in[0],
+			boost::shared_ptr<InstancePrimitive> ip(new InstancePrimitive(inSource, in[0],
 				curTransform.StaticTransform(),
 				graphicsState->material,
 				graphicsState->exterior,
 				graphicsState->interior));
+			// Remember top level instances so that edits can move them
+			if (!renderOptions->currentInstanceRefined)
+				renderOptions->objectInstances[n].push_back(ip);
+			o = ip;
 		} else {
 			o = boost::shared_ptr<Primitive>(new MotionPrimitive(inSource, in[0],
 				curTransform.GetMotionSystem(),
@@ -1038,11 +1536,13 @@ void lux::Context::MotionInstance(const string &n, float startTime, float endTim
 		return;
 	if (in.size() > 1 || !in[0]->CanIntersect()) {
 		// Refine instance _Primitive_s and create aggregate
+		vector<boost::shared_ptr<Primitive> > refined;
+		RefinePrimitives(in, refined, PrimitiveRefinementHints(false));
 		boost::shared_ptr<Primitive> accel(
-			MakeAccelerator(renderOptions->acceleratorName, in,
+			MakeAccelerator(renderOptions->acceleratorName, refined,
 			renderOptions->acceleratorParams));
 		if (!accel)
-			accel = MakeAccelerator("kdtree", in, ParamSet());
+			accel = MakeAccelerator("kdtree", refined, ParamSet());
 		if (!accel)
 			LOG(LUX_SEVERE,LUX_BUG)<< "Unable to find \"kdtree\" accelerator";
 		in.clear();
@@ -1074,6 +1574,7 @@ void lux::Context::MotionInstance(const string &n, float startTime, float endTim
 
 void lux::Context::WorldEnd() {
 	VERIFY_WORLD("WorldEnd");
+	VERIFY_NOT_EDITING("WorldEnd");
 	// renderfarm will flush when detecting WorldEnd
 	renderFarm->send("luxWorldEnd");
 
@@ -1094,6 +1595,9 @@ void lux::Context::WorldEnd() {
 	namedCoordinateSystems.erase(namedCoordinateSystems.begin(),
 		namedCoordinateSystems.end());
 
+	if (loadProfiler)
+		loadProfiler->EndParse();
+
 	if (startRenderingAfterParse)
 		ParseEnd();
 }
@@ -1102,6 +1606,10 @@ void lux::Context::ParseEnd() {
 	if (!terminated) {
 		// Create scene and render
 		luxCurrentScene = renderOptions->MakeScene();
+		if (animationMode) {
+			PruneMeshCache();
+			PruneMIPMapCache();
+		}
 		if (luxCurrentScene && !terminated) {
 			luxCurrentScene->camera()->SetVolume(graphicsState->exterior);
 
@@ -1136,6 +1644,101 @@ void lux::Context::ParseEnd() {
 	}
 }
 
+void lux::Context::EditBegin() {
+	VERIFY_INITIALIZED("EditBegin");
+	if (sceneEdit) {
+		LOG(LUX_ERROR,LUX_NESTING) << "luxEditBegin() called inside scene edit. Ignoring.";
+		return;
+	}
+	if (currentApiState != STATE_OPTIONS_BLOCK || !luxCurrentScene ||
+		!luxCurrentRenderer || luxCurrentScene->IsFilmOnly()) {
+		LOG(LUX_ERROR,LUX_ILLSTATE) << "luxEditBegin() called without a scene being rendered. Ignoring.";
+		return;
+	}
+	if (static_cast<u_int>((*renderFarm)["slaveNodeCount"].IntValue()) > 0) {
+		LOG(LUX_ERROR,LUX_UNIMPLEMENT) << "Scene edits are not supported with network rendering. Ignoring.";
+		return;
+	}
+	if (!sceneEditing) {
+		LOG(LUX_ERROR,LUX_ILLSTATE) << "luxEditBegin() called without scene editing enabled before the scene was loaded. Ignoring.";
+		return;
+	}
+	if (!luxCurrentRenderer->BeginSceneEdit()) {
+		LOG(LUX_ERROR,LUX_UNIMPLEMENT) << "The current renderer doesn't support scene edits, is still preprocessing the scene or has no rendering thread running. Ignoring.";
+		return;
+	}
+
+	// Edits are described like the world block content
+	sceneEdit = new SceneEdit();
+	currentApiState = STATE_WORLD_BLOCK;
+	curTransform = lux::Transform();
+	namedCoordinateSystems["world"] = curTransform;
+}
+
+void lux::Context::EditEnd() {
+	VERIFY_INITIALIZED("EditEnd");
+	if (!sceneEdit) {
+		LOG(LUX_ERROR,LUX_ILLSTATE) << "Unmatched luxEditEnd() encountered. Ignoring it.";
+		return;
+	}
+	while (pushedGraphicsStates.size()) {
+		LOG(LUX_WARNING,LUX_NESTING)<<"Missing end to luxAttributeBegin()";
+		AttributeEnd();
+	}
+	Scene *scene = luxCurrentScene;
+
+	// Rebind the edited materials, the refined primitives hold their own
+	// copy for shapes refined into several shapes
+	for (u_int i = 0; i < sceneEdit->materials.size(); ++i) {
+		const lux::Material *from = sceneEdit->materials[i].first.get();
+		const boost::shared_ptr<lux::Material> &to(sceneEdit->materials[i].second);
+		for (u_int j = 0; j < scene->primitives.size(); ++j)
+			scene->primitives[j]->ReplaceMaterial(from, to);
+		for (u_int j = 0; j < scene->refinedPrimitives.size(); ++j)
+			scene->refinedPrimitives[j]->ReplaceMaterial(from, to);
+		if (graphicsState->material.get() == from)
+			graphicsState->material = to;
+	}
+
+	// Moved instances keep their own aggregate, only the top level one
+	// is rebuilt
+	if (sceneEdit->instances) {
+		boost::shared_ptr<Primitive> accelerator(MakeAccelerator(
+			renderOptions->acceleratorName, scene->refinedPrimitives,
+			renderOptions->acceleratorParams));
+		if (!accelerator) {
+			ParamSet ps;
+			accelerator = MakeAccelerator("kdtree",
+				scene->refinedPrimitives, ps);
+		}
+		if (accelerator)
+			scene->SetAggregate(accelerator);
+		else
+			LOG(LUX_SEVERE,LUX_BUG)<< "Unable to find \"kdtree\" accelerator";
+	}
+
+	if (sceneEdit->camera) {
+		lux::Camera *camera = MakeCamera(renderOptions->cameraName,
+			renderOptions->worldToCamera.GetMotionSystem(),
+			renderOptions->cameraParams, scene->camera()->film);
+		if (camera) {
+			camera->SetVolume(graphicsState->exterior);
+			scene->SetCamera(camera);
+			camera->AutoFocus(*scene);
+		}
+	}
+
+	// Restart from a clean film
+	scene->camera()->film->ClearBuffers();
+
+	delete sceneEdit;
+	sceneEdit = NULL;
+	currentApiState = STATE_OPTIONS_BLOCK;
+	curTransform = lux::Transform();
+
+	luxCurrentRenderer->EndSceneEdit();
+}
+
 Scene *lux::Context::RenderOptions::MakeScene() const {
 	// Create scene objects from API settings
 	lux::Filter *filter = MakeFilter(filterName, filterParams);
@@ -1146,11 +1749,23 @@ Scene *lux::Context::RenderOptions::MakeScene() const {
 		surfIntegratorName, surfIntegratorParams);
 	lux::VolumeIntegrator *volumeIntegrator = MakeVolumeIntegrator(
 		volIntegratorName, volIntegratorParams);
-	boost::shared_ptr<Primitive> accelerator(MakeAccelerator(acceleratorName,
-		primitives, acceleratorParams));
-	if (!accelerator) {
-		ParamSet ps;
-		accelerator = MakeAccelerator("kdtree", primitives, ps);
+	// Refine the shapes on all cores before building the accelerator,
+	// the refined list keeps the declaration order
+	vector<boost::shared_ptr<Primitive> > refinedPrimitives;
+	{
+		LoadPhase phase("scene.refine");
+		RefinePrimitives(primitives, refinedPrimitives,
+			PrimitiveRefinementHints(false));
+	}
+	boost::shared_ptr<Primitive> accelerator;
+	{
+		LoadPhase phase("scene.accelerator");
+		accelerator = MakeAccelerator(acceleratorName,
+			refinedPrimitives, acceleratorParams);
+		if (!accelerator) {
+			ParamSet ps;
+			accelerator = MakeAccelerator("kdtree", refinedPrimitives, ps);
+		}
 	}
 	if (!accelerator)
 		LOG(LUX_SEVERE,LUX_BUG)<< "Unable to find \"kdtree\" accelerator";
@@ -1171,6 +1786,7 @@ Scene *lux::Context::RenderOptions::MakeScene() const {
 
 	Scene *ret = new Scene(camera, surfaceIntegrator, volumeIntegrator,
 		sampler, primitives, accelerator, lights, lightGroups, volumeRegion);
+	ret->refinedPrimitives.swap(refinedPrimitives);
 	// Erase primitives, lights, volume regions and instances from _RenderOptions_
 	primitives.clear();
 	lights.clear();
@@ -1181,6 +1797,14 @@ Scene *lux::Context::RenderOptions::MakeScene() const {
 	instancesSource.clear();
 	instancesRefined.clear();
 	lightInstances.clear();
+	if (sharedMeshCount > 0) {
+		LOG(LUX_INFO, LUX_NOERROR) << sharedMeshCount <<
+			" duplicate meshes instanced, " <<
+			sharedMeshBytes / (1024 * 1024) << "MBytes of data shared";
+	}
+	sharedMeshes.clear();
+	sharedMeshCount = 0;
+	sharedMeshBytes = 0;
 
 	// Set a fixed seed for animations or debugging
 	if (debugMode || !randomMode)
@@ -1321,6 +1945,14 @@ void lux::Context::Exit() {
 
 	if (luxCurrentRenderer)
 		luxCurrentRenderer->Terminate();
+
+	// Release the renderer suspended by an unfinished scene edit
+	if (sceneEdit) {
+		delete sceneEdit;
+		sceneEdit = NULL;
+		currentApiState = STATE_OPTIONS_BLOCK;
+		luxCurrentRenderer->EndSceneEdit();
+	}
 }
 
 void lux::Context::Abort() {
@@ -33,6 +33,7 @@
 #include "luxrays/core/geometry/motionsystem.h"
 
 #include <boost/thread/mutex.hpp>
+#include <list>
 #include <map>
 using std::map;
 
@@ -47,7 +48,9 @@ namespace lux {
 class LUX_EXPORT Context {
 public:
 
-	Context(std::string n = "Lux default context") : name(n) {}
+	Context(std::string n = "Lux default context") : name(n),
+		animationMode(false), animationFrame(0), meshSharing(false),
+		loadProfiling(false), sceneEditing(false) {}
 
 	~Context() {
 		Free();
@@ -73,6 +76,19 @@ public:
 	static u_int GetActiveLightGroup() {
 		return activeContext->GetLightGroup();
 	}
+	static LoadProfiler *GetActiveLoadProfiler() {
+		return activeContext ? activeContext->loadProfiler : NULL;
+	}
+	static boost::shared_ptr<TextureCache> GetActiveTextureCache() {
+		return activeContext ? activeContext->textureCache :
+			boost::shared_ptr<TextureCache>();
+	}
+	// In animation mode, keeps the image map across scenes for as long
+	// as scenes use it
+	static void KeepActiveMIPMap(const boost::shared_ptr<PendingMIPMap> &mipmap) {
+		if (activeContext && activeContext->animationMode)
+			activeContext->KeepMIPMap(mipmap);
+	}
 
 	boost::shared_ptr<lux::Texture<float> > GetFloatTexture(const string &n) const;
 	boost::shared_ptr<lux::Texture<SWCSpectrum> > GetColorTexture(const string &n) const;
@@ -137,6 +153,13 @@ public:
 	void WorldEnd();
 	// Used to end the parse phase after StartRenderingAfterParse(false)
 	void ParseEnd();
+	// Edit the scene being rendered: between EditBegin() and EditEnd()
+	// the rendering is suspended, Camera() replaces the camera,
+	// MakeNamedMaterial() and Texture() replace the named materials and
+	// textures, ObjectInstance() moves the instances of an object;
+	// EditEnd() applies the edits and restarts from a clean film
+	void EditBegin();
+	void EditEnd();
 
 	// Load/save FLM file
 	void LoadFLM(const string &name);
@@ -216,6 +239,14 @@ public:
 
 	void EnableDebugMode();
 	void DisableRandomMode();
+	// Keep unchanged meshes alive from one scene to the next
+	void SetAnimationMode(const bool enable);
+	// Store identical meshes once, the duplicates becoming instances
+	void SetMeshSharing(const bool enable);
+	// Profile the scene loads in the "load_profiler" object
+	void SetLoadProfiling(const bool enable);
+	// Keep the texture and material descriptions needed by scene edits
+	void SetSceneEditing(const bool enable);
 
 	void SetEpsilon(const float minValue, const float maxValue);
 	// NOTE: this feature is not currently supported by network rendering
@@ -255,6 +286,8 @@ private:
 			currentInstanceSource = NULL;
 			currentLightInstance = NULL;
 			currentAreaLightInstance = NULL;
+			sharedMeshCount = 0;
+			sharedMeshBytes = 0;
 			debugMode = false;
 			randomMode = true;
 		}
@@ -301,6 +334,44 @@ private:
 		mutable vector<boost::shared_ptr<Primitive> > *currentInstanceRefined;
 		mutable vector<boost::shared_ptr<Light> > *currentLightInstance;
 		mutable vector<vector<boost::shared_ptr<AreaLightPrimitive> > > *currentAreaLightInstance;
+		// Meshes declared several times with the same data
+		struct SharedMesh {
+			// Index of the first declaration in primitives
+			size_t index;
+			lux::Transform objectToWorld;
+			// The first declaration, built on the first duplicate
+			vector<boost::shared_ptr<Primitive> > source;
+			boost::shared_ptr<Primitive> accel;
+		};
+		// Shared meshes indexed by their content digest
+		mutable map<string, SharedMesh> sharedMeshes;
+		mutable u_int sharedMeshCount;
+		mutable size_t sharedMeshBytes;
+		// Static top level instances of each object, moved by edits
+		map<string, vector<boost::shared_ptr<InstancePrimitive> > > objectInstances;
+		// Texture and material descriptions in declaration order, to
+		// recreate the ones depending on an edited texture, only kept
+		// when scene editing is enabled
+		struct Definition {
+			enum Kind { FLOAT_TEXTURE, COLOR_TEXTURE, FRESNEL_TEXTURE,
+				NAMED_MATERIAL, MATERIAL };
+			Kind kind;
+			string name, type;
+			lux::Transform transform;
+			ParamSet params;
+			// Textures and named materials referenced by params when
+			// the object was declared
+			map<string, boost::shared_ptr<lux::Texture<float> > > floatTextures;
+			map<string, boost::shared_ptr<lux::Texture<SWCSpectrum> > > colorTextures;
+			map<string, boost::shared_ptr<lux::Texture<FresnelGeneral> > > fresnelTextures;
+			map<string, boost::shared_ptr<lux::Material> > namedMaterials;
+			// The object created from the description
+			boost::shared_ptr<lux::Texture<float> > floatTexture;
+			boost::shared_ptr<lux::Texture<SWCSpectrum> > colorTexture;
+			boost::shared_ptr<lux::Texture<FresnelGeneral> > fresnelTexture;
+			boost::shared_ptr<lux::Material> material;
+		};
+		std::list<Definition> definitions;
 		bool gotSearchPath;
 		bool debugMode;
 		bool randomMode;
@@ -335,6 +406,60 @@ private:
 		bool reverseOrientation;
 	};
 
+	// Adds an instance of a shared mesh for the current state,
+	// returns false if the shared mesh cannot be instanced
+	bool InstanceSharedMesh(RenderOptions::SharedMesh &shared);
+	// Adds an instance of the cached copy of a mesh, building it
+	// on first use, returns false if no aggregate can be built for it
+	bool InstanceCachedMesh(const string &n, const ParamSet &params,
+		const string &key);
+	// Drops the cached meshes the current scene did not use
+	void PruneMeshCache();
+	void KeepMIPMap(const boost::shared_ptr<PendingMIPMap> &mipmap);
+	// Drops the kept image maps the current scene did not use
+	void PruneMIPMapCache();
+	// Objects replaced during a scene edit and their replacement, the
+	// keys keep the replaced objects alive while their users are rebuilt
+	struct Replacements {
+		map<boost::shared_ptr<lux::Texture<float> >, boost::shared_ptr<lux::Texture<float> > > floatTextures;
+		map<boost::shared_ptr<lux::Texture<SWCSpectrum> >, boost::shared_ptr<lux::Texture<SWCSpectrum> > > colorTextures;
+		map<boost::shared_ptr<lux::Texture<FresnelGeneral> >, boost::shared_ptr<lux::Texture<FresnelGeneral> > > fresnelTextures;
+		map<boost::shared_ptr<lux::Material>, boost::shared_ptr<lux::Material> > materials;
+	};
+	// Records the description of a texture or material declared with
+	// the current state, the description of an object replaced during
+	// a scene edit takes the place of the replaced one
+	RenderOptions::Definition &Define(RenderOptions::Definition::Kind kind,
+		const string &n, const string &type, const ParamSet &params,
+		const void *replaced);
+	// Recreates the textures and materials depending on the replaced
+	// objects during a scene edit, and the ones depending on them
+	void RebuildDependents(Replacements &replaced);
+
+	// Meshes kept across scenes in animation mode
+	struct CachedMesh {
+		lux::Transform objectToWorld;
+		vector<boost::shared_ptr<Primitive> > source;
+		boost::shared_ptr<Primitive> accel;
+		u_int frame; // last scene using the mesh
+	};
+
+	// Image maps kept across scenes in animation mode
+	struct CachedMIPMap {
+		boost::shared_ptr<PendingMIPMap> mipmap;
+		u_int frame; // last scene using the map
+	};
+
+	// Pending edits of the scene being rendered
+	struct SceneEdit {
+		SceneEdit() : camera(false), instances(false) { }
+		bool camera;
+		bool instances;
+		// Replaced materials and their replacement, in edit order
+		vector<std::pair<boost::shared_ptr<lux::Material>,
+			boost::shared_ptr<lux::Material> > > materials;
+	};
+
 	static Context *activeContext;
 	string name;
 	u_int shapeNo; // used to identify anonymous shapes
@@ -350,8 +475,28 @@ private:
 	vector<GraphicsState> pushedGraphicsStates;
 	vector<lux::MotionTransform> pushedTransforms;
 	RenderFarm *renderFarm;
+	LoadProfiler *loadProfiler;
+	// Shared with the image maps paged by it, which may outlive the scene
+	boost::shared_ptr<TextureCache> textureCache;
 
 	ParamSet *filmOverrideParams;
+	SceneEdit *sceneEdit; // NULL outside of scene edits
+
+	// Animation mode survives Init()/Free() so that the mesh cache
+	// outlives each scene, meshes are indexed by content digest
+	bool animationMode;
+	u_int animationFrame;
+	map<string, CachedMesh> meshCache;
+	u_int meshCacheHits, meshCacheMisses;
+	// Indexed by the map itself, ImageTexture already shares one map
+	// between the textures with the same TexInfo
+	map<const PendingMIPMap *, CachedMIPMap> mipmapCache;
+	// Mesh sharing, load profiling and scene editing also survive
+	// Init()/Free()
+	bool meshSharing;
+	// the load profiler only exists while profiling is enabled
+	bool loadProfiling;
+	bool sceneEditing;
 	
 	// Dade - mutex used to wait the end of the rendering
 	mutable boost::mutex renderingMutex;
@@ -66,6 +66,15 @@ ContributionBuffer::~ContributionBuffer()
 	// buffers freeing is going to be handled by the pool
 }
 
+void ContributionBuffer::Discard()
+{
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		for (u_int j = 0; j < buffers[i].size(); ++j)
+			buffers[i][j]->Clear();
+	}
+	sampleCount = 0.f;
+}
+
 ScopedPoolLock::ScopedPoolLock(ContributionPool* pool) : lock(pool->mainSplattingMutex) {
 }
 
@@ -218,6 +227,22 @@ void ContributionPool::Flush()
 	}
 }
 
+void ContributionPool::Discard()
+{
+	fast_mutex::scoped_lock poolAction(poolMutex);
+
+	for (u_int tileIndex = 0; tileIndex < CFull.size(); ++tileIndex) {
+		for (u_int j = 0; j < CFull[tileIndex].size(); ++j) {
+			for (u_int k = 0; k < CFull[tileIndex][j].size(); ++k)
+				CFull[tileIndex][j][k]->Clear();
+			CFree.insert(CFree.end(),
+				CFull[tileIndex][j].begin(), CFull[tileIndex][j].end());
+			CFull[tileIndex][j].clear();
+		}
+	}
+	sampleCount = 0.f;
+}
+
 void ContributionPool::Delete()
 {
 	Flush();
@@ -85,6 +85,8 @@ class ContributionBuffer {
 
 		void Splat(Film *film, u_int tileIndex);
 
+		void Clear() { pos = 0; }
+
 	private:
 		u_int pos;
 		Contribution *contribs;
@@ -100,6 +102,9 @@ public:
 		sampleCount += c;
 	}
 
+	// Drops the contributions not yet handed to the pool
+	void Discard();
+
 private:
 	float sampleCount;
 	vector<vector<Buffer *> > buffers;
@@ -151,6 +156,9 @@ public:
 	// they can only be called by Scene after rendering is finished.
 	void Flush();
 	void Delete();
+	// Drops the pending contributions instead of splatting them, only
+	// while no rendering thread adds contributions
+	void Discard();
 
 	// I have to implement this method here in order
 	// to acquire splattingMutex lock
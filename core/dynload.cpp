@@ -30,6 +30,7 @@
 #include "material.h"
 #include "texture.h"
 #include "volume.h"
+#include "loadprofiler.h"
 
 namespace lux {
 
@@ -44,6 +45,7 @@ boost::shared_ptr<Shape> MakeShape(const string &name,
 {
 	if (DynamicLoader::registeredShapes().find(name) !=
 		DynamicLoader::registeredShapes().end()) {
+		LoadPhase phase("plugin.shape.", name);
 		boost::shared_ptr<Shape> ret(DynamicLoader::registeredShapes()[name](object2world, reverseOrientation, paramSet));
 		paramSet.ReportUnused();
 		return ret;
@@ -58,6 +60,7 @@ boost::shared_ptr<Material> MakeMaterial(const string &name,
 {
 	if (DynamicLoader::registeredMaterials().find(name) !=
 		DynamicLoader::registeredMaterials().end()) {
+		LoadPhase phase("plugin.material.", name);
 		boost::shared_ptr<Material> ret(DynamicLoader::registeredMaterials()[name](mtl2world, mp));
 		mp.ReportUnused();
 		return ret;
@@ -73,6 +76,7 @@ boost::shared_ptr<Texture<float> > MakeFloatTexture(const string &name,
 {
 	if (DynamicLoader::registeredFloatTextures().find(name) !=
 		DynamicLoader::registeredFloatTextures().end()) {
+		LoadPhase phase("plugin.texture.float.", name);
 		boost::shared_ptr<Texture<float> > ret(DynamicLoader::registeredFloatTextures()[name](tex2world, tp));
 		tp.ReportUnused();
 		return ret;
@@ -87,6 +91,7 @@ boost::shared_ptr<Texture<SWCSpectrum> > MakeSWCSpectrumTexture(const string &na
 {
 	if (DynamicLoader::registeredSWCSpectrumTextures().find(name) !=
 		DynamicLoader::registeredSWCSpectrumTextures().end()) {
+		LoadPhase phase("plugin.texture.color.", name);
 		boost::shared_ptr<Texture<SWCSpectrum> > ret(DynamicLoader::registeredSWCSpectrumTextures()[name](tex2world, tp));
 		tp.ReportUnused();
 		return ret;
@@ -101,6 +106,7 @@ boost::shared_ptr<Texture<FresnelGeneral> > MakeFresnelTexture(const string &nam
 {
 	if (DynamicLoader::registeredFresnelTextures().find(name) !=
 		DynamicLoader::registeredFresnelTextures().end()) {
+		LoadPhase phase("plugin.texture.fresnel.", name);
 		boost::shared_ptr<Texture<FresnelGeneral> > ret(DynamicLoader::registeredFresnelTextures()[name](tex2world, tp));
 		tp.ReportUnused();
 		return ret;
@@ -115,6 +121,7 @@ Light *MakeLight(const string &name,
 {
 	if (DynamicLoader::registeredLights().find(name) !=
 		DynamicLoader::registeredLights().end()) {
+		LoadPhase phase("plugin.light.", name);
 		Light *ret = DynamicLoader::registeredLights()[name](light2world,
 			paramSet);
 		paramSet.ReportUnused();
@@ -131,6 +138,7 @@ AreaLight *MakeAreaLight(const string &name,
 {
 	if (DynamicLoader::registeredAreaLights().find(name) !=
 		DynamicLoader::registeredAreaLights().end()) {
+		LoadPhase phase("plugin.arealight.", name);
 		AreaLight *ret =
 			DynamicLoader::registeredAreaLights()[name](light2world,
 				paramSet, prim);
@@ -147,6 +155,7 @@ Region *MakeVolumeRegion(const string &name,
 {
 	if (DynamicLoader::registeredVolumeRegions().find(name) !=
 		DynamicLoader::registeredVolumeRegions().end()) {
+		LoadPhase phase("plugin.volumeregion.", name);
 		Region *ret =
 			DynamicLoader::registeredVolumeRegions()[name](volume2world,
 				paramSet);
@@ -163,6 +172,7 @@ boost::shared_ptr<Volume> MakeVolume(const string &name,
 {
 	if (DynamicLoader::registeredVolumes().find(name) !=
 		DynamicLoader::registeredVolumes().end()) {
+		LoadPhase phase("plugin.volume.", name);
 		boost::shared_ptr<Volume> ret(DynamicLoader::registeredVolumes()[name](volume2world, paramSet));
 		paramSet.ReportUnused();
 		return ret;
@@ -177,6 +187,7 @@ SurfaceIntegrator *MakeSurfaceIntegrator(const string &name,
 {
 	if (DynamicLoader::registeredSurfaceIntegrators().find(name) !=
 		DynamicLoader::registeredSurfaceIntegrators().end()) {
+		LoadPhase phase("plugin.surfaceintegrator.", name);
 		SurfaceIntegrator *ret =
 			DynamicLoader::registeredSurfaceIntegrators()[name](paramSet);
 		paramSet.ReportUnused();
@@ -192,6 +203,7 @@ VolumeIntegrator *MakeVolumeIntegrator(const string &name,
 {
 	if (DynamicLoader::registeredVolumeIntegrators().find(name) !=
 		DynamicLoader::registeredVolumeIntegrators().end()) {
+		LoadPhase phase("plugin.volumeintegrator.", name);
 		VolumeIntegrator *ret =
 			DynamicLoader::registeredVolumeIntegrators()[name](paramSet);
 		paramSet.ReportUnused();
@@ -208,6 +220,7 @@ boost::shared_ptr<Aggregate> MakeAccelerator(const string &name,
 {
 	if (DynamicLoader::registeredAccelerators().find(name) !=
 		DynamicLoader::registeredAccelerators().end()) {
+		LoadPhase phase("plugin.accelerator.", name);
 		boost::shared_ptr<Aggregate> ret(
 			DynamicLoader::registeredAccelerators()[name](prims,
 				paramSet));
@@ -225,6 +238,7 @@ Camera *MakeCamera(const string &name,
 {
 	if (DynamicLoader::registeredCameras().find(name) !=
 		DynamicLoader::registeredCameras().end()) {
+		LoadPhase phase("plugin.camera.", name);
 		Camera *ret = DynamicLoader::registeredCameras()[name](world2cam, paramSet, film);
 		paramSet.ReportUnused();
 		return ret;
@@ -239,6 +253,7 @@ Sampler *MakeSampler(const string &name,
 {
 	if (DynamicLoader::registeredSamplers().find(name) !=
 		DynamicLoader::registeredSamplers().end()) {
+		LoadPhase phase("plugin.sampler.", name);
 		Sampler *ret = DynamicLoader::registeredSamplers()[name](paramSet,
 			film);
 		paramSet.ReportUnused();
@@ -254,6 +269,7 @@ Filter *MakeFilter(const string &name,
 {
 	if (DynamicLoader::registeredFilters().find(name) !=
 		DynamicLoader::registeredFilters().end()) {
+		LoadPhase phase("plugin.filter.", name);
 		Filter *ret = DynamicLoader::registeredFilters()[name](paramSet);
 		paramSet.ReportUnused();
 		return ret;
@@ -282,6 +298,7 @@ Film *MakeFilm(const string &name,
 {
 	if (DynamicLoader::registeredFilms().find(name) !=
 		DynamicLoader::registeredFilms().end()) {
+		LoadPhase phase("plugin.film.", name);
 		Film *ret = DynamicLoader::registeredFilms()[name](paramSet,
 			filter);
 		paramSet.ReportUnused();
@@ -310,6 +327,7 @@ Renderer *MakeRenderer(const string &name,
 {
 	if (DynamicLoader::registeredRenderer().find(name) !=
 		DynamicLoader::registeredRenderer().end()) {
+		LoadPhase phase("plugin.renderer.", name);
 		Renderer *ret = DynamicLoader::registeredRenderer()[name](paramSet);
 		paramSet.ReportUnused();
 		return ret;
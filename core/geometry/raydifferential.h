@@ -77,6 +77,10 @@ public:
 			float coords[3];
 			u_int triIndex;
 		} mesh;
+		struct {
+			float u; // position along the segment
+			float w; // signed position across the ribbon
+		} curve;
 	} IntersectionData;
 
 	DifferentialGeometry() { u = v = 0.; handle = ihandle = NULL; scattered = false; }
@@ -22,12 +22,30 @@
 #include "lux.h"
 #include "imagereader.h"
 #include "texturecolor.h"
+#include "tigerhash.h"
 #include "error.h"
 
+#include <fstream>
+#include <sstream>
 #include <boost/filesystem.hpp>
 
 namespace lux {
 
+// EWA filter weights are computed once when the library is loaded, image
+// maps may be built concurrently
+float *MIPMap::weightLut = MIPMap::ComputeWeightLut();
+
+float *MIPMap::ComputeWeightLut()
+{
+	float *lut = luxrays::AllocAligned<float>(WEIGHT_LUT_SIZE);
+	for (u_int i = 0; i < WEIGHT_LUT_SIZE; ++i) {
+		const float alpha = 2.f;
+		const float r2 = static_cast<float>(i) / static_cast<float>(WEIGHT_LUT_SIZE - 1);
+		lut[i] = expf(-alpha * r2) - expf(-alpha);
+	}
+	return lut;
+}
+
 ImageData::~ImageData()
 {
 	switch (pixel_type_) {
@@ -216,4 +234,155 @@ string AdjustFilename(const string filename, bool silent) {
 	return result;
 }
 
+string MIPMapCacheFilename(const string &imageFile,
+	ImageTextureFilterType filterType, ImageWrap wrapMode)
+{
+	const string &directory(TextureCache::GetDirectory());
+	if (directory.empty())
+		return "";
+	// Same lookup as when reading the image
+	const string filename(AdjustFilename(imageFile, true));
+	if (!FileExists(filename))
+		return "";
+
+	std::ostringstream name;
+	name << digest_string(file_hash<tigerhash>(filename));
+	if (filterType == MIPMAP_TRILINEAR || filterType == MIPMAP_EWA) {
+		// The wrap mode is used when resampling to a power of 2 size
+		static const char *wrapNames[] = { "repeat", "black", "white", "clamp" };
+		name << "-mip-" << wrapNames[wrapMode];
+	} else
+		name << "-map";
+	name << ".lxm";
+
+	return (boost::filesystem::path(directory) / name.str()).string();
+}
+
+template <class T> static MIPMap *ReadMIPMap(ImageTextureFilterType filterType,
+	const MIPMapFile &file, std::istream &is, const string &filename,
+	float maxAniso, ImageWrap wrapMode, float gain, float gamma,
+	const boost::shared_ptr<TextureCache> &cache)
+{
+	if (file.texelSize != sizeof(T))
+		return NULL;
+	if ((gain == 1.0f) && (gamma == 1.0f))
+		return new MIPMapFastImpl<T>(filterType, file, is, filename,
+			maxAniso, wrapMode, cache);
+	return new MIPMapImpl<T>(filterType, file, is, filename,
+		maxAniso, wrapMode, cache, gain, gamma);
+}
+
+MIPMap *ReadMIPMapCache(const string &cacheFile,
+	ImageTextureFilterType filterType, float maxAniso, ImageWrap wrapMode,
+	float gain, float gamma, const boost::shared_ptr<TextureCache> &cache)
+{
+	std::ifstream is(cacheFile.c_str(), std::ios::in | std::ios::binary);
+	if (!is.is_open())
+		return NULL;
+
+	MIPMapFile file;
+	const bool pyramid = filterType == MIPMAP_TRILINEAR ||
+		filterType == MIPMAP_EWA;
+	boost::uintmax_t dataSize = 0;
+	if (file.Read(is) && file.pyramid == pyramid)
+		dataSize = static_cast<boost::uintmax_t>(file.TileCount()) *
+			file.TileSize();
+	boost::system::error_code ec;
+	if (dataSize == 0 || boost::filesystem::file_size(cacheFile, ec) !=
+		static_cast<boost::uintmax_t>(file.DataOffset()) + dataSize) {
+		LOG(LUX_WARNING, LUX_BADFILE) << "Ignoring invalid MIPMap cache file '" <<
+			cacheFile << "'";
+		return NULL;
+	}
+
+	// Same rule as for maps built in memory, small ones aren't paged
+	const boost::shared_ptr<TextureCache> pager(dataSize > 4 * TextureCache::slotSize ?
+		cache : boost::shared_ptr<TextureCache>());
+
+	MIPMap *mipmap = NULL;
+	switch (file.channels) {
+	case 1:
+		if (file.pixelType == ImageData::UNSIGNED_CHAR_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned char, 1> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::FLOAT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<float, 1> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::UNSIGNED_SHORT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned short, 1> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		break;
+	case 3:
+		if (file.pixelType == ImageData::UNSIGNED_CHAR_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned char, 3> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::FLOAT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<float, 3> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::UNSIGNED_SHORT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned short, 3> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		break;
+	case 4:
+		if (file.pixelType == ImageData::UNSIGNED_CHAR_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned char, 4> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::FLOAT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<float, 4> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		else if (file.pixelType == ImageData::UNSIGNED_SHORT_TYPE)
+			mipmap = ReadMIPMap<TextureColor<unsigned short, 4> >(filterType,
+				file, is, cacheFile, maxAniso, wrapMode, gain, gamma, pager);
+		break;
+	}
+	if (!mipmap)
+		LOG(LUX_WARNING, LUX_BADFILE) << "Unsupported texel type in MIPMap cache file '" <<
+			cacheFile << "'";
+	else if (is.fail()) {
+		// The texels were not all read, let the caller decode the
+		// image again
+		LOG(LUX_WARNING, LUX_BADFILE) << "Unable to read all the texels from MIPMap cache file '" <<
+			cacheFile << "'";
+		delete mipmap;
+		mipmap = NULL;
+	}
+
+	return mipmap;
+}
+
+bool WriteMIPMapCache(const string &cacheFile, ImageData &image,
+	const MIPMap &mipmap)
+{
+	// Written under a unique name then renamed, other renders using
+	// the same directory never see a partial file
+	boost::system::error_code ec;
+	const string tmpFile(cacheFile + boost::filesystem::unique_path(
+		".%%%%-%%%%-%%%%.tmp", ec).string());
+
+	MIPMapFile file;
+	file.pixelType = image.getPixelDataType();
+	file.channels = image.getChannels();
+	bool written = false;
+	if (!ec) {
+		std::ofstream os(tmpFile.c_str(), std::ios::out |
+			std::ios::binary | std::ios::trunc);
+		written = os.is_open() && mipmap.Write(os, file);
+		os.close();
+		written = written && !os.fail();
+	}
+	if (written) {
+		boost::filesystem::rename(tmpFile, cacheFile, ec);
+		written = !ec;
+	}
+	if (!written) {
+		boost::filesystem::remove(tmpFile, ec);
+		LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to write MIPMap cache file '" <<
+			cacheFile << "'";
+		return false;
+	}
+
+	LOG(LUX_INFO, LUX_NOERROR) << "Stored mipmap in '" << cacheFile << "'";
+	return true;
+}
+
 } //namespace lux
@@ -84,5 +84,19 @@ public:
 	virtual ImageData* read(const string &name) = 0;
 };
 
+// MIPMaps of image files are kept in the texture cache directory, keyed by
+// the image content and the parameters changing the texels. Gain and gamma
+// are applied by the lookups and aren't part of the key.
+// Returns an empty name if the cache isn't used for the image.
+string MIPMapCacheFilename(const string &imageFile,
+	ImageTextureFilterType filterType, ImageWrap wrapMode);
+// Returns NULL if the cache file is missing or unusable, large maps are
+// paged from the file by the texture cache if it is enabled
+MIPMap *ReadMIPMapCache(const string &cacheFile,
+	ImageTextureFilterType filterType, float maxAniso, ImageWrap wrapMode,
+	float gain, float gamma, const boost::shared_ptr<TextureCache> &cache);
+bool WriteMIPMapCache(const string &cacheFile, ImageData &image,
+	const MIPMap &mipmap);
+
 }
 #endif // LUX_IMAGEREADER_H
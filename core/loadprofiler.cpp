@@ -0,0 +1,210 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#include "loadprofiler.h"
+#include "context.h"
+#include "osfunc.h"
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+using namespace lux;
+
+static string JSONString(const string &s)
+{
+	std::ostringstream os;
+	os << '"';
+	for (string::const_iterator c = s.begin(); c != s.end(); ++c) {
+		switch (*c) {
+			case '"': os << "\\\""; break;
+			case '\\': os << "\\\\"; break;
+			case '\n': os << "\\n"; break;
+			case '\r': os << "\\r"; break;
+			case '\t': os << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(*c) < 0x20)
+					os << "\\u" << std::hex << std::setw(4) <<
+						std::setfill('0') <<
+						static_cast<int>(*c) << std::dec;
+				else
+					os << *c;
+		}
+	}
+	os << '"';
+	return os.str();
+}
+
+LoadProfiler::LoadProfiler() : Queryable("load_profiler"),
+	sceneStart(osWallClockTime()),
+	sceneStartMemory(static_cast<double>(osProcessMemoryUsage()))
+{
+	AddStringAttribute(*this, "scene", "Name of the profiled scene", &LoadProfiler::scene);
+	AddStringAttribute(*this, "report", "Scene load profile in JSON format",
+		boost::bind(&LoadProfiler::GetReport, boost::cref(*this)));
+}
+
+void LoadProfiler::BeginScene(const string &sceneName)
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+	scene = sceneName;
+	sceneStart = osWallClockTime();
+	sceneStartMemory = static_cast<double>(osProcessMemoryUsage());
+}
+
+void LoadProfiler::EndParse()
+{
+	double start, startMemory;
+	{
+		boost::mutex::scoped_lock lock(phasesMutex);
+		start = sceneStart;
+		startMemory = sceneStartMemory;
+	}
+	Add("parse", osWallClockTime() - start,
+		static_cast<double>(osProcessMemoryUsage()) - startMemory);
+}
+
+void LoadProfiler::EndLoad()
+{
+	double start, startMemory;
+	{
+		boost::mutex::scoped_lock lock(phasesMutex);
+		start = sceneStart;
+		startMemory = sceneStartMemory;
+	}
+	Add("total", osWallClockTime() - start,
+		static_cast<double>(osProcessMemoryUsage()) - startMemory);
+}
+
+void LoadProfiler::Add(const string &phase, double seconds, double bytes)
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+
+	std::map<string, Phase>::iterator it = phases.find(phase);
+	if (it == phases.end()) {
+		it = phases.insert(std::make_pair(phase, Phase())).first;
+		order.push_back(phase);
+
+		// Expose the new phase, the attributes read the live figures
+		boost::shared_ptr<QueryableDoubleAttribute> time(
+			new QueryableDoubleAttribute(phase + ".time",
+			"Seconds spent in load phase '" + phase + "'"));
+		time->getFunc = boost::bind(&LoadProfiler::GetTime,
+			boost::cref(*this), phase);
+		AddAttribute(time);
+		boost::shared_ptr<QueryableDoubleAttribute> memory(
+			new QueryableDoubleAttribute(phase + ".memory",
+			"Bytes of memory used by load phase '" + phase + "'"));
+		memory->getFunc = boost::bind(&LoadProfiler::GetMemory,
+			boost::cref(*this), phase);
+		AddAttribute(memory);
+		boost::shared_ptr<QueryableIntAttribute> count(
+			new QueryableIntAttribute(phase + ".count",
+			"Number of times load phase '" + phase + "' ran"));
+		count->getFunc = boost::bind(&LoadProfiler::GetCountAttribute,
+			boost::cref(*this), phase);
+		AddAttribute(count);
+	}
+	it->second.seconds += seconds;
+	it->second.memory += bytes;
+	++(it->second.count);
+}
+
+double LoadProfiler::GetTime(const string &phase) const
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+	std::map<string, Phase>::const_iterator it = phases.find(phase);
+	return it != phases.end() ? it->second.seconds : 0.;
+}
+
+double LoadProfiler::GetMemory(const string &phase) const
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+	std::map<string, Phase>::const_iterator it = phases.find(phase);
+	return it != phases.end() ? it->second.memory : 0.;
+}
+
+u_int LoadProfiler::GetCount(const string &phase) const
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+	std::map<string, Phase>::const_iterator it = phases.find(phase);
+	return it != phases.end() ? it->second.count : 0;
+}
+
+string LoadProfiler::GetReport() const
+{
+	boost::mutex::scoped_lock lock(phasesMutex);
+
+	std::ostringstream os;
+	os.imbue(std::locale::classic());
+	os << std::fixed << std::setprecision(6);
+	os << "{\"scene\": " << JSONString(scene) << ", \"phases\": [";
+	for (size_t i = 0; i < order.size(); ++i) {
+		const Phase &p(phases.find(order[i])->second);
+		if (i > 0)
+			os << ", ";
+		os << "{\"name\": " << JSONString(order[i]) <<
+			", \"time\": " << p.seconds <<
+			", \"memory\": " << std::setprecision(0) << p.memory <<
+			std::setprecision(6) <<
+			", \"count\": " << p.count << "}";
+	}
+	os << "]}";
+	return os.str();
+}
+
+LoadPhase::LoadPhase(const char *phase) :
+	profiler(Context::GetActiveLoadProfiler()), memory(0.),
+	exactMemory(false)
+{
+	if (!profiler)
+		return;
+	name = phase;
+	Start();
+}
+
+LoadPhase::LoadPhase(const char *prefix, const string &n) :
+	profiler(Context::GetActiveLoadProfiler()), memory(0.),
+	exactMemory(false)
+{
+	if (!profiler)
+		return;
+	name.reserve(strlen(prefix) + n.size());
+	name.append(prefix).append(n);
+	Start();
+}
+
+void LoadPhase::Start()
+{
+	startMemory = static_cast<double>(osProcessMemoryUsage());
+	start = osWallClockTime();
+}
+
+LoadPhase::~LoadPhase()
+{
+	if (!profiler)
+		return;
+	const double seconds = osWallClockTime() - start;
+	if (!exactMemory)
+		memory = static_cast<double>(osProcessMemoryUsage()) - startMemory;
+	profiler->Add(name, seconds, memory);
+}
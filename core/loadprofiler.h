@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#ifndef LUX_LOADPROFILER_H
+#define LUX_LOADPROFILER_H
+
+#include "lux.h"
+#include "queryable.h"
+
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+
+namespace lux
+{
+
+// Wall clock time and memory spent in each phase of a scene load.
+// Phases are keyed by name, e.g. "parse", "scene.accelerator" or
+// "plugin.shape.trianglemesh", and may nest (plugins are created while
+// parsing), so their figures are not additive.
+// Memory is the change in resident process memory over the phase unless
+// the phase reports an exact figure, it can be negative.
+class LoadProfiler : public Queryable {
+public:
+	LoadProfiler();
+	virtual ~LoadProfiler() { }
+
+	// Starts a new scene, the "parse" and "total" phases are
+	// measured from here
+	void BeginScene(const string &sceneName);
+	// Records the "parse" phase, called at WorldEnd
+	void EndParse();
+	// Records the "total" phase, called once the scene is ready to render
+	void EndLoad();
+
+	void Add(const string &phase, double seconds, double bytes);
+
+	double GetTime(const string &phase) const;
+	double GetMemory(const string &phase) const;
+	u_int GetCount(const string &phase) const;
+	// Machine readable report of all phases as a single line of JSON
+	string GetReport() const;
+
+private:
+	struct Phase {
+		Phase() : seconds(0.), memory(0.), count(0) { }
+		double seconds, memory;
+		u_int count;
+	};
+
+	int GetCountAttribute(const string &phase) const {
+		return static_cast<int>(GetCount(phase));
+	}
+
+	mutable boost::mutex phasesMutex;
+	std::map<string, Phase> phases;
+	vector<string> order; // report phases in the order they first ran
+	string scene;
+	double sceneStart, sceneStartMemory;
+};
+
+// Adds the time and memory spent in the enclosing scope to the active
+// context profiler under the given phase name, the name is only built
+// while profiling
+class LoadPhase {
+public:
+	LoadPhase(const char *phase);
+	// Phase named prefix followed by n, e.g. "plugin.shape." and the
+	// plugin name
+	LoadPhase(const char *prefix, const string &n);
+	~LoadPhase();
+
+	// Report an exact memory figure instead of the resident memory change
+	void SetMemory(double bytes) { memory = bytes; exactMemory = true; }
+
+private:
+	void Start();
+
+	LoadProfiler *profiler;
+	string name;
+	double start, startMemory, memory;
+	bool exactMemory;
+};
+
+}//namespace lux
+
+#endif // LUX_LOADPROFILER_H
@@ -231,6 +231,9 @@ namespace lux
   class VolumeIntegrator;
   class RandomGenerator;
   class RenderFarm;
+  class LoadProfiler;
+  class TextureCache;
+  class PendingMIPMap;
   class Contribution;
   class ContributionBuffer;
   class ContributionPool;
@@ -100,14 +100,16 @@ void AddArrayElement(void *elem)
 	curArray->nelems++;
 }
 
-ParamArray *ArrayDup(ParamArray *ra)
-{
-	ParamArray *ret = new ParamArray;
-	ret->elementSize = ra->elementSize;
-	ret->allocated = ra->allocated;
-	ret->nelems = ra->nelems;
-	ret->array = malloc(ra->nelems * ra->elementSize);
-	memcpy(ret->array, ra->array, ra->nelems * ra->elementSize);
+// Hands the array being built over to the rule without copying it
+ParamArray *ArrayTake()
+{
+	ParamArray *ret = curArray;
+	curArray = NULL;
+	// Give back the unused space, this doesn't move the data in general
+	if (ret->nelems > 0 && ret->allocated > ret->nelems) {
+		ret->array = realloc(ret->array, ret->nelems * ret->elementSize);
+		ret->allocated = ret->nelems;
+	}
 	return ret;
 }
 
@@ -126,7 +128,8 @@ void FreeArgs()
 			for (u_int j = 0; j < CPSZ(i); ++j)
 				free(static_cast<char **>(CPA(i))[j]);
 		}
-		delete[] static_cast<char *>(CPA(i));
+		// Arrays handed over to a ParamSet have been reset
+		free(CPA(i));
 	}
 }
 
@@ -212,13 +215,13 @@ string_array: real_string_array
 }
 | single_element_string_array
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 	arrayIsSingleString = true;
 };
 
 real_string_array: array_init LBRACK string_list RBRACK
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 };
 
 single_element_string_array: array_init string_list_entry
@@ -244,12 +247,12 @@ num_array: real_num_array
 }
 | single_element_num_array
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 };
 
 real_num_array: array_init LBRACK num_list RBRACK
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 };
 
 single_element_num_array: array_init num_list_entry
@@ -287,8 +290,8 @@ paramlist_contents: paramlist_entry paramlist_contents
 
 paramlist_entry: STRING array
 {
-	void *arg = new char[$2->nelems * $2->elementSize];
-	memcpy(arg, $2->array, $2->nelems * $2->elementSize);
+	void *arg = $2->array;
+	$2->array = NULL;
 	if (CPS >= CPAL) {
 		CPAL = 2 * CPAL + 1;
 		CP = static_cast<ParamListElem *>(realloc(CP,
@@ -570,11 +573,12 @@ static void InitParamSet(ParamSet &ps, u_int count, ParamListElem *list) {
 		if (type == PARAM_TYPE_INT) {
 			// parser doesn't handle ints, so convert from floats
 			int *idata = new int[nItems];
+			boost::shared_ptr<const void> owner(idata,
+				boost::checked_array_deleter<int>());
 			float *fdata = static_cast<float *>(data);
 			for (u_int j = 0; j < nItems; ++j)
 				idata[j] = static_cast<int>(fdata[j]);
-			ps.AddInt(name, idata, nItems);
-			delete[] idata;
+			ps.AddInt(name, idata, nItems, owner);
 		} else if (type == PARAM_TYPE_BOOL) {
 			// strings -> bools
 			bool *bdata = new bool[nItems];
@@ -594,15 +598,26 @@ static void InitParamSet(ParamSet &ps, u_int count, ParamListElem *list) {
 			ps.AddBool(name, bdata, nItems);
 			delete[] bdata;
 		} else if (type == PARAM_TYPE_FLOAT) {
-			ps.AddFloat(name, static_cast<float *>(data), nItems);
+			// Hand the parsed array over to the ParamSet
+			boost::shared_ptr<const void> owner(data, free);
+			list[i].arg = NULL;
+			ps.AddFloat(name, static_cast<float *>(data), nItems, owner);
 		} else if (type == PARAM_TYPE_POINT) {
-			ps.AddPoint(name, static_cast<Point *>(data), nItems / 3);
+			boost::shared_ptr<const void> owner(data, free);
+			list[i].arg = NULL;
+			ps.AddPoint(name, static_cast<Point *>(data), nItems / 3, owner);
 		} else if (type == PARAM_TYPE_VECTOR) {
-			ps.AddVector(name, static_cast<Vector *>(data), nItems / 3);
+			boost::shared_ptr<const void> owner(data, free);
+			list[i].arg = NULL;
+			ps.AddVector(name, static_cast<Vector *>(data), nItems / 3, owner);
 		} else if (type == PARAM_TYPE_NORMAL) {
-			ps.AddNormal(name, static_cast<Normal *>(data), nItems / 3);
+			boost::shared_ptr<const void> owner(data, free);
+			list[i].arg = NULL;
+			ps.AddNormal(name, static_cast<Normal *>(data), nItems / 3, owner);
 		} else if (type == PARAM_TYPE_COLOR) {
-			ps.AddRGBColor(name, static_cast<RGBColor *>(data), nItems / COLOR_SAMPLES);
+			boost::shared_ptr<const void> owner(data, free);
+			list[i].arg = NULL;
+			ps.AddRGBColor(name, static_cast<RGBColor *>(data), nItems / COLOR_SAMPLES, owner);
 		} else if (type == PARAM_TYPE_STRING) {
 			string *strings = new string[nItems];
 			for (u_int j = 0; j < nItems; ++j)
@@ -48,7 +48,8 @@ void Material::Bump(const SpectrumWavelengths &sw,
 	const Normal &nGeom, DifferentialGeometry *dgBump) const
 {
 	float du, dv;
-	bumpMap->GetDuv(sw, *dgBump, bumpmapSampleDistance, &du, &dv);
+	TextureEvaluationCache::GetDuv(*bumpMap, sw, *dgBump,
+		bumpmapSampleDistance, &du, &dv);
 	dgBump->dpdu += du * Vector(dgBump->nn);   // different to book, as displace*dgs.dndu creates artefacts
 	dgBump->dpdv += dv * Vector(dgBump->nn);   // different to book, as displace*dgs.dndv creates artefacts
 	const Normal nn(dgBump->nn);
@@ -29,8 +29,13 @@
 #include "luxrays/core/color/swcspectrum.h"
 #include "error.h"
 #include "queryable.h"
+#include "texturecache.h"
+#include "osfunc.h"
 #include "luxrays/utils/memory.h"
 
+#include <boost/bind.hpp>
+#include <xmmintrin.h>
+
 namespace lux
 {
 
@@ -50,6 +55,213 @@ typedef enum {
 	TEXTURE_CLAMP
 } ImageWrap;
 
+// Layout of MIPMap files: this header, the size of each level, then the
+// tiles of all the levels in the order of TexelArray::MoveToTiles
+class MIPMapFile {
+public:
+	// "LXMM" in little endian, files of the other byte order are rejected
+	static const u_int magic = 0x4d4d584c;
+	static const u_int version = 1;
+
+	MIPMapFile() : pixelType(0), channels(0), texelSize(0),
+		pyramid(false) { }
+
+	// Largest square tile fitting in a texture cache slot
+	static u_int TileShift(u_int texelSize) {
+		u_int shift = 0;
+		while ((4U << (2 * shift)) * texelSize <= TextureCache::slotSize)
+			++shift;
+		return shift;
+	}
+	static u_int TileCount(u_int texelSize, u_int uRes, u_int vRes) {
+		const u_int shift = TileShift(texelSize), side = 1U << shift;
+		return ((uRes + side - 1) >> shift) *
+			((vRes + side - 1) >> shift);
+	}
+	u_int TileSize() const {
+		return (1U << (2 * TileShift(texelSize))) * texelSize;
+	}
+	// Tiles of all the levels
+	u_int TileCount() const {
+		u_int count = 0;
+		for (size_t i = 0; i < uRes.size(); ++i)
+			count += TileCount(texelSize, uRes[i], vRes[i]);
+		return count;
+	}
+	std::streamoff DataOffset() const {
+		return static_cast<std::streamoff>(7 + 2 * uRes.size()) *
+			sizeof(u_int);
+	}
+
+	bool Read(std::istream &is) {
+		u_int header[7];
+		is.read(reinterpret_cast<char *>(header), sizeof(header));
+		if (is.fail() || header[0] != magic || header[1] != version ||
+			header[4] == 0 || header[6] == 0 || header[6] > 32)
+			return false;
+		pixelType = header[2];
+		channels = header[3];
+		texelSize = header[4];
+		pyramid = header[5] != 0;
+		uRes.resize(header[6]);
+		vRes.resize(header[6]);
+		for (u_int i = 0; i < header[6]; ++i) {
+			u_int size[2];
+			is.read(reinterpret_cast<char *>(size), sizeof(size));
+			if (is.fail() || size[0] == 0 || size[1] == 0)
+				return false;
+			uRes[i] = size[0];
+			vRes[i] = size[1];
+		}
+		return true;
+	}
+	bool Write(std::ostream &os) const {
+		const u_int header[7] = { magic, version, pixelType, channels,
+			texelSize, pyramid ? 1U : 0U,
+			static_cast<u_int>(uRes.size()) };
+		os.write(reinterpret_cast<const char *>(header), sizeof(header));
+		for (size_t i = 0; i < uRes.size(); ++i) {
+			const u_int size[2] = { uRes[i], vRes[i] };
+			os.write(reinterpret_cast<const char *>(size), sizeof(size));
+		}
+		return !os.fail();
+	}
+
+	// Pixel type and channels of the image, see ImageData
+	u_int pixelType, channels;
+	u_int texelSize;
+	// Levels of a pyramid or a single level for NEAREST and BILINEAR
+	bool pyramid;
+	vector<u_int> uRes, vRes;
+};
+
+// Texels of a MIPMap level, in memory or in the tiles of the texture cache
+template <class T> class TexelArray {
+public:
+	TexelArray(u_int nu, u_int nv, const T *d = NULL) :
+		data(new luxrays::BlockedArray<T>(nu, nv, d)), tiles(NULL),
+		uRes(nu), vRes(nv) { }
+	// Texels already stored in the tiles starting at first
+	TexelArray(u_int nu, u_int nv, TiledTexture *tiledTexture,
+		u_int first) : data(NULL), uRes(nu), vRes(nv) {
+		SetTiles(tiledTexture, first);
+	}
+	~TexelArray() { delete data; }
+
+	u_int uSize() const { return uRes; }
+	u_int vSize() const { return vRes; }
+
+	// Only used while the texels are in memory
+	T &operator()(u_int s, u_int t) { return (*data)(s, t); }
+	T operator()(u_int s, u_int t) const {
+		if (!tiles)
+			return (*data)(s, t);
+		return tiles->Get<T>(firstTile + (t >> tileShift) * uTiles +
+			(s >> tileShift), ((t & tileMask) << tileShift) +
+			(s & tileMask));
+	}
+
+	const luxrays::BlockedArray<T> *GetBlockedArray() const { return data; }
+
+	// Whether texels from (s0,t0) to (s1,t1) need no wrapping
+	bool Inside(int s0, int t0, int s1, int t1) const {
+		return s0 >= 0 && t0 >= 0 && s1 < static_cast<int>(uRes) &&
+			t1 < static_cast<int>(vRes);
+	}
+
+	static u_int TileShift() { return MIPMapFile::TileShift(sizeof(T)); }
+	static u_int TileSize() {
+		return (1U << (2 * TileShift())) * sizeof(T);
+	}
+	u_int TileCount() const {
+		return MIPMapFile::TileCount(sizeof(T), uRes, vRes);
+	}
+
+	// Writes the texels to the tiles starting at first and frees them
+	bool MoveToTiles(TiledTexture *tiledTexture, u_int first) {
+		const u_int side = 1U << TileShift();
+		const u_int nu = (uRes + side - 1) / side;
+		const u_int nv = (vRes + side - 1) / side;
+		vector<T> tile(side * side);
+		for (u_int tv = 0; tv < nv; ++tv) {
+			for (u_int tu = 0; tu < nu; ++tu) {
+				GetTile(tu, tv, tile);
+				if (!tiledTexture->WriteTile(first + tv * nu + tu,
+					reinterpret_cast<const char *>(&tile[0])))
+					return false;
+			}
+		}
+		SetTiles(tiledTexture, first);
+		delete data;
+		data = NULL;
+		return true;
+	}
+
+	// Stores the texels in memory as consecutive tiles of a MIPMap file
+	bool WriteTiles(std::ostream &os) const {
+		const u_int side = 1U << TileShift();
+		const u_int nu = (uRes + side - 1) / side;
+		const u_int nv = (vRes + side - 1) / side;
+		vector<T> tile(side * side);
+		for (u_int tv = 0; tv < nv && !os.fail(); ++tv) {
+			for (u_int tu = 0; tu < nu; ++tu) {
+				GetTile(tu, tv, tile);
+				os.write(reinterpret_cast<const char *>(&tile[0]),
+					tile.size() * sizeof(T));
+			}
+		}
+		return !os.fail();
+	}
+	// Loads the texels in memory from consecutive tiles of a MIPMap file
+	bool ReadTiles(std::istream &is) {
+		const u_int shift = TileShift(), side = 1U << shift;
+		const u_int nu = (uRes + side - 1) >> shift;
+		const u_int nv = (vRes + side - 1) >> shift;
+		vector<T> tile(side * side);
+		for (u_int tv = 0; tv < nv && !is.fail(); ++tv) {
+			for (u_int tu = 0; tu < nu; ++tu) {
+				is.read(reinterpret_cast<char *>(&tile[0]),
+					tile.size() * sizeof(T));
+				for (u_int t = 0; t < side; ++t) {
+					const u_int iv = (tv << shift) + t;
+					for (u_int s = 0; s < side; ++s) {
+						const u_int iu = (tu << shift) + s;
+						if (iu < uRes && iv < vRes)
+							(*data)(iu, iv) = tile[(t << shift) + s];
+					}
+				}
+			}
+		}
+		return !is.fail();
+	}
+
+private:
+	void GetTile(u_int tu, u_int tv, vector<T> &tile) const {
+		const u_int shift = TileShift(), side = 1U << shift;
+		for (u_int t = 0; t < side; ++t) {
+			const u_int it = (tv << shift) + t;
+			for (u_int s = 0; s < side; ++s) {
+				const u_int is = (tu << shift) + s;
+				tile[(t << shift) + s] = (is < uRes && it < vRes) ?
+					(*data)(is, it) : T();
+			}
+		}
+	}
+	void SetTiles(TiledTexture *tiledTexture, u_int first) {
+		const u_int shift = TileShift(), side = 1U << shift;
+		tiles = tiledTexture;
+		firstTile = first;
+		uTiles = (uRes + side - 1) >> shift;
+		tileShift = shift;
+		tileMask = side - 1;
+	}
+
+	luxrays::BlockedArray<T> *data;
+	TiledTexture *tiles;
+	u_int uRes, vRes;
+	u_int firstTile, uTiles, tileShift, tileMask;
+};
+
 class MIPMap : public Queryable {
 public:
 	// MIPMap Public Methods
@@ -73,6 +285,55 @@ public:
 
 	virtual u_int GetMemoryUsed() const = 0;
 	virtual void DiscardMipmaps(u_int n) { }
+	// Moves the texels to tiles paged by the cache, returns false if
+	// the map stays in memory
+	virtual bool MoveToTextureCache(const boost::shared_ptr<TextureCache> &cache) {
+		return false;
+	}
+	// Stores the levels in a MIPMap file, the pixel type and channels
+	// of the header are set by the caller
+	virtual bool Write(std::ostream &os, MIPMapFile &file) const {
+		return false;
+	}
+	// Copy of the map with texels in a compact storage, NULL if the
+	// texel type has none
+	virtual MIPMap *Compress() const { return NULL; }
+	// Memory used by the texels of all levels, resident or not
+	virtual u_int GetTexelMemory() const = 0;
+
+protected:
+#define WEIGHT_LUT_SIZE 128
+	// EWA filter weights, shared by all texel types
+	static float *weightLut;
+
+	// Computes the EWA filter weights of the 4 texels of row tt starting
+	// at column is, the weight is 0 outside of the ellipse.
+	// Returns false if the 4 texels are all outside of the ellipse
+	static bool EWAWeights(float A, float B, float C, float s, float tt,
+		int is, float weights[4]) {
+		const float fs = static_cast<float>(is);
+		const __m128 ss = _mm_sub_ps(_mm_set_ps(fs + 3.f, fs + 2.f,
+			fs + 1.f, fs), _mm_set1_ps(s));
+		const __m128 r2 = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(A), ss), ss),
+			_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(B), ss),
+			_mm_set1_ps(tt))), _mm_set1_ps(C * tt * tt));
+		const int inside = _mm_movemask_ps(_mm_cmplt_ps(r2,
+			_mm_set1_ps(1.f)));
+		if (!inside)
+			return false;
+		float index[4];
+		_mm_storeu_ps(index, _mm_mul_ps(r2,
+			_mm_set1_ps(WEIGHT_LUT_SIZE)));
+		for (u_int i = 0; i < 4; ++i)
+			weights[i] = (inside & (1 << i)) ?
+				weightLut[min(luxrays::Float2Int(index[i]),
+				WEIGHT_LUT_SIZE - 1)] : 0.f;
+		return true;
+	}
+
+private:
+	static float *ComputeWeightLut();
 };
 
 template <class T> class MIPMapFastImpl : public MIPMap {
@@ -81,6 +342,13 @@ public:
 	MIPMapFastImpl(ImageTextureFilterType type, u_int xres, u_int yres,
 		const T *data, float maxAniso = 8.f,
 		ImageWrap wrapMode = TEXTURE_REPEAT);
+	// Levels of a MIPMap file, read from the stream positioned after
+	// the header or paged from the file by the texture cache
+	MIPMapFastImpl(ImageTextureFilterType type, const MIPMapFile &file,
+		std::istream &is, const string &filename, float maxAniso,
+		ImageWrap wrapMode, const boost::shared_ptr<TextureCache> &cache);
+	// Levels of another MIPMap converted to texels of type T
+	template <class U> explicit MIPMapFastImpl(const MIPMapFastImpl<U> *mipmap);
 	virtual ~MIPMapFastImpl();
 
 	virtual float LookupFloat(Channel channel, float s, float t,
@@ -251,6 +519,11 @@ public:
 	virtual void GetMinMaxFloat(Channel channel, float *minValue, float *maxValue) const;
 
 	virtual u_int GetMemoryUsed() const {
+		if (tiles)
+			return tiles->GetResidentMemory();
+		return GetTexelMemory();
+	}
+	virtual u_int GetTexelMemory() const {
 		switch (filterType) {
 			case MIPMAP_EWA:
 			case MIPMAP_TRILINEAR: {
@@ -266,7 +539,7 @@ public:
 				return singleMap->uSize() *
 					singleMap->vSize() * sizeof(T);
 		}
-		LOG(LUX_ERROR, LUX_SYSTEM) << "Internal error in MIPMapFastImpl::GetMemoryUsed(), unknown filter type";
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Internal error in MIPMapFastImpl::GetTexelMemory(), unknown filter type";
 		return 0;
 	}
 
@@ -278,7 +551,7 @@ public:
 			delete pyramid[0];
 
 			nLevels--;
-			luxrays::BlockedArray<T> **newPyramid = new luxrays::BlockedArray<T> *[nLevels];
+			TexelArray<T> **newPyramid = new TexelArray<T> *[nLevels];
 			for (u_int j = 0; j < nLevels; ++j)
 				newPyramid[j] = pyramid[j + 1];
 
@@ -287,9 +560,18 @@ public:
 		}
 	}
 
+	virtual bool MoveToTextureCache(const boost::shared_ptr<TextureCache> &cache);
+	virtual bool Write(std::ostream &os, MIPMapFile &file) const;
+	virtual MIPMap *Compress() const {
+		typedef typename CompressedTexel<T>::Type C;
+		if (sizeof(C) >= sizeof(T))
+			return NULL;
+		return new MIPMapFastImpl<C>(this);
+	}
+
 	virtual const luxrays::BlockedArray<T> *GetSingleMap() const {
-		// This works even if I have multiple levels
-		return singleMap;
+		// NULL once the texels have been moved to the texture cache
+		return (nLevels == 0 ? singleMap : pyramid[0])->GetBlockedArray();
 	}
 
 protected:
@@ -305,12 +587,22 @@ protected:
 	RGBAColor Texel(int s, int t) const;
 
 private:
+	template <class U> friend class MIPMapFastImpl;
+
 	// MIPMAPImpl Private data types
 	struct ResampleWeight {
 		int firstTexel;
 		float weight[4];
 	};
 	// MIPMapFastImpl Private Methods
+	static void ResampleS(const ResampleWeight *sWeights, const T *img,
+		T *resampledImage, u_int sres, u_int sPow2, ImageWrap wrapMode,
+		u_int t);
+	static void ResampleT(const ResampleWeight *tWeights,
+		T *resampledImage, u_int tres, u_int sPow2, u_int tPow2,
+		ImageWrap wrapMode, u_int block);
+	static void Downsample(const TexelArray<T> *finer,
+		TexelArray<T> *level, u_int block);
 	ResampleWeight *ResampleWeights(u_int oldres, u_int newres) {
 		BOOST_ASSERT(newres >= oldres);
 		ResampleWeight *wt = new ResampleWeight[newres];
@@ -364,15 +656,16 @@ private:
 	ImageWrap wrapMode;
 	u_int nLevels;
 	union {
-		luxrays::BlockedArray<T> **pyramid;
-		luxrays::BlockedArray<T> *singleMap;
+		TexelArray<T> **pyramid;
+		TexelArray<T> *singleMap;
 	};
-
-#define WEIGHT_LUT_SIZE 128
-	static float *weightLut;
+	// Backing store of the levels once moved to the texture cache
+	TiledTexture *tiles;
 };
 
-template <class T> float *MIPMapFastImpl<T>::weightLut = NULL;
+// Rows and columns are built in blocks, so that threads don't write to
+// the same cache lines
+#define MIPMAP_BUILD_BLOCK 16
 
 // MIPMapFastImpl Method Definitions
 template <class T>
@@ -485,6 +778,14 @@ float MIPMapFastImpl<T>::Triangle(Channel channel, u_int level,
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *pyramid[level];
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1))
+		return luxrays::Lerp(ds,
+			luxrays::Lerp(dt, l(s0, t0).GetFloat(channel),
+			l(s0, t0 + 1).GetFloat(channel)),
+			luxrays::Lerp(dt, l(s0 + 1, t0).GetFloat(channel),
+			l(s0 + 1, t0 + 1).GetFloat(channel)));
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(channel, level, s0, t0),
 		Texel(channel, level, s0, t0 + 1)),
@@ -502,6 +803,16 @@ SWCSpectrum MIPMapFastImpl<T>::Triangle(const SpectrumWavelengths &sw,
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *pyramid[level];
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1)) {
+		TexelSpectrumSum<T> sum(sw);
+		sum.Add(l(s0, t0), (1.f - ds) * (1.f - dt));
+		sum.Add(l(s0, t0 + 1), (1.f - ds) * dt);
+		sum.Add(l(s0 + 1, t0), ds * (1.f - dt));
+		sum.Add(l(s0 + 1, t0 + 1), ds * dt);
+		return sum.GetSpectrum();
+	}
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(sw, level, s0, t0),
 		Texel(sw, level, s0, t0 + 1)),
@@ -519,6 +830,14 @@ RGBAColor MIPMapFastImpl<T>::Triangle(u_int level,
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *pyramid[level];
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1))
+		return luxrays::Lerp(ds,
+			luxrays::Lerp(dt, l(s0, t0).GetRGBAColor(),
+			l(s0, t0 + 1).GetRGBAColor()),
+			luxrays::Lerp(dt, l(s0 + 1, t0).GetRGBAColor(),
+			l(s0 + 1, t0 + 1).GetRGBAColor()));
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(level, s0, t0),
 		Texel(level, s0, t0 + 1)),
@@ -535,6 +854,14 @@ float MIPMapFastImpl<T>::Triangle(Channel channel, float s, float t) const
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *singleMap;
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1))
+		return luxrays::Lerp(ds,
+			luxrays::Lerp(dt, l(s0, t0).GetFloat(channel),
+			l(s0, t0 + 1).GetFloat(channel)),
+			luxrays::Lerp(dt, l(s0 + 1, t0).GetFloat(channel),
+			l(s0 + 1, t0 + 1).GetFloat(channel)));
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(channel, s0, t0), Texel(channel, s0, t0 + 1)),
 		luxrays::Lerp(dt, Texel(channel, s0 + 1, t0),
@@ -550,6 +877,16 @@ SWCSpectrum MIPMapFastImpl<T>::Triangle(const SpectrumWavelengths &sw,
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *singleMap;
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1)) {
+		TexelSpectrumSum<T> sum(sw);
+		sum.Add(l(s0, t0), (1.f - ds) * (1.f - dt));
+		sum.Add(l(s0, t0 + 1), (1.f - ds) * dt);
+		sum.Add(l(s0 + 1, t0), ds * (1.f - dt));
+		sum.Add(l(s0 + 1, t0 + 1), ds * dt);
+		return sum.GetSpectrum();
+	}
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(sw, s0, t0), Texel(sw, s0, t0 + 1)),
 		luxrays::Lerp(dt, Texel(sw, s0 + 1, t0),
@@ -564,6 +901,14 @@ RGBAColor MIPMapFastImpl<T>::Triangle(float s, float t) const
 	t -= .5f;
 	const int s0 = luxrays::Floor2Int(s), t0 = luxrays::Floor2Int(t);
 	const float ds = s - s0, dt = t - t0;
+	// Fetch the 4 texels directly when no wrapping is needed
+	const TexelArray<T> &l = *singleMap;
+	if (l.Inside(s0, t0, s0 + 1, t0 + 1))
+		return luxrays::Lerp(ds,
+			luxrays::Lerp(dt, l(s0, t0).GetRGBAColor(),
+			l(s0, t0 + 1).GetRGBAColor()),
+			luxrays::Lerp(dt, l(s0 + 1, t0).GetRGBAColor(),
+			l(s0 + 1, t0 + 1).GetRGBAColor()));
 	return luxrays::Lerp(ds,
 		luxrays::Lerp(dt, Texel(s0, t0), Texel(s0, t0 + 1)),
 		luxrays::Lerp(dt, Texel(s0 + 1, t0),	Texel(s0 + 1, t0 + 1)));
@@ -738,18 +1083,25 @@ float MIPMapFastImpl<T>::EWA(Channel channel, float s, float t,
 	// Scan over ellipse bound and compute quadratic equation
 	float num = 0.f;
 	float den = 0.f;
+	// Texels of footprints inside the level are read without wrapping
+	const TexelArray<T> &l = *pyramid[level];
+	const bool inside = l.Inside(s0, t0, s1, t1);
+	float weights[4];
 	for (int it = t0; it <= t1; ++it) {
 		const float tt = it - t;
-		for (int is = s0; is <= s1; ++is) {
-			const float ss = is - s;
-			// Compute squared radius and filter texel if inside ellipse
-			const float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
-			if (r2 < 1.f) {
-				const float weight =
-					weightLut[min(luxrays::Float2Int(r2 *
-					WEIGHT_LUT_SIZE), WEIGHT_LUT_SIZE - 1)];
-				num += Texel(channel, level, is, it) * weight;
-				den += weight;
+		for (int is = s0; is <= s1; is += 4) {
+			// Compute the weights of 4 texels at once
+			if (!EWAWeights(A, B, C, s, tt, is, weights))
+				continue;
+			const int n = min(4, s1 - is + 1);
+			for (int i = 0; i < n; ++i) {
+				if (weights[i] == 0.f)
+					continue;
+				if (inside)
+					num += l(is + i, it).GetFloat(channel) * weights[i];
+				else
+					num += Texel(channel, level, is + i, it) * weights[i];
+				den += weights[i];
 			}
 		}
 	}
@@ -787,25 +1139,33 @@ SWCSpectrum MIPMapFastImpl<T>::EWA(const SpectrumWavelengths &sw,
 	B *= invF;
 	C *= invF;
 	// Scan over ellipse bound and compute quadratic equation
+	TexelSpectrumSum<T> sum(sw);
 	SWCSpectrum num(0.f);
 	float den = 0.f;
+	// Texels of footprints inside the level are read without wrapping
+	const TexelArray<T> &l = *pyramid[level];
+	const bool inside = l.Inside(s0, t0, s1, t1);
+	float weights[4];
 	for (int it = t0; it <= t1; ++it) {
 		const float tt = it - t;
-		for (int is = s0; is <= s1; ++is) {
-			const float ss = is - s;
-			// Compute squared radius and filter texel if inside ellipse
-			const float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
-			if (r2 < 1.f) {
-				const float weight =
-					weightLut[min(luxrays::Float2Int(r2 *
-					WEIGHT_LUT_SIZE), WEIGHT_LUT_SIZE - 1)];
-				num += Texel(sw, level, is, it) * weight;
-				den += weight;
+		for (int is = s0; is <= s1; is += 4) {
+			// Compute the weights of 4 texels at once
+			if (!EWAWeights(A, B, C, s, tt, is, weights))
+				continue;
+			const int n = min(4, s1 - is + 1);
+			for (int i = 0; i < n; ++i) {
+				if (weights[i] == 0.f)
+					continue;
+				if (inside)
+					sum.Add(l(is + i, it), weights[i]);
+				else
+					num += Texel(sw, level, is + i, it) * weights[i];
+				den += weights[i];
 			}
 		}
 	}
 
-	return num / den;
+	return (num + sum.GetSpectrum()) / den;
 }
 template <class T>
 RGBAColor MIPMapFastImpl<T>::EWA(float s, float t,
@@ -839,18 +1199,25 @@ RGBAColor MIPMapFastImpl<T>::EWA(float s, float t,
 	// Scan over ellipse bound and compute quadratic equation
 	float num = 0.f;
 	float den = 0.f;
+	// Texels of footprints inside the level are read without wrapping
+	const TexelArray<T> &l = *pyramid[level];
+	const bool inside = l.Inside(s0, t0, s1, t1);
+	float weights[4];
 	for (int it = t0; it <= t1; ++it) {
 		const float tt = it - t;
-		for (int is = s0; is <= s1; ++is) {
-			const float ss = is - s;
-			// Compute squared radius and filter texel if inside ellipse
-			const float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
-			if (r2 < 1.f) {
-				const float weight =
-					weightLut[min(luxrays::Float2Int(r2 *
-					WEIGHT_LUT_SIZE), WEIGHT_LUT_SIZE - 1)];
-				num += Texel(level, is, it) * weight;
-				den += weight;
+		for (int is = s0; is <= s1; is += 4) {
+			// Compute the weights of 4 texels at once
+			if (!EWAWeights(A, B, C, s, tt, is, weights))
+				continue;
+			const int n = min(4, s1 - is + 1);
+			for (int i = 0; i < n; ++i) {
+				if (weights[i] == 0.f)
+					continue;
+				if (inside)
+					num += l(is + i, it).GetRGBAColor() * weights[i];
+				else
+					num += Texel(level, is + i, it) * weights[i];
+				den += weights[i];
 			}
 		}
 	}
@@ -858,6 +1225,32 @@ RGBAColor MIPMapFastImpl<T>::EWA(float s, float t,
 	return num / den;
 }
 
+template <class T> template <class U>
+MIPMapFastImpl<T>::MIPMapFastImpl(const MIPMapFastImpl<U> *mipmap) :
+	MIPMap("MIPMapFastImpl-" + boost::lexical_cast<string>(this)),
+	filterType(mipmap->filterType), maxAnisotropy(mipmap->maxAnisotropy),
+	wrapMode(mipmap->wrapMode), nLevels(mipmap->nLevels), tiles(NULL)
+{
+	const u_int count = max(nLevels, 1U);
+	const TexelArray<U> * const *from = (nLevels == 0) ?
+		&mipmap->singleMap : mipmap->pyramid;
+	TexelArray<T> **levels;
+	if (nLevels > 0) {
+		pyramid = new TexelArray<T> *[nLevels];
+		levels = pyramid;
+	} else
+		levels = &singleMap;
+	// Texels are read through the source levels, which may be tiled
+	for (u_int i = 0; i < count; ++i) {
+		const TexelArray<U> &l = *from[i];
+		levels[i] = new TexelArray<T>(l.uSize(), l.vSize());
+		for (u_int t = 0; t < l.vSize(); ++t) {
+			for (u_int s = 0; s < l.uSize(); ++s)
+				(*levels[i])(s, t) = T(l(s, t));
+		}
+	}
+}
+
 template <class T>
 MIPMapFastImpl<T>::~MIPMapFastImpl()
 {
@@ -875,11 +1268,221 @@ MIPMapFastImpl<T>::~MIPMapFastImpl()
 		default:
 			LOG(LUX_ERROR, LUX_SYSTEM) << "Internal error in MIPMapFastImpl::~MIPMapFastImpl(), unknown filter type";
 	}
+	delete tiles;
+}
+
+template <class T>
+bool MIPMapFastImpl<T>::MoveToTextureCache(const boost::shared_ptr<TextureCache> &cache)
+{
+	if (tiles || !cache || !cache->IsEnabled())
+		return false;
+
+	const u_int count = max(nLevels, 1U);
+	TexelArray<T> **levels = (nLevels == 0) ? &singleMap : pyramid;
+	u_int tileCount = 0;
+	for (u_int i = 0; i < count; ++i)
+		tileCount += levels[i]->TileCount();
+
+	tiles = new TiledTexture(cache, tileCount, TexelArray<T>::TileSize());
+	u_int first = 0, i = 0;
+	for (; tiles->IsValid() && i < count; ++i) {
+		if (!levels[i]->MoveToTiles(tiles, first))
+			break;
+		first += levels[i]->TileCount();
+	}
+	if (i == 0) {
+		delete tiles;
+		tiles = NULL;
+		return false;
+	}
+	if (i < count)
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to write all the tiles, " <<
+			(count - i) << " levels stay in memory";
+
+	tiles->AddAttributes(*this);
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Moved " << first <<
+		" tiles to the texture cache";
+	return true;
+}
+
+template <class T>
+void MIPMapFastImpl<T>::ResampleS(const ResampleWeight *sWeights,
+	const T *img, T *resampledImage, u_int sres, u_int sPow2,
+	ImageWrap wrapMode, u_int t)
+{
+	for (u_int s = 0; s < sPow2; ++s) {
+		// Compute texel $(s,t)$ in $s$-zoomed image
+		resampledImage[t * sPow2 + s] = T();
+		// NOTE - Ratow - Offsetting weights to minimize possible over/underflows
+		for (int jo = 2; jo < 6; ++jo) {
+			const int j = jo % 4;
+
+			int origS = sWeights[s].firstTexel + j;
+			switch (wrapMode) {
+			case TEXTURE_REPEAT:
+				origS = luxrays::Mod(origS, static_cast<int>(sres));
+				break;
+			case TEXTURE_CLAMP:
+				origS = luxrays::Clamp(origS, 0, static_cast<int>(sres - 1));
+				break;
+			case TEXTURE_BLACK:
+			case TEXTURE_WHITE:
+				break;
+			}
+
+			if (origS >= 0 && origS < static_cast<int>(sres)) {
+				if (sWeights[s].weight[j] > 0.f)
+					resampledImage[t * sPow2 + s] += sWeights[s].weight[j] * img[t * sres + origS];
+				else // TextureColor cannot be negative so we invert and subtract
+					resampledImage[t * sPow2 + s] -= (-sWeights[s].weight[j]) * img[t * sres + origS];
+			}
+		}
+	}
+}
+
+template <class T>
+void MIPMapFastImpl<T>::ResampleT(const ResampleWeight *tWeights,
+	T *resampledImage, u_int tres, u_int sPow2, u_int tPow2,
+	ImageWrap wrapMode, u_int block)
+{
+	vector<T> workData(tPow2);
+	const u_int sEnd = min(sPow2, (block + 1) * MIPMAP_BUILD_BLOCK);
+	for (u_int s = block * MIPMAP_BUILD_BLOCK; s < sEnd; ++s) {
+		for (u_int t = 0; t < tPow2; ++t) {
+			workData[t] = T();
+			// NOTE - Ratow - Offsetting weights to minimize possible over/underflows
+			for (int jo = 2; jo < 6; ++jo) {
+				const int j = jo % 4;
+
+				int origT = tWeights[t].firstTexel + j;
+				switch (wrapMode) {
+				case TEXTURE_REPEAT:
+					origT = luxrays::Mod(origT, static_cast<int>(tres));
+					break;
+				case TEXTURE_CLAMP:
+					origT = luxrays::Clamp(origT, 0, static_cast<int>(tres - 1));
+					break;
+				case TEXTURE_BLACK:
+				case TEXTURE_WHITE:
+					break;
+				}
+
+				if (origT >= 0 && origT < static_cast<int>(tres)) {
+					if(tWeights[t].weight[j] > 0.f)
+						workData[t] += tWeights[t].weight[j] * resampledImage[origT * sPow2 + s];
+					else // TextureColor cannot be negative so we invert and subtract
+						workData[t] -= (-tWeights[t].weight[j]) * resampledImage[origT * sPow2 + s];
+				}
+			}
+		}
+		for (u_int t = 0; t < tPow2; ++t)
+			resampledImage[t * sPow2 + s] = workData[t].Clamp(0.f, INFINITY);
+	}
+}
+
+template <class T>
+void MIPMapFastImpl<T>::Downsample(const TexelArray<T> *finer,
+	TexelArray<T> *level, u_int block)
+{
+	const u_int sRes = level->uSize();
+	const u_int tEnd = min(level->vSize(), (block + 1) * MIPMAP_BUILD_BLOCK);
+	for (u_int t = block * MIPMAP_BUILD_BLOCK; t < tEnd; ++t) {
+		for (u_int s = 0; s < sRes; ++s) {
+			/* NOTE - Ratow - multiplying before summing all TextureColors because they can overflow */
+			(*level)(s, t) =
+				0.25f * (*finer)(2 * s, 2 * t) +
+				0.25f * (*finer)(2 * s + 1, 2 * t) +
+				0.25f * (*finer)(2 * s, 2 * t + 1) +
+				0.25f * (*finer)(2 * s + 1, 2 * t + 1);
+		}
+	}
+}
+
+template <class T>
+bool MIPMapFastImpl<T>::Write(std::ostream &os, MIPMapFile &file) const
+{
+	// Only texels in memory can be stored
+	if (tiles)
+		return false;
+
+	const u_int count = max(nLevels, 1U);
+	TexelArray<T> * const *levels = (nLevels == 0) ? &singleMap : pyramid;
+	file.texelSize = sizeof(T);
+	file.pyramid = nLevels > 0;
+	file.uRes.resize(count);
+	file.vRes.resize(count);
+	for (u_int i = 0; i < count; ++i) {
+		file.uRes[i] = levels[i]->uSize();
+		file.vRes[i] = levels[i]->vSize();
+	}
+	if (!file.Write(os))
+		return false;
+	for (u_int i = 0; i < count; ++i) {
+		if (!levels[i]->WriteTiles(os))
+			return false;
+	}
+	return true;
+}
+
+template <class T>
+MIPMapFastImpl<T>::MIPMapFastImpl(ImageTextureFilterType type,
+	const MIPMapFile &file, std::istream &is, const string &filename,
+	float maxAniso, ImageWrap wm,
+	const boost::shared_ptr<TextureCache> &cache) :
+	MIPMap("MIPMapFastImpl-" + boost::lexical_cast<string>(this)),
+	tiles(NULL)
+{
+	filterType = type;
+	maxAnisotropy = maxAniso;
+	wrapMode = wm;
+
+	// NOTE - the caller checks that the file has a pyramid for
+	// MIPMAP_TRILINEAR and MIPMAP_EWA, a single level otherwise
+	const u_int count = file.uRes.size();
+	TexelArray<T> **levels;
+	if (file.pyramid) {
+		nLevels = count;
+		pyramid = new TexelArray<T> *[nLevels];
+		levels = pyramid;
+	} else {
+		nLevels = 0;
+		levels = &singleMap;
+	}
+
+	// The file is paged directly, the tiles have the same layout
+	if (cache && cache->IsEnabled()) {
+		tiles = new TiledTexture(cache, filename, file.DataOffset(),
+			file.TileCount(), TexelArray<T>::TileSize());
+		if (!tiles->IsValid()) {
+			delete tiles;
+			tiles = NULL;
+		}
+	}
+
+	u_int first = 0;
+	for (u_int i = 0; i < count; ++i) {
+		if (tiles) {
+			levels[i] = new TexelArray<T>(file.uRes[i],
+				file.vRes[i], tiles, first);
+			first += levels[i]->TileCount();
+		} else {
+			levels[i] = new TexelArray<T>(file.uRes[i],
+				file.vRes[i]);
+			levels[i]->ReadTiles(is);
+		}
+	}
+	// NOTE - the caller discards the MIPMap if the stream failed
+	if (tiles) {
+		tiles->AddAttributes(*this);
+		LOG(LUX_DEBUG, LUX_NOERROR) << "Paging " << first <<
+			" tiles from '" << filename << "'";
+	}
 }
 
 template <class T>
 MIPMapFastImpl<T>::MIPMapFastImpl(ImageTextureFilterType type, u_int sres, u_int tres,
-	const T *img, float maxAniso, ImageWrap wm) : MIPMap("MIPMapFastImpl-" + boost::lexical_cast<string>(this))
+	const T *img, float maxAniso, ImageWrap wm) : MIPMap("MIPMapFastImpl-" + boost::lexical_cast<string>(this)),
+	tiles(NULL)
 {
 	filterType = type;
 	maxAnisotropy = maxAniso;
@@ -896,78 +1499,18 @@ MIPMapFastImpl<T>::MIPMapFastImpl(ImageTextureFilterType type, u_int sres, u_int
 				"Resampling image from " << sres << "x" <<
 				tres << " to " << sPow2 << "x" << tPow2;
 
-			// Resample image in $s$ direction
+			// Resample image in $s$ direction, one row at a time
 			struct ResampleWeight *sWeights = ResampleWeights(sres, sPow2);
 			resampledImage = new T[sPow2 * tPow2];
-
-			// Apply _sWeights_ to zoom in $s$ direction
-			for (u_int t = 0; t < tres; ++t) {
-				for (u_int s = 0; s < sPow2; ++s) {
-					// Compute texel $(s,t)$ in $s$-zoomed image
-					resampledImage[t * sPow2 + s] = T();
-					// NOTE - Ratow - Offsetting weights to minimize possible over/underflows
-					for (int jo = 2; jo < 6; ++jo) {
-						const int j = jo % 4;
-
-						int origS = sWeights[s].firstTexel + j;
-						switch (wrapMode) {
-						case TEXTURE_REPEAT:
-							origS = luxrays::Mod(origS, static_cast<int>(sres));
-							break;
-						case TEXTURE_CLAMP:
-							origS = luxrays::Clamp(origS, 0, static_cast<int>(sres - 1));
-							break;
-						case TEXTURE_BLACK:
-						case TEXTURE_WHITE:
-							break;
-						}
-
-						if (origS >= 0 && origS < static_cast<int>(sres)) {
-							if (sWeights[s].weight[j] > 0.f)
-								resampledImage[t * sPow2 + s] += sWeights[s].weight[j] * img[t * sres + origS];
-							else // TextureColor cannot be negative so we invert and subtract
-								resampledImage[t * sPow2 + s] -= (-sWeights[s].weight[j]) * img[t * sres + origS];
-						}
-					}
-				}
-			}
+			osParallelFor(tres, boost::bind(&MIPMapFastImpl<T>::ResampleS,
+				sWeights, img, resampledImage, sres, sPow2, wrapMode, _1));
 			delete[] sWeights;
 
-			// Resample image in $t$ direction
+			// Resample image in $t$ direction, by blocks of columns
 			struct ResampleWeight *tWeights = ResampleWeights(tres, tPow2);
-			T *workData = new T[tPow2];
-			for (u_int s = 0; s < sPow2; ++s) {
-				for (u_int t = 0; t < tPow2; ++t) {
-					workData[t] = T();
-					// NOTE - Ratow - Offsetting weights to minimize possible over/underflows
-					for (int jo = 2; jo < 6; ++jo) {
-						const int j = jo % 4;
-
-						int origT = tWeights[t].firstTexel + j;
-						switch (wrapMode) {
-						case TEXTURE_REPEAT:
-							origT = luxrays::Mod(origT, static_cast<int>(tres));
-							break;
-						case TEXTURE_CLAMP:
-							origT = luxrays::Clamp(origT, 0, static_cast<int>(tres - 1));
-							break;
-						case TEXTURE_BLACK:
-						case TEXTURE_WHITE:
-							break;
-						}
-
-						if (origT >= 0 && origT < static_cast<int>(tres)) {
-							if(tWeights[t].weight[j] > 0.f)
-								workData[t] += tWeights[t].weight[j] * resampledImage[origT * sPow2 + s];
-							else // TextureColor cannot be negative so we invert and subtract
-								workData[t] -= (-tWeights[t].weight[j]) * resampledImage[origT * sPow2 + s];
-						}
-					}
-				}
-				for (u_int t = 0; t < tPow2; ++t)
-					resampledImage[t * sPow2 + s] = workData[t].Clamp(0.f, INFINITY);
-			}
-			delete[] workData;
+			osParallelFor((sPow2 + MIPMAP_BUILD_BLOCK - 1) / MIPMAP_BUILD_BLOCK,
+				boost::bind(&MIPMapFastImpl<T>::ResampleT, tWeights,
+				resampledImage, tres, sPow2, tPow2, wrapMode, _1));
 			delete[] tWeights;
 			img = resampledImage;
 
@@ -981,45 +1524,29 @@ MIPMapFastImpl<T>::MIPMapFastImpl(ImageTextureFilterType type, u_int sres, u_int
 		LOG(LUX_INFO, LUX_NOERROR) << "Generating " << nLevels <<
 			" mipmap levels";
 
-		pyramid = new luxrays::BlockedArray<T> *[this->nLevels];
+		pyramid = new TexelArray<T> *[this->nLevels];
 		// Initialize most detailed level of MIPMap
-		pyramid[0] = new luxrays::BlockedArray<T>(sres, tres, img);
+		pyramid[0] = new TexelArray<T>(sres, tres, img);
 		for (u_int i = 1; i < nLevels; ++i) {
 			// Initialize $i$th MIPMap level from $i-1$st level
 			const u_int sRes = max<u_int>(1,
 				pyramid[i - 1]->uSize() / 2);
 			const u_int tRes = max<u_int>(1,
 				pyramid[i - 1]->vSize() / 2);
-			pyramid[i] = new luxrays::BlockedArray<T>(sRes, tRes);
-			// Filter four texels from finer level of pyramid
-			for (u_int t = 0; t < tRes; ++t) {
-				for (u_int s = 0; s < sRes; ++s) {
-					/* NOTE - Ratow - multiplying before summing all TextureColors because they can overflow */
-					(*pyramid[i])(s, t) =
-						0.25f * (*pyramid[i - 1])(2 * s, 2 * t) +
-						0.25f * (*pyramid[i - 1])(2 * s + 1, 2 * t) +
-						0.25f * (*pyramid[i - 1])(2 * s, 2 * t + 1) +
-						0.25f * (*pyramid[i - 1])(2 * s + 1, 2 * t + 1);
-				}
-			}
+			pyramid[i] = new TexelArray<T>(sRes, tRes);
+			// Filter four texels from finer level of pyramid,
+			// by blocks of rows
+			osParallelFor((tRes + MIPMAP_BUILD_BLOCK - 1) / MIPMAP_BUILD_BLOCK,
+				boost::bind(&MIPMapFastImpl<T>::Downsample,
+				pyramid[i - 1], pyramid[i], _1));
 		}
 		if (resampledImage)
 			delete[] resampledImage;
-
-		// Initialize EWA filter weights if needed
-		if (!weightLut) {
-			weightLut = luxrays::AllocAligned<float>(WEIGHT_LUT_SIZE);
-			for (u_int i = 0; i < WEIGHT_LUT_SIZE; ++i) {
-				const float alpha = 2.f;
-				const float r2 = static_cast<float>(i) / static_cast<float>(WEIGHT_LUT_SIZE - 1);
-				weightLut[i] = expf(-alpha * r2) - expf(-alpha);
-			}
-		}
 		break;
 	}
 	case BILINEAR:
 	case NEAREST:
-		singleMap = new luxrays::BlockedArray<T>(sres, tres, img);
+		singleMap = new TexelArray<T>(sres, tres, img);
 		nLevels = 0;
 		break;
 	default:
@@ -1030,7 +1557,7 @@ MIPMapFastImpl<T>::MIPMapFastImpl(ImageTextureFilterType type, u_int sres, u_int
 template <class T>
 float MIPMapFastImpl<T>::Texel(Channel channel, u_int level, int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *pyramid[level];
+	const TexelArray<T> &l = *pyramid[level];
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1057,7 +1584,7 @@ template <class T>
 SWCSpectrum MIPMapFastImpl<T>::Texel(const SpectrumWavelengths &sw, u_int level,
 	int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *pyramid[level];
+	const TexelArray<T> &l = *pyramid[level];
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1083,7 +1610,7 @@ SWCSpectrum MIPMapFastImpl<T>::Texel(const SpectrumWavelengths &sw, u_int level,
 template <class T>
 RGBAColor MIPMapFastImpl<T>::Texel(u_int level, int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *pyramid[level];
+	const TexelArray<T> &l = *pyramid[level];
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1110,7 +1637,7 @@ RGBAColor MIPMapFastImpl<T>::Texel(u_int level, int s, int t) const
 template <class T>
 float MIPMapFastImpl<T>::Texel(Channel channel, int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *singleMap;
+	const TexelArray<T> &l = *singleMap;
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1137,7 +1664,7 @@ template <class T>
 SWCSpectrum MIPMapFastImpl<T>::Texel(const SpectrumWavelengths &sw,
 	int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *singleMap;
+	const TexelArray<T> &l = *singleMap;
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1163,7 +1690,7 @@ SWCSpectrum MIPMapFastImpl<T>::Texel(const SpectrumWavelengths &sw,
 template <class T>
 RGBAColor MIPMapFastImpl<T>::Texel(int s, int t) const
 {
-	const luxrays::BlockedArray<T> &l = *singleMap;
+	const TexelArray<T> &l = *singleMap;
 	// Compute texel $(s,t)$ accounting for boundary conditions
 	switch (wrapMode) {
 		case TEXTURE_REPEAT:
@@ -1189,7 +1716,7 @@ RGBAColor MIPMapFastImpl<T>::Texel(int s, int t) const
 
 template <class T>
 void MIPMapFastImpl<T>::GetMinMaxFloat(Channel channel, float *minValue, float *maxValue) const {
-	const luxrays::BlockedArray<T> &map = (nLevels == 0) ? *singleMap : *pyramid[0];
+	const TexelArray<T> &map = (nLevels == 0) ? *singleMap : *pyramid[0];
 	float minv = INFINITY;
 	float maxv = -INFINITY;
 	for (u_int t = 0; t < map.vSize(); ++t) {
@@ -1212,7 +1739,22 @@ public:
 		float s = 1.f, float g = 1.f) :
 		MIPMapFastImpl<T>(type, xres, yres, data, maxAniso, wrapMode),
 		gain(s), gamma(g) { };
+	MIPMapImpl(ImageTextureFilterType type, const MIPMapFile &file,
+		std::istream &is, const string &filename, float maxAniso,
+		ImageWrap wrapMode, const boost::shared_ptr<TextureCache> &cache,
+		float s = 1.f, float g = 1.f) :
+		MIPMapFastImpl<T>(type, file, is, filename, maxAniso, wrapMode,
+		cache), gain(s), gamma(g) { };
+	template <class U> MIPMapImpl(const MIPMapFastImpl<U> *mipmap,
+		float s, float g) : MIPMapFastImpl<T>(mipmap),
+		gain(s), gamma(g) { };
 	virtual ~MIPMapImpl() { }
+	virtual MIPMap *Compress() const {
+		typedef typename CompressedTexel<T>::Type C;
+		if (sizeof(C) >= sizeof(T))
+			return NULL;
+		return new MIPMapImpl<C>(this, gain, gamma);
+	}
 	virtual float LookupFloat(Channel channel, float s, float t,
 		float width = 0.f) const {
 		return powf(gain * MIPMapFastImpl<T>::LookupFloat(channel, s, t,
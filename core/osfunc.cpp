@@ -22,15 +22,26 @@
 
 #include "osfunc.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #ifdef WIN32
 #include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
 #else
 
 #ifdef __linux__
 #include <sys/sysinfo.h>
+#include <unistd.h>
+#include <cstdio>
 #elif defined(__APPLE__) || defined(__FreeBSD__)
 #include <sys/types.h>
 #include <sys/sysctl.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
 #elif defined(__sun)
 #include <unistd.h>
 #endif
@@ -135,6 +146,85 @@ uint32_t osReadLittleEndianUInt(bool isLittleEndian,
 	return osReadLittleEndian<uint32_t>(isLittleEndian, is);
 }
 
+size_t osProcessMemoryUsage()
+{
+#if defined(WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#elif defined(__linux__)
+	// Second field of statm is the resident set size in pages
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (!statm)
+		return 0;
+	unsigned long size, resident;
+	const bool ok = fscanf(statm, "%lu %lu", &size, &resident) == 2;
+	fclose(statm);
+	return ok ? static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+		reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+		return 0;
+	return info.resident_size;
+#else
+	return 0;
+#endif
+}
+
+// Extra worker threads currently running, concurrent and nested users
+// only get the cores left idle
+static unsigned int workerThreads = 0;
+static boost::mutex workerMutex;
+
+unsigned int osAcquireWorkers(unsigned int wanted)
+{
+	const unsigned int cores = std::max(1U, boost::thread::hardware_concurrency());
+	boost::mutex::scoped_lock lock(workerMutex);
+	if (workerThreads + 1 >= cores)
+		return 0;
+	const unsigned int granted = std::min(cores - 1 - workerThreads, wanted);
+	workerThreads += granted;
+	return granted;
+}
+
+void osReleaseWorkers(unsigned int count)
+{
+	if (count == 0)
+		return;
+	boost::mutex::scoped_lock lock(workerMutex);
+	workerThreads -= count;
+}
+
+static void ParallelForThread(const boost::function<void (unsigned int)> *body,
+	unsigned int count, unsigned int *next)
+{
+	for (;;) {
+		const unsigned int i = osAtomicInc(next);
+		if (i >= count)
+			break;
+		(*body)(i);
+	}
+}
+
+void osParallelFor(unsigned int count,
+	const boost::function<void (unsigned int)> &body)
+{
+	const unsigned int extra = count > 1 ? osAcquireWorkers(count - 1) : 0;
+
+	unsigned int next = 0;
+	boost::thread_group threads;
+	for (unsigned int i = 0; i < extra; ++i)
+		threads.create_thread(boost::bind(ParallelForThread, &body,
+			count, &next));
+	ParallelForThread(&body, count, &next);
+	threads.join_all();
+
+	osReleaseWorkers(extra);
+}
+
 namespace fpdebug
 {
 
@@ -28,6 +28,7 @@ using boost::int32_t;
 using boost::uint32_t;
 #include <istream>
 #include <ostream>
+#include <boost/function.hpp>
 
 #if defined(__linux__) || defined(__APPLE__) || defined(__CYGWIN__)
 #include <stddef.h>
@@ -83,6 +84,23 @@ extern void osWriteLittleEndianUInt(bool isLittleEndian,
 extern uint32_t osReadLittleEndianUInt(bool isLittleEndian,
 		std::basic_istream<char> &is);
 
+// Resident memory of the process in bytes, 0 where it is not available
+extern size_t osProcessMemoryUsage();
+
+// Budget of extra worker threads shared by all the scene loading work
+// (parallel loops, image map builds, primitive refinement and scene file
+// parsing), so that running together they start at most one thread per
+// idle core. Returns the number of extra threads granted, at most wanted
+// and possibly 0, the calling thread is never counted. The granted
+// threads have to be released once they are done.
+extern unsigned int osAcquireWorkers(unsigned int wanted);
+extern void osReleaseWorkers(unsigned int count);
+
+// Calls body for every index in [0, count) from the calling thread and
+// from extra threads on the idle cores, returns once all calls are done
+extern void osParallelFor(unsigned int count,
+	const boost::function<void (unsigned int)> &body);
+
 inline double osWallClockTime() {
 #if defined(__linux__) || defined(__APPLE__) || defined(__CYGWIN__)
 	struct timeval t;
@@ -157,6 +175,17 @@ inline void osAtomicWrite(unsigned int *val, unsigned int newVal) {
 	atomic_write32(reinterpret_cast<uint32_t*>(val), static_cast<uint32_t>(newVal));
 }
 
+/**
+ * Full memory barrier, orders the memory accesses of lock free readers
+ */
+inline void osMemoryBarrier() {
+#if defined(WIN32)
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
 // Floating point exception debuging
 // Currently only works on linux
 // You can use disable/enable at anypoint on your code, if DEBUGFP is defined,
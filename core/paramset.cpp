@@ -25,6 +25,8 @@
 #include "error.h"
 #include "context.h"
 #include "textures/constant.h"
+#include "tigerhash.h"
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -94,26 +96,38 @@ template <class T> inline void AddParamType(vector<ParamSetItem<T> *> &vec,
 	EraseParamType(vec, name);
 	vec.push_back(new ParamSetItem<T>(name, data, nItems));
 }
-template <class T> inline const T *LookupPtr(const vector<ParamSetItem<T> *> &vec,
-	const string &name, u_int *nItems)
+template <class T> inline void AddParamType(vector<ParamSetItem<T> *> &vec,
+	const string &name, const T *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
 {
-	for (u_int i = 0; i < vec.size(); ++i)
-		if (vec[i]->name == name) {
-			*nItems = vec[i]->nItems;
-			vec[i]->lookedUp = true;
-			return vec[i]->data;
-		}
-	return NULL;
+	EraseParamType(vec, name);
+	vec.push_back(new ParamSetItem<T>(name, data, nItems, owner));
 }
-template <class T> inline const T &LookupOne(const vector<ParamSetItem<T> *> &vec,
-	const string &name, const T &d)
+template <class T> inline void AddParamItems(vector<ParamSetItem<T> *> &vec,
+	const vector<ParamSetItem<T> *> &items)
 {
-	for (u_int i = 0; i < vec.size(); ++i)
-		if (vec[i]->name == name && vec[i]->nItems == 1) {
-			vec[i]->lookedUp = true;
-			return *(vec[i]->data);
-		}
-	return d;
+	for (u_int i = 0; i < items.size(); ++i) {
+		ParamSetItem<T> *item = items[i]->Clone();
+		EraseParamType(vec, item->name);
+		vec.push_back(item);
+	}
+}
+template <class T> inline const T *LookupPtr(const ParamSetItem<T> *item,
+	u_int *nItems)
+{
+	if (!item)
+		return NULL;
+	*nItems = item->nItems;
+	item->lookedUp = true;
+	return item->data;
+}
+template <class T> inline const T &LookupOne(const ParamSetItem<T> *item,
+	const T &d)
+{
+	if (!item || item->nItems != 1)
+		return d;
+	item->lookedUp = true;
+	return *(item->data);
 }
 template <class T> inline void CheckUnused(const vector<ParamSetItem<T> *> &vec)
 {
@@ -125,9 +139,14 @@ template <class T> inline void CheckUnused(const vector<ParamSetItem<T> *> &vec)
 template <class T> inline void MarkAsUsed(const vector<ParamSetItem<T> *> &vec, const vector<ParamSetItem<T> *> &vecOther)
 {
 	for (u_int i = 0; i < vecOther.size(); ++i) {
-		if (vecOther[i]->lookedUp) {
-			u_int n;
-			LookupPtr(vec, vecOther[i]->name, &n);
+		if (!vecOther[i]->lookedUp)
+			continue;
+		for (u_int j = 0; j < vec.size(); ++j) {
+			if (vec[j]->nameHash == vecOther[i]->nameHash &&
+				vec[j]->name == vecOther[i]->name) {
+				vec[j]->lookedUp = true;
+				break;
+			}
 		}
 	}
 }
@@ -137,45 +156,106 @@ template <class T> inline void MarkAllUsed(const vector<ParamSetItem<T> *> &vec)
 		vec[i]->lookedUp = true;
 }
 
-// ParamSet Methods
-template <> ParamSetItem<int>::~ParamSetItem()
+template <class T> inline bool ItemNameLess(const ParamSetItem<T> *a,
+	const ParamSetItem<T> *b)
 {
-	delete[] data;
+	return a->name < b->name;
 }
-
-template <> ParamSetItem<bool>::~ParamSetItem()
+// Items sorted by name, so that the digest doesn't depend on the order
+// the parameters were given in
+template <class T> inline vector<const ParamSetItem<T> *> SortedItems(
+	const vector<ParamSetItem<T> *> &vec)
 {
-	delete[] data;
+	vector<const ParamSetItem<T> *> sorted(vec.begin(), vec.end());
+	std::sort(sorted.begin(), sorted.end(), ItemNameLess<T>);
+	return sorted;
 }
-
-template <> ParamSetItem<float>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<Point>::~ParamSetItem()
+template <class T> inline void HashParams(tigerhash &hasher,
+	const vector<ParamSetItem<T> *> &items, const string &skip,
+	size_t *nBytes)
 {
-	delete[] data;
+	const vector<const ParamSetItem<T> *> vec(SortedItems(items));
+	for (u_int i = 0; i < vec.size(); ++i) {
+		const ParamSetItem<T> *item = vec[i];
+		if (item->name == skip)
+			continue;
+		// Hash the name and size too so that splitting the same data
+		// differently between parameters gives a different digest
+		hasher.update(item->name.c_str(), item->name.length() + 1);
+		hasher.update(reinterpret_cast<const char *>(&item->nItems),
+			sizeof(item->nItems));
+		const size_t size = item->nItems * sizeof(T);
+		hasher.update(reinterpret_cast<const char *>(item->data), size);
+		*nBytes += size;
+	}
 }
-
-template <> ParamSetItem<Vector>::~ParamSetItem()
+inline void HashParams(tigerhash &hasher,
+	const vector<ParamSetItem<string> *> &items, const string &skip,
+	size_t *nBytes)
 {
-	delete[] data;
+	const vector<const ParamSetItem<string> *> vec(SortedItems(items));
+	for (u_int i = 0; i < vec.size(); ++i) {
+		const ParamSetItem<string> *item = vec[i];
+		if (item->name == skip)
+			continue;
+		hasher.update(item->name.c_str(), item->name.length() + 1);
+		hasher.update(reinterpret_cast<const char *>(&item->nItems),
+			sizeof(item->nItems));
+		for (u_int j = 0; j < item->nItems; ++j) {
+			hasher.update(item->data[j].c_str(),
+				item->data[j].length() + 1);
+			*nBytes += item->data[j].length();
+		}
+	}
 }
 
-template <> ParamSetItem<Normal>::~ParamSetItem()
+// ParamSet Methods
+template <class T> void ParamSet::IndexItems(
+	const vector<ParamSetItem<T> *> &vec, ParamType type)
 {
-	delete[] data;
+	IndexEntry entry;
+	entry.type = type;
+	for (u_int i = 0; i < vec.size(); ++i) {
+		entry.hash = vec[i]->nameHash;
+		entry.position = i;
+		index.push_back(entry);
+	}
 }
-
-template <> ParamSetItem<RGBColor>::~ParamSetItem()
+void ParamSet::BuildIndex()
 {
-	delete[] data;
-}
-
-template <> ParamSetItem<string>::~ParamSetItem()
+	index.clear();
+	index.reserve(ints.size() + bools.size() + floats.size() +
+		points.size() + vectors.size() + normals.size() +
+		spectra.size() + strings.size() + textures.size());
+	IndexItems(ints, PARAM_TYPE_INT);
+	IndexItems(bools, PARAM_TYPE_BOOL);
+	IndexItems(floats, PARAM_TYPE_FLOAT);
+	IndexItems(points, PARAM_TYPE_POINT);
+	IndexItems(vectors, PARAM_TYPE_VECTOR);
+	IndexItems(normals, PARAM_TYPE_NORMAL);
+	IndexItems(spectra, PARAM_TYPE_COLOR);
+	IndexItems(strings, PARAM_TYPE_STRING);
+	IndexItems(textures, PARAM_TYPE_TEXTURE);
+	std::sort(index.begin(), index.end());
+}
+template <class T> ParamSetItem<T> *ParamSet::LookupItem(
+	const vector<ParamSetItem<T> *> &vec, ParamType type,
+	const string &name) const
 {
-	delete[] data;
+	if (vec.empty())
+		return NULL;
+	IndexEntry key;
+	key.hash = ParamNameHash(name);
+	key.type = type;
+	key.position = 0;
+	for (vector<IndexEntry>::const_iterator it = std::lower_bound(index.begin(),
+		index.end(), key); it != index.end() && it->hash == key.hash &&
+		it->type == type; ++it) {
+		// Names are still compared in case of hash collision
+		if (vec[it->position]->name == name)
+			return vec[it->position];
+	}
+	return NULL;
 }
 
 ParamSet::ParamSet(const ParamSet &p2) {
@@ -1095,162 +1175,237 @@ ParamSet &ParamSet::operator=(const ParamSet &p2) {
 			strings.push_back(p2.strings[i]->Clone());
 		for (u_int i = 0; i < p2.textures.size(); ++i)
 			textures.push_back(p2.textures[i]->Clone());
+		BuildIndex();
 	}
 	return *this;
 }
 
 void ParamSet::Add(const ParamSet &params) {
-	for (u_int i = 0; i < params.ints.size(); ++i)
-		AddInt(params.ints[i]->name, params.ints[i]->data, params.ints[i]->nItems);
-	for (u_int i = 0; i < params.bools.size(); ++i)
-		AddBool(params.bools[i]->name, params.bools[i]->data, params.bools[i]->nItems);
-	for (u_int i = 0; i < params.floats.size(); ++i)
-		AddFloat(params.floats[i]->name, params.floats[i]->data, params.floats[i]->nItems);
-	for (u_int i = 0; i < params.points.size(); ++i)
-		AddPoint(params.points[i]->name, params.points[i]->data, params.points[i]->nItems);
-	for (u_int i = 0; i < params.vectors.size(); ++i)
-		AddVector(params.vectors[i]->name, params.vectors[i]->data, params.vectors[i]->nItems);
-	for (u_int i = 0; i < params.normals.size(); ++i)
-		AddNormal(params.normals[i]->name, params.normals[i]->data, params.normals[i]->nItems);
-	for (u_int i = 0; i < params.spectra.size(); ++i)
-		AddRGBColor(params.spectra[i]->name, params.spectra[i]->data, params.spectra[i]->nItems);
-	for (u_int i = 0; i < params.strings.size(); ++i)
-		AddString(params.strings[i]->name, params.strings[i]->data, params.strings[i]->nItems);
-	for (u_int i = 0; i < params.textures.size(); ++i)
-		AddTexture(params.textures[i]->name, *(params.textures[i]->data));
+	// The values are shared, not copied
+	AddParamItems(ints, params.ints);
+	AddParamItems(bools, params.bools);
+	AddParamItems(floats, params.floats);
+	AddParamItems(points, params.points);
+	AddParamItems(vectors, params.vectors);
+	AddParamItems(normals, params.normals);
+	AddParamItems(spectra, params.spectra);
+	AddParamItems(strings, params.strings);
+	AddParamItems(textures, params.textures);
+	BuildIndex();
 }
 
 void ParamSet::AddFloat(const string &name, const float *data, u_int nItems)
 {
 	AddParamType(floats, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddInt(const string &name, const int *data, u_int nItems)
 {
 	AddParamType(ints, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddBool(const string &name, const bool *data, u_int nItems)
 {
 	AddParamType(bools, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddPoint(const string &name, const Point *data, u_int nItems)
 {
 	AddParamType(points, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddVector(const string &name, const Vector *data, u_int nItems)
 {
 	AddParamType(vectors, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddNormal(const string &name, const Normal *data, u_int nItems)
 {
 	AddParamType(normals, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddRGBColor(const string &name, const RGBColor *data, u_int nItems)
 {
 	AddParamType(spectra, name, data, nItems);
+	BuildIndex();
 }
 void ParamSet::AddString(const string &name, const string *data, u_int nItems)
 {
 	AddParamType(strings, name, data, nItems);
+	BuildIndex();
+}
+void ParamSet::AddFloat(const string &name, const float *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(floats, name, data, nItems, owner);
+	BuildIndex();
+}
+void ParamSet::AddInt(const string &name, const int *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(ints, name, data, nItems, owner);
+	BuildIndex();
+}
+void ParamSet::AddPoint(const string &name, const Point *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(points, name, data, nItems, owner);
+	BuildIndex();
+}
+void ParamSet::AddVector(const string &name, const Vector *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(vectors, name, data, nItems, owner);
+	BuildIndex();
+}
+void ParamSet::AddNormal(const string &name, const Normal *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(normals, name, data, nItems, owner);
+	BuildIndex();
+}
+void ParamSet::AddRGBColor(const string &name, const RGBColor *data, u_int nItems,
+	const boost::shared_ptr<const void> &owner)
+{
+	AddParamType(spectra, name, data, nItems, owner);
+	BuildIndex();
 }
 void ParamSet::AddTexture(const string &name, const string &value)
 {
 	AddParamType(textures, name, &value, 1);
+	BuildIndex();
 }
 bool ParamSet::EraseInt(const string &n) {
-	return EraseParamType(ints, n);
+	const bool erased = EraseParamType(ints, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseBool(const string &n) {
-	return EraseParamType(bools, n);
+	const bool erased = EraseParamType(bools, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseFloat(const string &n) {
-	return EraseParamType(floats, n);
+	const bool erased = EraseParamType(floats, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::ErasePoint(const string &n) {
-	return EraseParamType(points, n);
+	const bool erased = EraseParamType(points, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseVector(const string &n) {
-	return EraseParamType(vectors, n);
+	const bool erased = EraseParamType(vectors, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseNormal(const string &n) {
-	return EraseParamType(normals, n);
+	const bool erased = EraseParamType(normals, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseRGBColor(const string &n) {
-	return EraseParamType(spectra, n);
+	const bool erased = EraseParamType(spectra, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseString(const string &n) {
-	return EraseParamType(strings, n);
+	const bool erased = EraseParamType(strings, n);
+	BuildIndex();
+	return erased;
 }
 bool ParamSet::EraseTexture(const string &n) {
-	return EraseParamType(textures, n);
+	const bool erased = EraseParamType(textures, n);
+	BuildIndex();
+	return erased;
 }
 float ParamSet::FindOneFloat(const string &name, float d) const
 {
-	return LookupOne(floats, name, d);
+	return LookupOne(LookupItem(floats, PARAM_TYPE_FLOAT, name), d);
 }
 const float *ParamSet::FindFloat(const string &name, u_int *nItems) const
 {
-	return LookupPtr(floats, name, nItems);
+	return LookupPtr(LookupItem(floats, PARAM_TYPE_FLOAT, name), nItems);
 }
 const int *ParamSet::FindInt(const string &name, u_int *nItems) const
 {
-	return LookupPtr(ints, name, nItems);
+	return LookupPtr(LookupItem(ints, PARAM_TYPE_INT, name), nItems);
 }
 const bool *ParamSet::FindBool(const string &name, u_int *nItems) const
 {
-	return LookupPtr(bools, name, nItems);
+	return LookupPtr(LookupItem(bools, PARAM_TYPE_BOOL, name), nItems);
 }
 int ParamSet::FindOneInt(const string &name, int d) const
 {
-	return LookupOne(ints, name, d);
+	return LookupOne(LookupItem(ints, PARAM_TYPE_INT, name), d);
 }
 bool ParamSet::FindOneBool(const string &name, bool d) const
 {
-	return LookupOne(bools, name, d);
+	return LookupOne(LookupItem(bools, PARAM_TYPE_BOOL, name), d);
 }
 const Point *ParamSet::FindPoint(const string &name, u_int *nItems) const
 {
-	return LookupPtr(points, name, nItems);
+	return LookupPtr(LookupItem(points, PARAM_TYPE_POINT, name), nItems);
 }
 const Point &ParamSet::FindOnePoint(const string &name, const Point &d) const
 {
-	return LookupOne(points, name, d);
+	return LookupOne(LookupItem(points, PARAM_TYPE_POINT, name), d);
 }
 const Vector *ParamSet::FindVector(const string &name, u_int *nItems) const
 {
-	return LookupPtr(vectors, name, nItems);
+	return LookupPtr(LookupItem(vectors, PARAM_TYPE_VECTOR, name), nItems);
 }
 const Vector &ParamSet::FindOneVector(const string &name, const Vector &d) const
 {
-	return LookupOne(vectors, name, d);
+	return LookupOne(LookupItem(vectors, PARAM_TYPE_VECTOR, name), d);
 }
 const Normal *ParamSet::FindNormal(const string &name, u_int *nItems) const
 {
-	return LookupPtr(normals, name, nItems);
+	return LookupPtr(LookupItem(normals, PARAM_TYPE_NORMAL, name), nItems);
 }
 const Normal &ParamSet::FindOneNormal(const string &name, const Normal &d) const
 {
-	return LookupOne(normals, name, d);
+	return LookupOne(LookupItem(normals, PARAM_TYPE_NORMAL, name), d);
 }
 const RGBColor *ParamSet::FindRGBColor(const string &name, u_int *nItems) const
 {
-	return LookupPtr(spectra, name, nItems);
+	return LookupPtr(LookupItem(spectra, PARAM_TYPE_COLOR, name), nItems);
 }
 const RGBColor &ParamSet::FindOneRGBColor(const string &name, const RGBColor &d) const
 {
-	return LookupOne(spectra, name, d);
+	return LookupOne(LookupItem(spectra, PARAM_TYPE_COLOR, name), d);
 }
 const string *ParamSet::FindString(const string &name, u_int *nItems) const
 {
-	return LookupPtr(strings, name, nItems);
+	return LookupPtr(LookupItem(strings, PARAM_TYPE_STRING, name), nItems);
 }
 const string &ParamSet::FindOneString(const string &name, const string &d) const
 {
-	return LookupOne(strings, name, d);
+	return LookupOne(LookupItem(strings, PARAM_TYPE_STRING, name), d);
 }
 const string &ParamSet::FindTexture(const string &name) const
 {
 	static const string empty("");
-	return LookupOne(textures, name, empty);
+	return LookupOne(LookupItem(textures, PARAM_TYPE_TEXTURE, name), empty);
+}
+vector<string> ParamSet::GetTextureNames() const
+{
+	vector<string> names;
+	for (u_int i = 0; i < textures.size(); ++i) {
+		for (u_int j = 0; j < textures[i]->nItems; ++j)
+			names.push_back(textures[i]->data[j]);
+	}
+	return names;
+}
+vector<string> ParamSet::GetStringValues() const
+{
+	vector<string> values;
+	for (u_int i = 0; i < strings.size(); ++i) {
+		for (u_int j = 0; j < strings[i]->nItems; ++j)
+			values.push_back(strings[i]->data[j]);
+	}
+	return values;
 }
 void ParamSet::MarkAllUsed() const {
 	// Marks all params as used
@@ -1287,7 +1442,36 @@ void ParamSet::ReportUnused() const {
 	CheckUnused(strings);
 	CheckUnused(textures);
 }
+string ParamSet::Digest(const string &skip, size_t *nBytes) const {
+	tigerhash hasher;
+	size_t size = 0;
+	// Each type is tagged so that equal payloads of different types
+	// don't collide
+	const char tags[] = "ibfpvncst";
+	hasher.update(tags + 0, 1);
+	HashParams(hasher, ints, skip, &size);
+	hasher.update(tags + 1, 1);
+	HashParams(hasher, bools, skip, &size);
+	hasher.update(tags + 2, 1);
+	HashParams(hasher, floats, skip, &size);
+	hasher.update(tags + 3, 1);
+	HashParams(hasher, points, skip, &size);
+	hasher.update(tags + 4, 1);
+	HashParams(hasher, vectors, skip, &size);
+	hasher.update(tags + 5, 1);
+	HashParams(hasher, normals, skip, &size);
+	hasher.update(tags + 6, 1);
+	HashParams(hasher, spectra, skip, &size);
+	hasher.update(tags + 7, 1);
+	HashParams(hasher, strings, skip, &size);
+	hasher.update(tags + 8, 1);
+	HashParams(hasher, textures, skip, &size);
+	if (nBytes)
+		*nBytes = size;
+	return digest_string(hasher.end_message());
+}
 void ParamSet::Clear() {
+	index.clear();
 	DelParams(ints);
 	DelParams(bools);
 	DelParams(floats);
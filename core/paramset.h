@@ -27,6 +27,9 @@
 #include "api.h"
 
 #include <boost/serialization/split_member.hpp>
+#include <boost/checked_delete.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <map>
 using std::map;
@@ -43,23 +46,38 @@ typedef enum { PARAM_TYPE_INT, PARAM_TYPE_BOOL, PARAM_TYPE_FLOAT,
 	PARAM_TYPE_POINT, PARAM_TYPE_VECTOR, PARAM_TYPE_NORMAL,
 	PARAM_TYPE_COLOR, PARAM_TYPE_STRING, PARAM_TYPE_TEXTURE } ParamType;
 bool LookupType(const char *token, ParamType *type, string &name);
+inline size_t ParamNameHash(const string &name) {
+	return boost::hash<string>()(name);
+}
 
 // ParamSet Declarations
 template <class T> struct ParamSetItem {
 	// ParamSetItem Public Methods
 	
+	// The values are immutable so clones share them
 	ParamSetItem<T> *Clone() const {
-		return new ParamSetItem<T>(name, data, nItems);
+		return new ParamSetItem<T>(name, nameHash, data, nItems, owner);
 	}
-	ParamSetItem() { data=0; }
+	ParamSetItem() : nameHash(0), nItems(0), data(NULL), lookedUp(false) { }
 	// The const_cast forces a copy of the string data
 	ParamSetItem(const string &n, const T *v, u_int ni = 1) :
-		name(const_cast<string &>(n)), nItems(ni), lookedUp(false) {
-		data = new T[nItems];
+		name(const_cast<string &>(n)), nameHash(ParamNameHash(n)),
+		nItems(ni), lookedUp(false) {
+		T *values = new T[nItems];
 		for (u_int i = 0; i < nItems; ++i)
-			data[i] = v[i];
+			values[i] = v[i];
+		data = values;
+		owner.reset(values, boost::checked_array_deleter<T>());
 	}
-	~ParamSetItem();
+	// The values are not copied, they are kept alive by o
+	ParamSetItem(const string &n, const T *v, u_int ni,
+		const boost::shared_ptr<const void> &o) :
+		name(const_cast<string &>(n)), nameHash(ParamNameHash(n)),
+		nItems(ni), data(v), owner(o), lookedUp(false) { }
+	ParamSetItem(const string &n, size_t h, const T *v, u_int ni,
+		const boost::shared_ptr<const void> &o) :
+		name(const_cast<string &>(n)), nameHash(h), nItems(ni),
+		data(v), owner(o), lookedUp(false) { }
 	
 	template<class Archive>
 	void save(Archive & ar, const unsigned int version) const {
@@ -75,12 +93,13 @@ template <class T> struct ParamSetItem {
 	template<class Archive>
 	void load(Archive & ar, const unsigned int version) {
 		ar & name;
+		nameHash = ParamNameHash(name);
 		ar & nItems;
-		if(data!=0)
-			delete[] data;
-		data=new T[nItems];
+		T *values = new T[nItems];
 		for (u_int i = 0; i < nItems; ++i)
-			ar & data[i];
+			ar & values[i];
+		data = values;
+		owner.reset(values, boost::checked_array_deleter<T>());
 
 		ar & lookedUp;
 	}
@@ -88,8 +107,12 @@ template <class T> struct ParamSetItem {
 	
 	// ParamSetItem Data
 	string name;
+	// Computed once so that lookups only compare hashes
+	size_t nameHash;
 	u_int nItems;
-	T *data;
+	const T *data;
+	// Owner of the values, shared by the clones
+	boost::shared_ptr<const void> owner;
 	mutable bool lookedUp;
 };
 class LUX_EXPORT ParamSet {
@@ -113,6 +136,20 @@ public:
 	void AddRGBColor(const string &, const RGBColor *, u_int nItems = 1);
 	void AddString(const string &, const string *, u_int nItems = 1);
 	void AddTexture(const string &, const string &);
+	// Add the values without copying them, they must not be modified
+	// as long as owner is alive. Copies of the ParamSet share owner.
+	void AddFloat(const string &, const float *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
+	void AddInt(const string &, const int *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
+	void AddPoint(const string &, const Point *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
+	void AddVector(const string &, const Vector *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
+	void AddNormal(const string &, const Normal *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
+	void AddRGBColor(const string &, const RGBColor *, u_int nItems,
+		const boost::shared_ptr<const void> &owner);
 	bool EraseInt(const string &);
 	bool EraseBool(const string &);
 	bool EraseFloat(const string &);
@@ -140,6 +177,10 @@ public:
 	const Normal *FindNormal(const string &, u_int *nItems) const;
 	const RGBColor *FindRGBColor(const string &, u_int *nItems) const;
 	const string *FindString(const string &, u_int *nItems) const;
+	// Names of the textures referenced by the texture parameters
+	vector<string> GetTextureNames() const;
+	// Values of the string parameters
+	vector<string> GetStringValues() const;
 	boost::shared_ptr<Texture<SWCSpectrum> >
 		GetSWCSpectrumTexture(const string &name,
 		const RGBColor &def) const;
@@ -158,8 +199,30 @@ public:
 	}
 	void Clear();
 	string ToString() const;
+	// Returns the tiger hash of all the parameter values except the ones
+	// named skip, in hexadecimal form, nBytes receives the hashed size.
+	// The order the parameters were added in doesn't matter
+	string Digest(const string &skip, size_t *nBytes = NULL) const;
 
 private:
+	// Entry of the lookup index, sorted by name hash then type
+	struct IndexEntry {
+		bool operator<(const IndexEntry &e) const {
+			return hash < e.hash || (hash == e.hash &&
+				(type < e.type || (type == e.type &&
+				position < e.position)));
+		}
+		size_t hash;
+		ParamType type;
+		u_int position;
+	};
+	template <class T> void IndexItems(const vector<ParamSetItem<T> *> &vec,
+		ParamType type);
+	template <class T> ParamSetItem<T> *LookupItem(
+		const vector<ParamSetItem<T> *> &vec, ParamType type,
+		const string &name) const;
+	void BuildIndex();
+
 	// ParamSet Data
 	vector<ParamSetItem<int> *> ints;
 	vector<ParamSetItem<bool> *> bools;
@@ -170,6 +233,9 @@ private:
 	vector<ParamSetItem<RGBColor> *> spectra;
 	vector<ParamSetItem<string> *> strings;
 	vector<ParamSetItem<string> *> textures;
+	// Rebuilt by every modification, so that concurrent lookups only
+	// read it
+	vector<IndexEntry> index;
 	
 	template<class Archive>
 		void serialize(Archive & ar, const unsigned int version)
@@ -183,6 +249,8 @@ private:
 			ar & spectra;
 			ar & strings;
 			ar & textures;
+			if (Archive::is_loading::value)
+				BuildIndex();
 		}
 	
 };
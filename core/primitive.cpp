@@ -24,9 +24,14 @@
 #include "primitive.h"
 #include "light.h"
 #include "material.h"
+#include "texture.h"
+#include "osfunc.h"
 
 #include "luxrays/core/geometry/motionsystem.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 using namespace luxrays;
 using namespace lux;
 
@@ -38,6 +43,54 @@ void Primitive::Refine(vector<boost::shared_ptr<Primitive> > &refined,
 	LOG( LUX_SEVERE,LUX_BUG)<< "Unimplemented Primitive::Refine method called!";
 }
 
+static void RefinePrimitivesThread(
+	const vector<boost::shared_ptr<Primitive> > *prims,
+	vector<vector<boost::shared_ptr<Primitive> > > *refined,
+	const PrimitiveRefinementHints *refineHints, u_int *next)
+{
+	for (;;) {
+		const u_int i = osAtomicInc(next);
+		if (i >= prims->size())
+			break;
+		const boost::shared_ptr<Primitive> &p((*prims)[i]);
+		try {
+			if (p->CanIntersect())
+				(*refined)[i].push_back(p);
+			else
+				p->Refine((*refined)[i], *refineHints, p);
+		} catch (std::exception &e) {
+			LOG(LUX_SEVERE, LUX_BUG) << "Error while refining primitive #" << i << ": " << e.what();
+		}
+	}
+}
+
+void lux::RefinePrimitives(const vector<boost::shared_ptr<Primitive> > &prims,
+	vector<boost::shared_ptr<Primitive> > &refined,
+	const PrimitiveRefinementHints &refineHints)
+{
+	// Each source primitive gets its own output slot, the slots are
+	// concatenated afterwards to keep the declaration order
+	vector<vector<boost::shared_ptr<Primitive> > > slots(prims.size());
+	u_int next = 0;
+	// The calling thread refines too, along with the idle cores
+	const u_int extra = prims.size() > 1 ?
+		osAcquireWorkers(prims.size() - 1) : 0;
+	boost::thread_group threads;
+	for (u_int i = 0; i < extra; ++i)
+		threads.create_thread(boost::bind(RefinePrimitivesThread,
+			&prims, &slots, &refineHints, &next));
+	RefinePrimitivesThread(&prims, &slots, &refineHints, &next);
+	threads.join_all();
+	osReleaseWorkers(extra);
+
+	size_t count = refined.size();
+	for (size_t i = 0; i < slots.size(); ++i)
+		count += slots[i].size();
+	refined.reserve(count);
+	for (size_t i = 0; i < slots.size(); ++i)
+		refined.insert(refined.end(), slots[i].begin(), slots[i].end());
+}
+
 bool Primitive::Intersect(const Ray &r, Intersection *in) const
 {
 	LOG( LUX_SEVERE,LUX_BUG)<< "Unimplemented Primitive::Intersect method called!";
@@ -79,6 +132,8 @@ float Primitive::Sample(float u1, float u2, float u3,
 BSDF *Intersection::GetBSDF(MemoryArena &arena, const SpectrumWavelengths &sw,
 	const Ray &ray) const
 {
+	// Share texture evaluations between the components of the material
+	TextureEvaluationCache::Scope textureScope;
 	DifferentialGeometry dgShading;
 	primitive->GetShadingGeometry(ObjectToWorld, dg,
 		&dgShading);
@@ -158,6 +213,17 @@ void InstancePrimitive::GetShadingInformation(const DifferentialGeometry &dgShad
 	dgShading.ihandle->GetShadingInformation(dgShading, color, alpha);
 }
 
+void InstancePrimitive::ReplaceMaterial(const Material *from,
+	const boost::shared_ptr<Material> &to)
+{
+	if (material.get() == from)
+		material = to;
+	// The sources are shared between all instances of an object, each
+	// one will be visited several times but only replaced once
+	for (u_int i = 0; i < instanceSources.size(); ++i)
+		instanceSources[i]->ReplaceMaterial(from, to);
+}
+
 // MotionPrimitive Method Definitions
 bool MotionPrimitive::Intersect(const Ray &r, Intersection *isect) const
 {
@@ -208,3 +274,12 @@ BBox MotionPrimitive::WorldBound() const
 {
 	return motionPath.Bound(instance->WorldBound(), false);
 }
+
+void MotionPrimitive::ReplaceMaterial(const Material *from,
+	const boost::shared_ptr<Material> &to)
+{
+	if (material.get() == from)
+		material = to;
+	for (u_int i = 0; i < instanceSources.size(); ++i)
+		instanceSources[i]->ReplaceMaterial(from, to);
+}
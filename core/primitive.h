@@ -197,6 +197,16 @@ public:
 	 * @return The primitive local to world transform
 	 */
 	virtual Transform GetLocalToWorld(float time) const = 0;
+
+	/**
+	 * Replaces a material by another one in this primitive and the
+	 * primitives it references. It is used to edit a scene while it is
+	 * being rendered, so it must only be called when no ray is traced.
+	 * @param from The material to replace.
+	 * @param to   The new material.
+	 */
+	virtual void ReplaceMaterial(const Material *from,
+		const boost::shared_ptr<Material> &to) { }
 };
 
 class PrimitiveRefinementHints {
@@ -211,6 +221,20 @@ public:
 	const bool forSampling;
 };
 
+/**
+ * Refines a list of primitives until all of them can be intersected.
+ * Primitives are independent from each other so the work is spread over
+ * all available cores. The refined primitives are appended to refined in
+ * the same order as their source primitives, so the result does not depend
+ * on thread scheduling.
+ * @param prims       The primitives to refine.
+ * @param refined     The destination for the refined primitives.
+ * @param refineHints The hints passed to each Primitive::Refine call.
+ */
+void RefinePrimitives(const vector<boost::shared_ptr<Primitive> > &prims,
+	vector<boost::shared_ptr<Primitive> > &refined,
+	const PrimitiveRefinementHints &refineHints);
+
 class Intersection {
 public:
 	// Intersection Public Methods
@@ -325,6 +349,11 @@ public:
 		return prim->GetLocalToWorld(time);
 	}
 
+	virtual void ReplaceMaterial(const Material *from,
+		const boost::shared_ptr<Material> &to) {
+		prim->ReplaceMaterial(from, to);
+	}
+
 private:
 	// AreaLightPrimitive Private Data
 	boost::shared_ptr<Primitive> prim;
@@ -415,8 +444,17 @@ public:
 		return InstanceToWorld * instance->GetLocalToWorld(time);
 	}
 
+	virtual void ReplaceMaterial(const Material *from,
+		const boost::shared_ptr<Material> &to);
+
 	const vector<boost::shared_ptr<Primitive> > &GetInstanceSources() const { return instanceSources; }
 	const Transform &GetTransform() const { return InstanceToWorld; }
+	/**
+	 * Moves the instance, the aggregate containing it must be rebuilt
+	 * afterwards.
+	 * @param i2w The new instance to world transformation.
+	 */
+	void SetTransform(const Transform &i2w) { InstanceToWorld = i2w; }
 	Material *GetMaterial() const { return material.get(); }
 
 private:
@@ -526,6 +564,9 @@ public:
 		return Transform(motionPath.Sample(time)) * instance->GetLocalToWorld(time);
 	}
 
+	virtual void ReplaceMaterial(const Material *from,
+		const boost::shared_ptr<Material> &to);
+
 	const vector<boost::shared_ptr<Primitive> > &GetInstanceSources() const { return instanceSources; }
 	Material *GetMaterial() const { return material.get(); }
 	const MotionSystem &GetMotionSystem() const { return motionPath; } 
@@ -141,6 +141,25 @@ public:
 	 */
 	virtual void Terminate() = 0;
 
+	/*! \brief Suspend the rendering so that the scene can be edited.
+	 *
+	 * Must be thread-safe. Can be called if in one of the following
+	 * states: PAUSE, RUN, once the preprocessing is done. Returns only
+	 * when no rendering thread uses the scene anymore, or false if the
+	 * Renderer doesn't support scene edits yet or has no rendering thread
+	 * running. Change the state to PAUSE.
+	 */
+	virtual bool BeginSceneEdit() { return false; }
+
+	/*! \brief Restart the rendering after a scene edit.
+	 *
+	 * Must be thread-safe. Can be called only after a successful
+	 * BeginSceneEdit(). Contributions computed before the edit are
+	 * discarded and the rendering threads pick up the new camera.
+	 * Restore the state from before BeginSceneEdit().
+	 */
+	virtual void EndSceneEdit() { }
+
 	RendererStatistics* rendererStatistics;
 };
 
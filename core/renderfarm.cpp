@@ -211,7 +211,32 @@ const RenderFarm::CompiledFile& RenderFarm::CompiledFiles::fromHash(filehash_t h
 	return files[it->second];
 }
 
-bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
+bool RenderFarm::CompiledFiles::sendIndex(std::iostream &stream) const {
+	LOG(LUX_DEBUG,LUX_NOERROR) << "Sending file index";
+	stream << "BEGIN FILE INDEX" << "\n";
+
+	if (!read_response(stream, "BEGIN FILE INDEX OK"))
+		return false;
+
+	LOG(LUX_DEBUG,LUX_NOERROR) << "File index size: " << files.size();
+	for (size_t i = 0; i < files.size(); ++i) {
+		stream << "file" << "\n"; // no parameter to replace
+		stream << files[i].filename() << "\n";
+		stream << files[i].hash() << "\n";
+		stream << "\n";
+	}
+
+	stream << "END FILE INDEX" << "\n";
+
+	if (!read_response(stream, "END FILE INDEX OK"))
+		return false;
+
+	LOG(LUX_DEBUG,LUX_NOERROR) << "File index sent ok";
+
+	return true;
+}
+
+bool RenderFarm::CompiledFiles::send(std::iostream &stream, ExtRenderingServerInfo &serverInfo) const {
 	LOG(LUX_DEBUG,LUX_NOERROR) << "Sending files";
 
 	stream << "BEGIN FILES" << "\n";
@@ -229,6 +254,15 @@ bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
 		if (hash == "END FILES")
 			break;
 
+		if (hash.compare(0, 11, "FILE CACHE ") == 0) {
+			std::istringstream stats(hash.substr(11));
+			stats >> serverInfo.fileCacheHits >> serverInfo.fileCacheLookups;
+			if (serverInfo.fileCacheLookups > 0)
+				LOG(LUX_INFO,LUX_NOERROR) << "Server file cache: " << serverInfo.fileCacheHits <<
+					" hits out of " << serverInfo.fileCacheLookups << " lookups";
+			continue;
+		}
+
 		LOG(LUX_DEBUG,LUX_NOERROR) << "File hash request: '" << hash << "'";
 
 		// TODO - catch exception in case of invalid hash
@@ -371,6 +405,7 @@ RenderFarm::RenderFarm(Context *c) : Queryable("render_farm"), ctx(c),
 	AddIntAttribute(*this, "pollingInterval", "Polling interval", &RenderFarm::pollingInterval, ReadWriteAccess);
 	AddIntAttribute(*this, "slaveNodeCount", "Number of network slave nodes", &RenderFarm::getSlaveNodeCount);
 	AddDoubleAttribute(*this, "updateTimeRemaining", "Time remaining until next update", &RenderFarm::getUpdateTimeRemaining);
+	AddDoubleAttribute(*this, "fileCacheHitRate", "Fraction of the scene files found in the slave node caches", &RenderFarm::getFileCacheHitRate);
 }
 
 RenderFarm::~RenderFarm()
@@ -455,6 +490,8 @@ bool RenderFarm::connect(ExtRenderingServerInfo &serverInfo) {
 	serverInfo.sid = "";
 	serverInfo.active = false;
 	serverInfo.flushed = false;
+	serverInfo.queued = false;
+	serverInfo.prefetched = false;
 
 	stringstream ss;
 	string serverName = serverInfo.name + ":" + serverInfo.port;
@@ -473,8 +510,10 @@ bool RenderFarm::connect(ExtRenderingServerInfo &serverInfo) {
 		}
 
 		LOG( LUX_INFO,LUX_NOERROR) << "Server connect result: " << result;
-		
-		if ("OK" != result) {
+
+		// A busy server may queue the session until it is done
+		const bool queued = (result == "QUEUED");
+		if ("OK" != result && !queued) {
 			LOG( LUX_ERROR,LUX_SYSTEM) << "Unable to connect server: " << serverName;
 
 			return false;
@@ -518,9 +557,12 @@ bool RenderFarm::connect(ExtRenderingServerInfo &serverInfo) {
 		}
 
 		LOG( LUX_INFO,LUX_NOERROR) << "Server session ID: " << sid;
+		if (queued)
+			LOG( LUX_INFO,LUX_NOERROR) << "Server is busy, session queued: " << serverName;
 
 		serverInfo.sid = sid;
-		serverInfo.active = true;
+		serverInfo.active = !queued;
+		serverInfo.queued = queued;
 	} catch (exception& e) {
 		LOG(LUX_ERROR,LUX_SYSTEM) << "Unable to connect server: " << serverName;
 		LOG(LUX_ERROR,LUX_SYSTEM)<< e.what();
@@ -551,6 +593,12 @@ RenderFarm::reconnect_status_t RenderFarm::reconnect(ExtRenderingServerInfo &ser
 		}
 
 		LOG( LUX_INFO,LUX_NOERROR) << "Server reconnect result: " << result;
+
+		if ("QUEUED" == result) {
+			// still waiting for the server
+			serverInfo.active = false;
+			return reconnect_status::queued;
+		}
 		
 		if ("CONNECTED" != result) {
 			// slave rejected reconnect attempt, signal by setting active to false
@@ -560,6 +608,16 @@ RenderFarm::reconnect_status_t RenderFarm::reconnect(ExtRenderingServerInfo &ser
 		}
 
 		serverInfo.active = true;
+
+		if (serverInfo.queued) {
+			// The queued session has started, it still needs the scene
+			LOG( LUX_INFO,LUX_NOERROR) << "Queued session started on server: " << serverName;
+			serverInfo.queued = false;
+			serverInfo.flushed = false;
+			serverInfo.timeLastSamples = boost::posix_time::second_clock::local_time();
+			return reconnect_status::success;
+		}
+
 		serverInfo.flushed = true;
 		
 		// Get the user sampling map from the film
@@ -778,6 +836,10 @@ void RenderFarm::flushImpl() {
 
 	//flush network buffer
 	for (size_t i = 0; i < serverInfoList.size(); i++) {
+		// Busy servers get the files while we wait for our session
+		if (serverInfoList[i].queued && !serverInfoList[i].prefetched)
+			prefetch(serverInfoList[i]);
+
 		if(serverInfoList[i].active && !serverInfoList[i].flushed) {
 			try {
 				LOG( LUX_INFO,LUX_NOERROR) << "Sending commands to server: " <<
@@ -795,7 +857,7 @@ void RenderFarm::flushImpl() {
 					if (!compiledCommands[j].sendFiles())
 						continue;
 
-					if (!compiledFiles.send(stream))
+					if (!compiledFiles.send(stream, serverInfoList[i]))
 						break;
 				}
 
@@ -821,6 +883,28 @@ void RenderFarm::flushImpl() {
 	}
 }
 
+void RenderFarm::prefetch(ExtRenderingServerInfo &serverInfo) {
+	if (compiledFiles.empty()) {
+		serverInfo.prefetched = true;
+		return;
+	}
+
+	try {
+		LOG( LUX_INFO,LUX_NOERROR) << "Sending files to queued session on server: " <<
+				serverInfo.name << ":" << serverInfo.port;
+
+		tcp::iostream stream(serverInfo.name, serverInfo.port);
+		stream.rdbuf()->set_option(tcp::no_delay(true));
+		stream << "ServerPrefetch" << "\n";
+		stream << serverInfo.sid << "\n";
+
+		if (compiledFiles.sendIndex(stream) && compiledFiles.send(stream, serverInfo))
+			serverInfo.prefetched = true;
+	} catch (exception& e) {
+		LOG(LUX_ERROR,LUX_SYSTEM)<< e.what();
+	}
+}
+
 void RenderFarm::flush() {
 	boost::mutex::scoped_lock lock(serverListMutex);
 
@@ -1366,6 +1450,18 @@ u_int RenderFarm::getSlaveNodeCount() {
 	return serverInfoList.size();
 }
 
+double RenderFarm::getFileCacheHitRate() {
+	boost::mutex::scoped_lock lock(serverListMutex);
+
+	u_int hits = 0, lookups = 0;
+	for (size_t i = 0; i < serverInfoList.size(); ++i) {
+		hits += serverInfoList[i].fileCacheHits;
+		lookups += serverInfoList[i].fileCacheLookups;
+	}
+
+	return lookups > 0 ? static_cast<double>(hits) / lookups : 0.;
+}
+
 u_int RenderFarm::getServersStatus(RenderingServerInfo *info, u_int maxInfoCount) const {
 	ptime now = second_clock::local_time();
 	for (size_t i = 0; i < min<size_t>(serverInfoList.size(), maxInfoCount); ++i) {
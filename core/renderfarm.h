@@ -132,7 +132,9 @@ private:
 			timeLastContact(boost::posix_time::second_clock::local_time()),
 			timeLastSamples(boost::posix_time::second_clock::local_time()),
 			numberOfSamplesReceived(0.0), calculatedSamplesPerSecond(0.0),
-			name(n), port(p), sid(id), active(false), flushed(false) { }
+			name(n), port(p), sid(id), active(false), flushed(false),
+			queued(false), prefetched(false), fileCacheHits(0),
+			fileCacheLookups(0) { }
 
 		// returns true if "other" has the same name and port
 		bool sameServer(const std::string &name, const std::string &port) const;
@@ -152,6 +154,15 @@ private:
 		bool active;
 
 		bool flushed;
+
+		// the server is busy and holds our session in its queue,
+		// it is not active until the session starts
+		bool queued;
+		// the scene files were uploaded to the queued session
+		bool prefetched;
+
+		// file cache statistics last reported by the server
+		u_int fileCacheHits, fileCacheLookups;
 	};
 
 	typedef std::string filehash_t;
@@ -188,7 +199,15 @@ private:
 		const CompiledFile& fromFilename(std::string filename) const;
 		const CompiledFile& fromHash(filehash_t hash) const;
 
-		bool send(std::iostream &stream) const;
+		bool empty() const {
+			return files.empty();
+		}
+
+		// Sends the index of all files
+		bool sendIndex(std::iostream &stream) const;
+		// Sends the files requested by the server, which reports
+		// its file cache statistics in serverInfo
+		bool send(std::iostream &stream, ExtRenderingServerInfo &serverInfo) const;
 
 	private:
 		std::vector<CompiledFile> files;
@@ -245,7 +264,7 @@ private:
 	};
 
 	struct reconnect_status {
-		enum type { error, rejected, success };
+		enum type { error, rejected, queued, success };
 	};
 	typedef reconnect_status::type reconnect_status_t;
 
@@ -254,11 +273,13 @@ private:
 	bool connect(ExtRenderingServerInfo &serverInfo);
 	reconnect_status_t reconnect(ExtRenderingServerInfo &serverInfo);
 	void flushImpl();
+	void prefetch(ExtRenderingServerInfo &serverInfo);
 	void disconnect(const ExtRenderingServerInfo &serverInfo);
 	void reconnectFailed();
 	void stopImpl();
 
 	u_int getSlaveNodeCount();
+	double getFileCacheHitRate();
 	void updateServerNoiseAwareMap(ExtRenderingServerInfo &serverInfo, const u_int size, const float *map);
 	void updateServerUserSamplingMap(ExtRenderingServerInfo &serverInfo, const u_int size, const float *map);
 
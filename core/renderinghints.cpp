@@ -28,6 +28,7 @@
 #include "bxdf.h"
 #include "sampling.h"
 #include "paramset.h"
+#include "loadprofiler.h"
 
 #include "luxrays/utils/mcdistribution.h"
 
@@ -326,8 +327,10 @@ void SurfaceIntegratorRenderingHints::InitParam(const ParamSet &params)
 
 void SurfaceIntegratorRenderingHints::InitStrategies(const Scene &scene) {
 	nLights = scene.lights.size();
-	if (lsStrategy != NULL)
+	if (lsStrategy != NULL) {
+		LoadPhase phase("preprocess.lights");
 		lsStrategy->Init(scene);
+	}
 }
 
 void SurfaceIntegratorRenderingHints::RequestSamples(Sampler *sampler, const Scene &scene, u_int maxDepth)
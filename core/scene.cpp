@@ -35,6 +35,8 @@
 #include "light.h"
 #include "luxrays/core/color/spectrumwavelengths.h"
 #include "transport.h"
+#include "context.h"
+#include "loadprofiler.h"
 
 #include <boost/bind.hpp>
 #include <boost/thread/mutex.hpp>
@@ -173,6 +175,31 @@ Scene::Scene(Camera *cam) :
 	scene_rand_mutex.unlock();
 }
 
+void Scene::SetReady()
+{
+	// Loading ends once the renderer is done preprocessing
+	LoadProfiler *profiler = Context::GetActiveLoadProfiler();
+	if (profiler && !ready)
+		profiler->EndLoad();
+	ready = true;
+}
+
+void Scene::SetCamera(Camera *cam)
+{
+	camera.SetCamera(cam);
+	bound = Union(aggregate->WorldBound(), camera()->Bounds());
+	if (volumeRegion)
+		bound = Union(bound, volumeRegion->WorldBound());
+}
+
+void Scene::SetAggregate(const boost::shared_ptr<Primitive> &accel)
+{
+	aggregate = accel;
+	bound = Union(aggregate->WorldBound(), camera()->Bounds());
+	if (volumeRegion)
+		bound = Union(bound, volumeRegion->WorldBound());
+}
+
 SWCSpectrum Scene::Li(const Ray &ray, const Sample &sample, float *alpha) const
 {
 //  NOTE - radiance - leave these off for now, should'nt be used (broken with multithreading)
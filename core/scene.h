@@ -133,12 +133,16 @@ public:
 	string GetDefaultStringParameterValue(luxComponent comp,
 		luxComponentParameters param, u_int index);
 
+	// Scene edits, they must only be done while no ray is traced
+	void SetCamera(Camera *cam);
+	void SetAggregate(const boost::shared_ptr<Primitive> &accel);
+
 	int DisplayInterval();
 	u_int FilmXres();
 	u_int FilmYres();
 
 	bool ready;
-	void SetReady() { ready = true; }
+	void SetReady();
 	bool IsReady() { return ready; }
 	bool IsFilmOnly() const { return filmOnly; }
 
@@ -158,6 +162,9 @@ public:
 	// The following data are used when tracing rays with LuxRays
 	// The list of original primitives. It is required by LuxRays to build the DataSet.
 	vector<boost::shared_ptr<Primitive> > primitives;
+	// The refined primitives the aggregate was built from, to rebuild
+	// it after an edit without refining everything again
+	vector<boost::shared_ptr<Primitive> > refinedPrimitives;
 	vector<const Primitive *> tessellatedPrimitives;
 	luxrays::DataSet *dataSet;
 
@@ -0,0 +1,945 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+// sceneparser.cpp*
+#include "sceneparser.h"
+#include "api.h"
+#include "context.h"
+#include "error.h"
+#include "osfunc.h"
+#include "paramset.h"
+#include "luxrays/core/color/color.h"
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+
+// Shared with the flex/bison parser for error reporting
+extern u_int lineNum;
+extern string currentFile;
+
+namespace lux
+{
+
+enum StatementType {
+	STMT_ACCELERATOR, STMT_AREALIGHTSOURCE, STMT_ATTRIBUTEBEGIN,
+	STMT_ATTRIBUTEEND, STMT_CAMERA, STMT_CONCATTRANSFORM,
+	STMT_COORDINATESYSTEM, STMT_COORDSYSTRANSFORM, STMT_EXTERIOR,
+	STMT_FILM, STMT_IDENTITY, STMT_INCLUDE, STMT_INTERIOR,
+	STMT_LIGHTGROUP, STMT_LIGHTSOURCE, STMT_LOOKAT, STMT_MATERIAL,
+	STMT_MAKENAMEDMATERIAL, STMT_MAKENAMEDVOLUME, STMT_MOTIONBEGIN,
+	STMT_MOTIONEND, STMT_NAMEDMATERIAL, STMT_OBJECTBEGIN, STMT_OBJECTEND,
+	STMT_OBJECTINSTANCE, STMT_PORTALINSTANCE, STMT_MOTIONINSTANCE,
+	STMT_PIXELFILTER, STMT_RENDERER, STMT_REVERSEORIENTATION, STMT_ROTATE,
+	STMT_SAMPLER, STMT_SEARCHPATH, STMT_SCALE, STMT_PORTALSHAPE,
+	STMT_SHAPE, STMT_SURFACEINTEGRATOR, STMT_TEXTURE, STMT_TRANSFORMBEGIN,
+	STMT_TRANSFORMEND, STMT_TRANSFORM, STMT_TRANSLATE, STMT_VOLUME,
+	STMT_VOLUMEINTEGRATOR, STMT_WORLDBEGIN, STMT_WORLDEND
+};
+
+// Statement arguments are described by one character each:
+// s - string, n - number, a - number or bracketed number array,
+// A - bracketed number array, p - parameter list
+struct StatementSyntax {
+	const char *keyword;
+	StatementType type;
+	const char *arguments;
+};
+
+static const StatementSyntax statementSyntax[] = {
+	{ "Accelerator", STMT_ACCELERATOR, "sp" },
+	{ "AreaLightSource", STMT_AREALIGHTSOURCE, "sp" },
+	{ "AttributeBegin", STMT_ATTRIBUTEBEGIN, "" },
+	{ "AttributeEnd", STMT_ATTRIBUTEEND, "" },
+	{ "Camera", STMT_CAMERA, "sp" },
+	{ "ConcatTransform", STMT_CONCATTRANSFORM, "a" },
+	{ "CoordinateSystem", STMT_COORDINATESYSTEM, "s" },
+	{ "CoordSysTransform", STMT_COORDSYSTRANSFORM, "s" },
+	{ "Exterior", STMT_EXTERIOR, "s" },
+	{ "Film", STMT_FILM, "sp" },
+	{ "Identity", STMT_IDENTITY, "" },
+	{ "Include", STMT_INCLUDE, "s" },
+	{ "Interior", STMT_INTERIOR, "s" },
+	{ "LightGroup", STMT_LIGHTGROUP, "sp" },
+	{ "LightSource", STMT_LIGHTSOURCE, "sp" },
+	{ "LookAt", STMT_LOOKAT, "nnnnnnnnn" },
+	{ "Material", STMT_MATERIAL, "sp" },
+	{ "MakeNamedMaterial", STMT_MAKENAMEDMATERIAL, "sp" },
+	{ "MakeNamedVolume", STMT_MAKENAMEDVOLUME, "ssp" },
+	{ "MotionBegin", STMT_MOTIONBEGIN, "a" },
+	{ "MotionEnd", STMT_MOTIONEND, "" },
+	{ "NamedMaterial", STMT_NAMEDMATERIAL, "s" },
+	{ "ObjectBegin", STMT_OBJECTBEGIN, "s" },
+	{ "ObjectEnd", STMT_OBJECTEND, "" },
+	{ "ObjectInstance", STMT_OBJECTINSTANCE, "s" },
+	{ "PortalInstance", STMT_PORTALINSTANCE, "s" },
+	{ "MotionInstance", STMT_MOTIONINSTANCE, "snns" },
+	{ "PixelFilter", STMT_PIXELFILTER, "sp" },
+	{ "Renderer", STMT_RENDERER, "sp" },
+	{ "ReverseOrientation", STMT_REVERSEORIENTATION, "" },
+	{ "Rotate", STMT_ROTATE, "nnnn" },
+	{ "Sampler", STMT_SAMPLER, "sp" },
+	{ "SearchPath", STMT_SEARCHPATH, "s" },
+	{ "Scale", STMT_SCALE, "nnn" },
+	{ "PortalShape", STMT_PORTALSHAPE, "sp" },
+	{ "Shape", STMT_SHAPE, "sp" },
+	{ "SurfaceIntegrator", STMT_SURFACEINTEGRATOR, "sp" },
+	{ "Texture", STMT_TEXTURE, "sssp" },
+	{ "TransformBegin", STMT_TRANSFORMBEGIN, "" },
+	{ "TransformEnd", STMT_TRANSFORMEND, "" },
+	{ "Transform", STMT_TRANSFORM, "A" },
+	{ "Translate", STMT_TRANSLATE, "nnn" },
+	{ "Volume", STMT_VOLUME, "sp" },
+	{ "VolumeIntegrator", STMT_VOLUMEINTEGRATOR, "sp" },
+	{ "WorldBegin", STMT_WORLDBEGIN, "" },
+	{ "WorldEnd", STMT_WORLDEND, "" }
+};
+
+static const StatementSyntax *LookupStatement(const char *begin,
+	const char *end)
+{
+	const size_t length = end - begin;
+	for (u_int i = 0; i < sizeof(statementSyntax) / sizeof(statementSyntax[0]); ++i) {
+		const char *keyword = statementSyntax[i].keyword;
+		if (strlen(keyword) == length &&
+			strncmp(keyword, begin, length) == 0)
+			return &statementSyntax[i];
+	}
+	return NULL;
+}
+
+// Decodes a number in [p, end) without going through the C library,
+// returns false if there is no valid number at p.
+// The decimal mantissa is accumulated in an integer and scaled by an
+// exact power of 10 which gives a correctly rounded result in the
+// common case, strtod is used for the remaining cases.
+static bool ParseNumber(const char *&p, const char *end, double *value,
+	bool *isInteger)
+{
+	static const double powersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char *s = p;
+	bool negative = false;
+	if (s < end && (*s == '+' || *s == '-')) {
+		negative = *s == '-';
+		++s;
+	}
+	boost::uint64_t mantissa = 0;
+	u_int digits = 0;
+	int exponent = 0;
+	bool truncated = false, anyDigit = false;
+	while (s < end && *s >= '0' && *s <= '9') {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*s - '0');
+			if (mantissa > 0)
+				++digits;
+		} else {
+			truncated = true;
+			++exponent;
+		}
+		anyDigit = true;
+		++s;
+	}
+	*isInteger = true;
+	if (s < end && *s == '.') {
+		*isInteger = false;
+		++s;
+		while (s < end && *s >= '0' && *s <= '9') {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*s - '0');
+				if (mantissa > 0)
+					++digits;
+				--exponent;
+			} else
+				truncated = true;
+			anyDigit = true;
+			++s;
+		}
+	}
+	if (!anyDigit)
+		return false;
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		const char *e = s + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '+' || *e == '-')) {
+			negativeExponent = *e == '-';
+			++e;
+		}
+		if (e < end && *e >= '0' && *e <= '9') {
+			*isInteger = false;
+			int exp10 = 0;
+			while (e < end && *e >= '0' && *e <= '9') {
+				if (exp10 < 10000)
+					exp10 = exp10 * 10 + (*e - '0');
+				++e;
+			}
+			exponent += negativeExponent ? -exp10 : exp10;
+			s = e;
+		}
+	}
+	if (!truncated && mantissa < (1ULL << 53) &&
+		exponent >= -22 && exponent <= 22) {
+		const double m = static_cast<double>(mantissa);
+		*value = exponent < 0 ? m / powersOf10[-exponent] :
+			m * powersOf10[exponent];
+		if (negative)
+			*value = -*value;
+	} else {
+		const string number(p, s);
+		*value = strtod(number.c_str(), NULL);
+	}
+	p = s;
+	return true;
+}
+
+class SceneTokenizer {
+public:
+	enum TokenType { TOKEN_EOF, TOKEN_IDENT, TOKEN_STRING, TOKEN_NUMBER,
+		TOKEN_LBRACK, TOKEN_RBRACK, TOKEN_ERROR };
+
+	SceneTokenizer(const string &file, const char *b, const char *e) :
+		filename(file), p(b), end(e), line(1) { }
+
+	// Returns the type of the next token without consuming it
+	TokenType Peek() {
+		SkipBlanks();
+		if (p >= end)
+			return TOKEN_EOF;
+		const char c = *p;
+		if (c == '"')
+			return TOKEN_STRING;
+		if (c == '[')
+			return TOKEN_LBRACK;
+		if (c == ']')
+			return TOKEN_RBRACK;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+			return TOKEN_IDENT;
+		if ((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+')
+			return TOKEN_NUMBER;
+		return TOKEN_ERROR;
+	}
+	// Consumes a bracket
+	void Skip() { ++p; }
+	// Counts the values up to the closing bracket, so that arrays can be
+	// allocated once with the right size
+	size_t CountArrayItems() const {
+		size_t count = 0;
+		bool inValue = false;
+		for (const char *c = p; c < end && *c != ']' && *c != '"'; ++c) {
+			if (*c == '#') {
+				while (c < end && *c != '\n')
+					++c;
+				inValue = false;
+				if (c == end)
+					break;
+			} else if (*c == ' ' || *c == '\t' || *c == '\r' ||
+				*c == '\n')
+				inValue = false;
+			else if (!inValue) {
+				inValue = true;
+				++count;
+			}
+		}
+		return count;
+	}
+	// Reads an identifier, returns its bounds
+	void ReadIdent(const char **b, const char **e) {
+		*b = p;
+		while (p < end && ((*p >= 'a' && *p <= 'z') ||
+			(*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') ||
+			*p == '_'))
+			++p;
+		*e = p;
+	}
+	bool ReadString(string *s);
+	bool ReadNumber(double *value, bool *isInteger) {
+		if (!ParseNumber(p, end, value, isInteger)) {
+			Error("Invalid number");
+			return false;
+		}
+		return true;
+	}
+	void Error(const string &message) const {
+		LOG(LUX_SEVERE,LUX_SYNTAX) << "Parsing error in file '" <<
+			filename << "' at line " << line << ": " << message;
+	}
+	u_int Line() const { return line; }
+
+private:
+	void SkipBlanks() {
+		while (p < end) {
+			const char c = *p;
+			if (c == '\n') {
+				++line;
+				++p;
+			} else if (c == ' ' || c == '\t' || c == '\r')
+				++p;
+			else if (c == '#') {
+				while (p < end && *p != '\n')
+					++p;
+			} else
+				break;
+		}
+	}
+
+	const string &filename;
+	const char *p, *end;
+	u_int line;
+};
+
+bool SceneTokenizer::ReadString(string *s)
+{
+	// Skip the opening quote
+	++p;
+	s->clear();
+	while (p < end) {
+		const char c = *p++;
+		if (c == '"')
+			return true;
+		if (c == '\n') {
+			Error("Unterminated string");
+			return false;
+		}
+		if (c != '\\' || p >= end) {
+			s->push_back(c);
+			continue;
+		}
+		const char escaped = *p++;
+		switch (escaped) {
+			case 'n': s->push_back('\n'); break;
+			case 't': s->push_back('\t'); break;
+			case 'r': s->push_back('\r'); break;
+			case 'b': s->push_back('\b'); break;
+			case 'f': s->push_back('\f'); break;
+			case '\n': ++line; break;
+			default:
+				if (escaped >= '0' && escaped <= '9' &&
+					end - p >= 2 && p[0] >= '0' && p[0] <= '9' &&
+					p[1] >= '0' && p[1] <= '9') {
+					s->push_back(static_cast<char>(((escaped - '0') * 100 +
+						(p[0] - '0') * 10 + (p[1] - '0')) & 0xff));
+					p += 2;
+				} else
+					s->push_back(escaped);
+				break;
+		}
+	}
+	Error("Unterminated string");
+	return false;
+}
+
+class SceneFile;
+
+struct Statement {
+	StatementType type;
+	u_int line;
+	vector<string> strings;
+	vector<float> numbers;
+	ParamSet params;
+	boost::shared_ptr<SceneFile> include;
+};
+
+class SceneFile {
+public:
+	SceneFile(const string &name, u_int d) : filename(name), depth(d),
+		direct(false), parsed(false), aborted(false), failed(false) { }
+	~SceneFile() {
+		// The file might still be parsed if the parent failed,
+		// wake the parser up in case it waits for room in the queue
+		if (thread) {
+			{
+				boost::mutex::scoped_lock lock(queueMutex);
+				aborted = true;
+			}
+			queueNotFull.notify_all();
+			thread->join();
+		}
+	}
+
+	// Parses the file in an additional thread if there is an idle core,
+	// otherwise the file is parsed by Execute
+	void Start();
+	// Sends the statements to the active context in file order as soon
+	// as they are parsed, returns false if the file cannot be read
+	// or has a syntax error
+	bool Execute();
+
+private:
+	bool Parse();
+	void ParseThread();
+	bool ParseStatements(SceneTokenizer &tokenizer);
+	bool ParseNumberArray(SceneTokenizer &tokenizer, vector<float> &numbers,
+		bool bracketRequired);
+	bool ParseParameters(SceneTokenizer &tokenizer, ParamSet &params);
+	void StartInclude(Statement &statement);
+	// Hands a parsed statement over to the executing thread,
+	// returns false if the parsing has to stop
+	bool Push(const boost::shared_ptr<Statement> &statement);
+	bool ExecuteStatement(Statement &s);
+
+	string filename;
+	u_int depth;
+	// The file is parsed by the thread that executes it
+	bool direct;
+	// Statements parsed but not executed yet, the parser waits when the
+	// queue is full so that the memory used doesn't grow with the file size
+	std::deque<boost::shared_ptr<Statement> > statements;
+	boost::mutex queueMutex;
+	boost::condition_variable queueNotEmpty, queueNotFull;
+	bool parsed, aborted;
+	boost::scoped_ptr<boost::thread> thread;
+	bool failed;
+
+	// Maximum number of statements waiting for execution
+	static const size_t maxQueuedStatements = 1024;
+};
+
+bool SceneFile::Parse()
+{
+	boost::iostreams::mapped_file_source file;
+	try {
+		// Empty files can't be mapped
+		if (boost::filesystem::file_size(filename) > 0)
+			file.open(filename);
+	} catch (std::exception &e) {
+		LOG(LUX_SEVERE,LUX_NOFILE) << "Unable to read scene file '" <<
+			filename << "': " << e.what();
+		return false;
+	}
+	const char *begin = file.is_open() ? file.data() : NULL;
+	SceneTokenizer tokenizer(filename, begin,
+		begin ? begin + file.size() : NULL);
+	if (!ParseStatements(tokenizer))
+		failed = true;
+	return true;
+}
+
+void SceneFile::ParseThread()
+{
+	try {
+		if (!Parse() && depth == 0)
+			failed = true;
+	} catch (std::exception &e) {
+		LOG(LUX_SEVERE,LUX_SYSTEM) << "Exception during parsing (file '" <<
+			filename << "'): " << e.what();
+		failed = true;
+	}
+	{
+		boost::mutex::scoped_lock lock(queueMutex);
+		parsed = true;
+	}
+	queueNotEmpty.notify_one();
+	osReleaseWorkers(1);
+}
+
+void SceneFile::Start()
+{
+	// Parse in a new thread as long as there are idle cores,
+	// the current thread keeps parsing its own file
+	if (osAcquireWorkers(1) > 0)
+		thread.reset(new boost::thread(boost::bind(&SceneFile::ParseThread,
+			this)));
+	else
+		direct = true;
+}
+
+void SceneFile::StartInclude(Statement &statement)
+{
+	if (depth >= 32) {
+		LOG(LUX_SEVERE,LUX_NESTING) <<
+			"Only 32 levels of nested Include allowed in scene files.";
+		return;
+	}
+	statement.include.reset(new SceneFile(statement.strings[0], depth + 1));
+	statement.include->Start();
+}
+
+bool SceneFile::Push(const boost::shared_ptr<Statement> &statement)
+{
+	if (direct)
+		return ExecuteStatement(*statement);
+	boost::mutex::scoped_lock lock(queueMutex);
+	while (statements.size() >= maxQueuedStatements && !aborted)
+		queueNotFull.wait(lock);
+	if (aborted)
+		return false;
+	statements.push_back(statement);
+	if (statements.size() == 1)
+		queueNotEmpty.notify_one();
+	return true;
+}
+
+bool SceneFile::ParseStatements(SceneTokenizer &tokenizer)
+{
+	for (;;) {
+		const SceneTokenizer::TokenType token = tokenizer.Peek();
+		if (token == SceneTokenizer::TOKEN_EOF)
+			return true;
+		if (token != SceneTokenizer::TOKEN_IDENT) {
+			tokenizer.Error("Statement expected");
+			return false;
+		}
+		const char *b, *e;
+		tokenizer.ReadIdent(&b, &e);
+		const StatementSyntax *syntax = LookupStatement(b, e);
+		if (!syntax) {
+			tokenizer.Error("Unknown statement '" + string(b, e) + "'");
+			return false;
+		}
+		boost::shared_ptr<Statement> parsedStatement(new Statement());
+		Statement &statement(*parsedStatement);
+		statement.type = syntax->type;
+		statement.line = tokenizer.Line();
+		for (const char *arg = syntax->arguments; *arg; ++arg) {
+			bool ok = false;
+			switch (*arg) {
+				case 's':
+					if (tokenizer.Peek() != SceneTokenizer::TOKEN_STRING) {
+						tokenizer.Error(string("String expected after ") +
+							syntax->keyword);
+						break;
+					}
+					statement.strings.push_back(string());
+					ok = tokenizer.ReadString(&statement.strings.back());
+					break;
+				case 'n': {
+					if (tokenizer.Peek() != SceneTokenizer::TOKEN_NUMBER) {
+						tokenizer.Error(string("Number expected after ") +
+							syntax->keyword);
+						break;
+					}
+					double value;
+					bool isInteger;
+					ok = tokenizer.ReadNumber(&value, &isInteger);
+					statement.numbers.push_back(static_cast<float>(value));
+					break;
+				}
+				case 'a':
+				case 'A':
+					ok = ParseNumberArray(tokenizer, statement.numbers,
+						*arg == 'A');
+					break;
+				case 'p':
+					ok = ParseParameters(tokenizer, statement.params);
+					break;
+			}
+			if (!ok)
+				return false;
+		}
+		if (statement.type == STMT_INCLUDE)
+			StartInclude(statement);
+		if (!Push(parsedStatement))
+			return false;
+	}
+}
+
+bool SceneFile::ParseNumberArray(SceneTokenizer &tokenizer,
+	vector<float> &numbers, bool bracketRequired)
+{
+	double value;
+	bool isInteger;
+	SceneTokenizer::TokenType token = tokenizer.Peek();
+	if (token == SceneTokenizer::TOKEN_NUMBER && !bracketRequired) {
+		if (!tokenizer.ReadNumber(&value, &isInteger))
+			return false;
+		numbers.push_back(static_cast<float>(value));
+		return true;
+	}
+	if (token != SceneTokenizer::TOKEN_LBRACK) {
+		tokenizer.Error("Number array expected");
+		return false;
+	}
+	tokenizer.Skip();
+	while ((token = tokenizer.Peek()) == SceneTokenizer::TOKEN_NUMBER) {
+		if (!tokenizer.ReadNumber(&value, &isInteger))
+			return false;
+		numbers.push_back(static_cast<float>(value));
+	}
+	if (token != SceneTokenizer::TOKEN_RBRACK) {
+		tokenizer.Error("Unterminated number array");
+		return false;
+	}
+	tokenizer.Skip();
+	return true;
+}
+
+template<class T> static const T *ArrayData(const vector<T> &v)
+{
+	return v.empty() ? NULL : &v[0];
+}
+
+bool SceneFile::ParseParameters(SceneTokenizer &tokenizer, ParamSet &params)
+{
+	string token, name, value;
+	vector<string> strings;
+	while (tokenizer.Peek() == SceneTokenizer::TOKEN_STRING) {
+		if (!tokenizer.ReadString(&token))
+			return false;
+		ParamType type;
+		const bool typed = LookupType(token.c_str(), &type, name);
+		// Values are decoded straight into an array of the target type
+		// which is then handed over to the ParamSet without copy
+		boost::shared_ptr<vector<float> > floatValues(new vector<float>);
+		boost::shared_ptr<vector<int> > intValues(new vector<int>);
+		vector<float> &floats(*floatValues);
+		vector<int> &ints(*intValues);
+		strings.clear();
+		bool numeric = false, singleString = false;
+		SceneTokenizer::TokenType t = tokenizer.Peek();
+		const bool bracket = t == SceneTokenizer::TOKEN_LBRACK;
+		if (bracket) {
+			tokenizer.Skip();
+			t = tokenizer.Peek();
+			if (t == SceneTokenizer::TOKEN_NUMBER) {
+				if (type == PARAM_TYPE_INT)
+					ints.reserve(tokenizer.CountArrayItems());
+				else
+					floats.reserve(tokenizer.CountArrayItems());
+			}
+		} else if (t == SceneTokenizer::TOKEN_STRING)
+			singleString = true;
+		else if (t != SceneTokenizer::TOKEN_NUMBER) {
+			tokenizer.Error("Value expected for parameter '" + token + "'");
+			return false;
+		}
+		if (t == SceneTokenizer::TOKEN_NUMBER) {
+			numeric = true;
+			do {
+				double number;
+				bool isInteger;
+				if (!tokenizer.ReadNumber(&number, &isInteger))
+					return false;
+				if (type == PARAM_TYPE_INT)
+					ints.push_back(isInteger ? static_cast<int>(number) :
+						static_cast<int>(static_cast<float>(number)));
+				else
+					floats.push_back(static_cast<float>(number));
+			} while (bracket &&
+				(t = tokenizer.Peek()) == SceneTokenizer::TOKEN_NUMBER);
+		} else if (t == SceneTokenizer::TOKEN_STRING) {
+			do {
+				if (!tokenizer.ReadString(&value))
+					return false;
+				strings.push_back(value);
+			} while (bracket &&
+				(t = tokenizer.Peek()) == SceneTokenizer::TOKEN_STRING);
+		}
+		if (bracket) {
+			if (t != SceneTokenizer::TOKEN_RBRACK) {
+				tokenizer.Error("Unterminated array for parameter '" +
+					token + "'");
+				return false;
+			}
+			tokenizer.Skip();
+		}
+
+		if (!typed) {
+			LOG( LUX_WARNING,LUX_SYNTAX)
+				<< "Type of parameter '" << token << "' is unknown";
+			continue;
+		}
+		if (singleString && type != PARAM_TYPE_TEXTURE &&
+			type != PARAM_TYPE_STRING && type != PARAM_TYPE_BOOL) {
+			LOG( LUX_WARNING,LUX_SYNTAX)
+				<< "Bad type for " << name << ". Changing it to a texture.";
+			type = PARAM_TYPE_TEXTURE;
+		}
+		const bool needsNumbers = type == PARAM_TYPE_INT ||
+			type == PARAM_TYPE_FLOAT || type == PARAM_TYPE_POINT ||
+			type == PARAM_TYPE_VECTOR || type == PARAM_TYPE_NORMAL ||
+			type == PARAM_TYPE_COLOR;
+		if (needsNumbers != numeric && (numeric || !strings.empty())) {
+			LOG( LUX_ERROR,LUX_SYNTAX) << "Bad values for parameter '" <<
+				token << "'. Ignoring it.";
+			continue;
+		}
+		switch (type) {
+			case PARAM_TYPE_INT:
+				params.AddInt(name, ArrayData(ints), ints.size(),
+					intValues);
+				break;
+			case PARAM_TYPE_BOOL: {
+				bool *bdata = new bool[strings.size()];
+				for (u_int j = 0; j < strings.size(); ++j) {
+					if (strings[j] == "true")
+						bdata[j] = true;
+					else if (strings[j] == "false")
+						bdata[j] = false;
+					else {
+						LOG( LUX_WARNING,LUX_SYNTAX)
+							<< "Value '" << strings[j] << "' unknown for boolean parameter '" <<
+							token << "'. Using 'false'.";
+						bdata[j] = false;
+					}
+				}
+				params.AddBool(name, bdata, strings.size());
+				delete[] bdata;
+				break;
+			}
+			case PARAM_TYPE_FLOAT:
+				params.AddFloat(name, ArrayData(floats), floats.size(),
+					floatValues);
+				break;
+			case PARAM_TYPE_POINT:
+				params.AddPoint(name,
+					reinterpret_cast<const Point *>(ArrayData(floats)),
+					floats.size() / 3, floatValues);
+				break;
+			case PARAM_TYPE_VECTOR:
+				params.AddVector(name,
+					reinterpret_cast<const Vector *>(ArrayData(floats)),
+					floats.size() / 3, floatValues);
+				break;
+			case PARAM_TYPE_NORMAL:
+				params.AddNormal(name,
+					reinterpret_cast<const Normal *>(ArrayData(floats)),
+					floats.size() / 3, floatValues);
+				break;
+			case PARAM_TYPE_COLOR:
+				params.AddRGBColor(name,
+					reinterpret_cast<const RGBColor *>(ArrayData(floats)),
+					floats.size() / COLOR_SAMPLES, floatValues);
+				break;
+			case PARAM_TYPE_STRING:
+				params.AddString(name, ArrayData(strings), strings.size());
+				break;
+			case PARAM_TYPE_TEXTURE:
+				if (strings.size() == 1)
+					params.AddTexture(name, strings[0]);
+				else
+					LOG( LUX_ERROR,LUX_SYNTAX) << "Only one string allowed for 'texture' parameter " << name;
+				break;
+		}
+	}
+	return true;
+}
+
+bool SceneFile::Execute()
+{
+	if (direct) {
+		// No idle core was available, parse and execute at the same time,
+		// a missing included file is reported but doesn't stop the parsing
+		if (!Parse() && depth == 0)
+			return false;
+		return !failed;
+	}
+	for (;;) {
+		boost::shared_ptr<Statement> s;
+		{
+			boost::mutex::scoped_lock lock(queueMutex);
+			while (statements.empty() && !parsed)
+				queueNotEmpty.wait(lock);
+			if (statements.empty())
+				break;
+			s = statements.front();
+			statements.pop_front();
+			if (statements.size() == maxQueuedStatements - 1)
+				queueNotFull.notify_one();
+		}
+		if (!ExecuteStatement(*s))
+			return false;
+	}
+	thread->join();
+	thread.reset();
+	return !failed;
+}
+
+bool SceneFile::ExecuteStatement(Statement &s)
+{
+	Context *ctx = Context::GetActive();
+	currentFile = filename;
+	lineNum = s.line;
+	switch (s.type) {
+		case STMT_ACCELERATOR:
+			ctx->Accelerator(s.strings[0], s.params);
+			break;
+		case STMT_AREALIGHTSOURCE:
+			ctx->AreaLightSource(s.strings[0], s.params);
+			break;
+		case STMT_ATTRIBUTEBEGIN:
+			luxAttributeBegin();
+			break;
+		case STMT_ATTRIBUTEEND:
+			luxAttributeEnd();
+			break;
+		case STMT_CAMERA:
+			ctx->Camera(s.strings[0], s.params);
+			break;
+		case STMT_CONCATTRANSFORM:
+			if (s.numbers.size() == 16)
+				luxConcatTransform(&s.numbers[0]);
+			else
+				LOG( LUX_SEVERE,LUX_SYNTAX) << "ConcatTransform requires a(n) 16 element array!";
+			break;
+		case STMT_COORDINATESYSTEM:
+			luxCoordinateSystem(s.strings[0].c_str());
+			break;
+		case STMT_COORDSYSTRANSFORM:
+			luxCoordSysTransform(s.strings[0].c_str());
+			break;
+		case STMT_EXTERIOR:
+			ctx->Exterior(s.strings[0]);
+			break;
+		case STMT_FILM:
+			ctx->Film(s.strings[0], s.params);
+			break;
+		case STMT_IDENTITY:
+			luxIdentity();
+			break;
+		case STMT_INCLUDE:
+			if (s.include && !s.include->Execute())
+				return false;
+			break;
+		case STMT_INTERIOR:
+			ctx->Interior(s.strings[0]);
+			break;
+		case STMT_LIGHTGROUP:
+			ctx->LightGroup(s.strings[0], s.params);
+			break;
+		case STMT_LIGHTSOURCE:
+			ctx->LightSource(s.strings[0], s.params);
+			break;
+		case STMT_LOOKAT:
+			luxLookAt(s.numbers[0], s.numbers[1], s.numbers[2],
+				s.numbers[3], s.numbers[4], s.numbers[5],
+				s.numbers[6], s.numbers[7], s.numbers[8]);
+			break;
+		case STMT_MATERIAL:
+			ctx->Material(s.strings[0], s.params);
+			break;
+		case STMT_MAKENAMEDMATERIAL:
+			ctx->MakeNamedMaterial(s.strings[0], s.params);
+			break;
+		case STMT_MAKENAMEDVOLUME:
+			ctx->MakeNamedVolume(s.strings[0], s.strings[1], s.params);
+			break;
+		case STMT_MOTIONBEGIN:
+			luxMotionBegin(s.numbers.size(),
+				s.numbers.empty() ? NULL : &s.numbers[0]);
+			break;
+		case STMT_MOTIONEND:
+			luxMotionEnd();
+			break;
+		case STMT_NAMEDMATERIAL:
+			ctx->NamedMaterial(s.strings[0]);
+			break;
+		case STMT_OBJECTBEGIN:
+			luxObjectBegin(s.strings[0].c_str());
+			break;
+		case STMT_OBJECTEND:
+			luxObjectEnd();
+			break;
+		case STMT_OBJECTINSTANCE:
+			luxObjectInstance(s.strings[0].c_str());
+			break;
+		case STMT_PORTALINSTANCE:
+			luxPortalInstance(s.strings[0].c_str());
+			break;
+		case STMT_MOTIONINSTANCE:
+			luxMotionInstance(s.strings[0].c_str(), s.numbers[0],
+				s.numbers[1], s.strings[1].c_str());
+			break;
+		case STMT_PIXELFILTER:
+			ctx->PixelFilter(s.strings[0], s.params);
+			break;
+		case STMT_RENDERER:
+			ctx->Renderer(s.strings[0], s.params);
+			break;
+		case STMT_REVERSEORIENTATION:
+			luxReverseOrientation();
+			break;
+		case STMT_ROTATE:
+			luxRotate(s.numbers[0], s.numbers[1], s.numbers[2],
+				s.numbers[3]);
+			break;
+		case STMT_SAMPLER:
+			ctx->Sampler(s.strings[0], s.params);
+			break;
+		case STMT_SEARCHPATH:
+			//FIXME - Unimplemented
+			break;
+		case STMT_SCALE:
+			luxScale(s.numbers[0], s.numbers[1], s.numbers[2]);
+			break;
+		case STMT_PORTALSHAPE:
+			ctx->PortalShape(s.strings[0], s.params);
+			break;
+		case STMT_SHAPE:
+			ctx->Shape(s.strings[0], s.params);
+			break;
+		case STMT_SURFACEINTEGRATOR:
+			ctx->SurfaceIntegrator(s.strings[0], s.params);
+			break;
+		case STMT_TEXTURE:
+			ctx->Texture(s.strings[0], s.strings[1], s.strings[2],
+				s.params);
+			break;
+		case STMT_TRANSFORMBEGIN:
+			luxTransformBegin();
+			break;
+		case STMT_TRANSFORMEND:
+			luxTransformEnd();
+			break;
+		case STMT_TRANSFORM:
+			if (s.numbers.size() == 16)
+				luxTransform(&s.numbers[0]);
+			else
+				LOG( LUX_SEVERE,LUX_SYNTAX) << "Transform requires a(n) 16 element array!";
+			break;
+		case STMT_TRANSLATE:
+			luxTranslate(s.numbers[0], s.numbers[1], s.numbers[2]);
+			break;
+		case STMT_VOLUME:
+			ctx->Volume(s.strings[0], s.params);
+			break;
+		case STMT_VOLUMEINTEGRATOR:
+			ctx->VolumeIntegrator(s.strings[0], s.params);
+			break;
+		case STMT_WORLDBEGIN:
+			luxWorldBegin();
+			break;
+		case STMT_WORLDEND:
+			luxWorldEnd();
+			break;
+	}
+	return true;
+}
+
+bool ParseSceneFile(const string &filename)
+{
+	SceneFile scene(filename, 0);
+	scene.Start();
+	const bool success = scene.Execute();
+	currentFile = "";
+	lineNum = 0;
+	return success;
+}
+
+}//namespace lux
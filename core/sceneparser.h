@@ -0,0 +1,40 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#ifndef LUX_SCENEPARSER_H
+#define LUX_SCENEPARSER_H
+// sceneparser.h*
+#include "lux.h"
+
+namespace lux
+{
+
+// Alternative to the flex/bison front end for large scene files:
+// the file is memory mapped, numbers are decoded in place straight into
+// the parameter arrays and included files are parsed in parallel.
+// The statements are still sent to the active context in file order,
+// as soon as they are parsed.
+bool ParseSceneFile(const string &filename);
+
+}//namespace lux
+
+#endif // LUX_SCENEPARSER_H
@@ -62,6 +62,11 @@ public:
 		interior = v;
 	}
 	Material *GetMaterial() const { return material.get(); }
+	virtual void ReplaceMaterial(const Material *from,
+		const boost::shared_ptr<Material> &to) {
+		if (material.get() == from)
+			SetMaterial(to);
+	}
 	virtual const Volume *GetExterior() const { return exterior.get(); }
 	virtual const Volume *GetInterior() const { return interior.get(); }
 
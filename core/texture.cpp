@@ -28,6 +28,10 @@
 #include "fresnelgeneral.h"
 #include "luxrays/core/geometry/vector.h"
 
+#include <xmmintrin.h>
+
+#include <boost/thread/tss.hpp>
+
 using namespace luxrays;
 
 namespace lux
@@ -36,6 +40,8 @@ namespace lux
 // Texture Forward Declarations
 inline float Grad(int x, int y, int z, float dx, float dy, float dz);
 inline float NoiseWeight(float t);
+static float OctaveSum(const Point &P, float omega, int octaves,
+	float partialWeight, bool absolute);
 // Perlin Noise Data
 #define NOISE_PERM_SIZE 256
 static int NoisePerm[2 * NOISE_PERM_SIZE] = {
@@ -533,6 +539,179 @@ inline float NoiseWeight(float t)
 	return 6.f*t4*t - 15.f*t4 + 10.f*t3;
 }
 
+// Gradients of Grad() for each hash value, so that 4 gradients are
+// computed at once as dot products
+static const float GradX[16] = { 1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 1.f, -1.f,
+	0.f, 0.f, 0.f, 0.f, 1.f, -1.f, 0.f, 0.f };
+static const float GradY[16] = { 1.f, 1.f, -1.f, -1.f, 0.f, 0.f, 0.f, 0.f,
+	1.f, -1.f, 1.f, -1.f, 1.f, 1.f, 1.f, -1.f };
+static const float GradZ[16] = { 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, -1.f, -1.f,
+	1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -1.f, -1.f };
+
+float Noise(const Point &P, Vector *dNdP)
+{
+	// Compute noise cell coordinates and offsets
+	int ix = Floor2Int(P.x);
+	int iy = Floor2Int(P.y);
+	int iz = Floor2Int(P.z);
+	const float dx = P.x - ix, dy = P.y - iy, dz = P.z - iz;
+	ix &= (NOISE_PERM_SIZE-1);
+	iy &= (NOISE_PERM_SIZE-1);
+	iz &= (NOISE_PERM_SIZE-1);
+	// Compute gradient weights and their gradients, in the same order
+	// as Noise() so that values match
+	float w[8];
+	Vector dw[8];
+	for (u_int i = 0; i < 8; ++i) {
+		const int cx = i & 1, cy = (i >> 1) & 1, cz = i >> 2;
+		w[i] = Grad(ix + cx, iy + cy, iz + cz, dx - cx, dy - cy, dz - cz);
+		const int h = NoisePerm[NoisePerm[NoisePerm[ix + cx] + iy + cy] +
+			iz + cz] & 15;
+		dw[i] = Vector(GradX[h], GradY[h], GradZ[h]);
+	}
+	// Compute trilinear interpolation of weights and its gradient,
+	// d/dt NoiseWeight(t) = 30 t^2 (t - 1)^2
+	const float wx = NoiseWeight(dx);
+	const float wy = NoiseWeight(dy);
+	const float wz = NoiseWeight(dz);
+	const float dwx = 30.f * dx * dx * (dx - 1.f) * (dx - 1.f);
+	const float dwy = 30.f * dy * dy * (dy - 1.f) * (dy - 1.f);
+	const float dwz = 30.f * dz * dz * (dz - 1.f) * (dz - 1.f);
+	float x[4];
+	Vector dX[4];
+	for (u_int i = 0; i < 4; ++i) {
+		x[i] = Lerp(wx, w[2 * i], w[2 * i + 1]);
+		dX[i] = Lerp(wx, dw[2 * i], dw[2 * i + 1]) +
+			Vector(dwx * (w[2 * i + 1] - w[2 * i]), 0.f, 0.f);
+	}
+	const float y0 = Lerp(wy, x[0], x[1]);
+	const float y1 = Lerp(wy, x[2], x[3]);
+	const Vector dY0(Lerp(wy, dX[0], dX[1]) +
+		Vector(0.f, dwy * (x[1] - x[0]), 0.f));
+	const Vector dY1(Lerp(wy, dX[2], dX[3]) +
+		Vector(0.f, dwy * (x[3] - x[2]), 0.f));
+	*dNdP = Lerp(wz, dY0, dY1) + Vector(0.f, 0.f, dwz * (y1 - y0));
+	return Lerp(wz, y0, y1);
+}
+
+static inline __m128 Grad4(const int h[4], __m128 dx, __m128 dy, __m128 dz)
+{
+	const __m128 gx = _mm_setr_ps(GradX[h[0]], GradX[h[1]],
+		GradX[h[2]], GradX[h[3]]);
+	const __m128 gy = _mm_setr_ps(GradY[h[0]], GradY[h[1]],
+		GradY[h[2]], GradY[h[3]]);
+	const __m128 gz = _mm_setr_ps(GradZ[h[0]], GradZ[h[1]],
+		GradZ[h[2]], GradZ[h[3]]);
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, dx), _mm_mul_ps(gy, dy)),
+		_mm_mul_ps(gz, dz));
+}
+
+static inline __m128 NoiseWeight4(__m128 t)
+{
+	const __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+	const __m128 t4 = _mm_mul_ps(t3, t);
+	return _mm_add_ps(_mm_sub_ps(
+		_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(6.f), t4), t),
+		_mm_mul_ps(_mm_set1_ps(15.f), t4)),
+		_mm_mul_ps(_mm_set1_ps(10.f), t3));
+}
+
+static inline __m128 Lerp4(__m128 t, __m128 v1, __m128 v2)
+{
+	return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.f), t), v1),
+		_mm_mul_ps(t, v2));
+}
+
+void Noise4(const Point P[4], float noise[4])
+{
+	// Compute noise cell coordinates and offsets,
+	// the permutation table lookups stay scalar
+	int ix[4], iy[4], iz[4];
+	for (u_int i = 0; i < 4; ++i) {
+		ix[i] = Floor2Int(P[i].x);
+		iy[i] = Floor2Int(P[i].y);
+		iz[i] = Floor2Int(P[i].z);
+	}
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 dx = _mm_sub_ps(_mm_setr_ps(P[0].x, P[1].x, P[2].x, P[3].x),
+		_mm_setr_ps(static_cast<float>(ix[0]), static_cast<float>(ix[1]),
+		static_cast<float>(ix[2]), static_cast<float>(ix[3])));
+	const __m128 dy = _mm_sub_ps(_mm_setr_ps(P[0].y, P[1].y, P[2].y, P[3].y),
+		_mm_setr_ps(static_cast<float>(iy[0]), static_cast<float>(iy[1]),
+		static_cast<float>(iy[2]), static_cast<float>(iy[3])));
+	const __m128 dz = _mm_sub_ps(_mm_setr_ps(P[0].z, P[1].z, P[2].z, P[3].z),
+		_mm_setr_ps(static_cast<float>(iz[0]), static_cast<float>(iz[1]),
+		static_cast<float>(iz[2]), static_cast<float>(iz[3])));
+	const __m128 dx1 = _mm_sub_ps(dx, one);
+	const __m128 dy1 = _mm_sub_ps(dy, one);
+	const __m128 dz1 = _mm_sub_ps(dz, one);
+	// Compute gradient weights
+	int h[8][4];
+	for (u_int i = 0; i < 4; ++i) {
+		const int x = ix[i] & (NOISE_PERM_SIZE - 1);
+		const int y = iy[i] & (NOISE_PERM_SIZE - 1);
+		const int z = iz[i] & (NOISE_PERM_SIZE - 1);
+		const int p0 = NoisePerm[x], p1 = NoisePerm[x + 1];
+		const int p00 = NoisePerm[p0 + y], p01 = NoisePerm[p0 + y + 1];
+		const int p10 = NoisePerm[p1 + y], p11 = NoisePerm[p1 + y + 1];
+		h[0][i] = NoisePerm[p00 + z] & 15;
+		h[1][i] = NoisePerm[p10 + z] & 15;
+		h[2][i] = NoisePerm[p01 + z] & 15;
+		h[3][i] = NoisePerm[p11 + z] & 15;
+		h[4][i] = NoisePerm[p00 + z + 1] & 15;
+		h[5][i] = NoisePerm[p10 + z + 1] & 15;
+		h[6][i] = NoisePerm[p01 + z + 1] & 15;
+		h[7][i] = NoisePerm[p11 + z + 1] & 15;
+	}
+	const __m128 w000 = Grad4(h[0], dx,  dy,  dz);
+	const __m128 w100 = Grad4(h[1], dx1, dy,  dz);
+	const __m128 w010 = Grad4(h[2], dx,  dy1, dz);
+	const __m128 w110 = Grad4(h[3], dx1, dy1, dz);
+	const __m128 w001 = Grad4(h[4], dx,  dy,  dz1);
+	const __m128 w101 = Grad4(h[5], dx1, dy,  dz1);
+	const __m128 w011 = Grad4(h[6], dx,  dy1, dz1);
+	const __m128 w111 = Grad4(h[7], dx1, dy1, dz1);
+	// Compute trilinear interpolation of weights
+	const __m128 wx = NoiseWeight4(dx);
+	const __m128 wy = NoiseWeight4(dy);
+	const __m128 wz = NoiseWeight4(dz);
+	const __m128 x00 = Lerp4(wx, w000, w100);
+	const __m128 x10 = Lerp4(wx, w010, w110);
+	const __m128 x01 = Lerp4(wx, w001, w101);
+	const __m128 x11 = Lerp4(wx, w011, w111);
+	const __m128 y0 = Lerp4(wy, x00, x10);
+	const __m128 y1 = Lerp4(wy, x01, x11);
+	_mm_storeu_ps(noise, Lerp4(wz, y0, y1));
+}
+
+// Sums octaves of noise at increasing frequencies, evaluated 4 at a time,
+// followed by an octave weighted by partialWeight if it isn't 0
+static float OctaveSum(const Point &P, float omega, int octaves,
+	float partialWeight, bool absolute)
+{
+	const int count = max(octaves, 0) + (partialWeight != 0.f ? 1 : 0);
+	float sum = 0.f, lambda = 1.f, o = 1.f;
+	Point points[4];
+	float weights[4], noise[4];
+	for (int i = 0; i < count; i += 4) {
+		const int n = min(4, count - i);
+		for (int j = 0; j < 4; ++j) {
+			if (j < n) {
+				points[j] = lambda * P;
+				weights[j] = (i + j < octaves) ? o :
+					o * partialWeight;
+				lambda *= 1.99f;
+				o *= omega;
+			} else
+				points[j] = Point(0.f, 0.f, 0.f);
+		}
+		Noise4(points, noise);
+		for (int j = 0; j < n; ++j)
+			sum += weights[j] * (absolute ? fabsf(noise[j]) : noise[j]);
+	}
+	return sum;
+}
+
 float FBm(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	float omega, int maxOctaves)
 {
@@ -542,18 +721,49 @@ float FBm(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	                     1.f - .5f * Log2(s2));
 	const int octaves = Floor2Int(foctaves);
 	// Compute sum of octaves of noise for FBm
+	const float partialOctave = foctaves - static_cast<float>(octaves);
+	return OctaveSum(P, omega, octaves,
+		SmoothStep(.3f, .7f, partialOctave), false);
+}
+
+float FBm(const Point &P, float omega, int octaves)
+{
+	return OctaveSum(P, omega, octaves, 0.f, false);
+}
+
+// Sum of octaves of noise, as OctaveSum() without partial octave, and its
+// gradient
+static float OctaveSum(const Point &P, float omega, int octaves,
+	bool absolute, Vector *dSdP)
+{
 	float sum = 0.f, lambda = 1.f, o = 1.f;
+	*dSdP = Vector(0.f, 0.f, 0.f);
 	for (int i = 0; i < octaves; ++i) {
-		sum += o * Noise(lambda * P);
+		Vector dNdP;
+		const float noise = Noise(lambda * P, &dNdP);
+		if (absolute && noise < 0.f) {
+			sum += o * -noise;
+			*dSdP -= (o * lambda) * dNdP;
+		} else {
+			sum += o * noise;
+			*dSdP += (o * lambda) * dNdP;
+		}
 		lambda *= 1.99f;
 		o *= omega;
 	}
-	const float partialOctave = foctaves - static_cast<float>(octaves);
-	sum += o * SmoothStep(.3f, .7f, partialOctave) *
-	       Noise(lambda * P);
 	return sum;
 }
 
+float FBm(const Point &P, float omega, int octaves, Vector *dFdP)
+{
+	return OctaveSum(P, omega, octaves, false, dFdP);
+}
+
+float Turbulence(const Point &P, float omega, int octaves, Vector *dTdP)
+{
+	return OctaveSum(P, omega, octaves, true, dTdP);
+}
+
 float Turbulence(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	float omega, int maxOctaves)
 {
@@ -563,15 +773,9 @@ float Turbulence(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	                     1.f - .5f * Log2(s2));
 	const int octaves = Floor2Int(foctaves);
 	// Compute sum of octaves of noise for turbulence
-	float sum = 0.f, lambda = 1.f, o = 1.f;
-	for (int i = 0; i < octaves; ++i) {
-		sum += o * fabsf(Noise(lambda * P));
-		lambda *= 1.99f;
-		o *= omega;
-	}
 	const float partialOctave = foctaves - static_cast<float>(octaves);
-	sum += o * SmoothStep(.3f, .7f, partialOctave) *
-	       fabsf(Noise(lambda * P));
+	float sum = OctaveSum(P, omega, octaves,
+		SmoothStep(.3f, .7f, partialOctave), true);
 
 	// finally, add in value to account for average value of fabsf(Noise())
 	// (~0.2) for the remaining octaves...
@@ -580,6 +784,116 @@ float Turbulence(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	return sum;
 }
 
+// TextureEvaluationCache Method Definitions
+class ShadingPointCache {
+public:
+	struct Entry {
+		const Texture<float> *texture;
+		DifferentialGeometry dg;
+		// Bump sample distance, negative for values
+		float delta;
+		float value[2];
+	};
+
+	ShadingPointCache() : depth(0U) { }
+
+	const Entry *Find(const Texture<float> *texture,
+		const DifferentialGeometry &dg, float delta) const {
+		for (size_t i = 0; i < entries.size(); ++i) {
+			const Entry &e(entries[i]);
+			if (e.texture == texture && e.delta == delta &&
+				SameGeometry(e.dg, dg))
+				return &e;
+		}
+		return NULL;
+	}
+	void Add(const Texture<float> *texture,
+		const DifferentialGeometry &dg, float delta, float v0,
+		float v1) {
+		// Shading points only share a few textures
+		if (entries.size() >= 32)
+			return;
+		Entry e;
+		e.texture = texture;
+		e.dg = dg;
+		e.delta = delta;
+		e.value[0] = v0;
+		e.value[1] = v1;
+		entries.push_back(e);
+	}
+
+	vector<Entry> entries;
+	u_int depth;
+
+private:
+	// Fields changed by materials at a given intersection
+	static bool SameGeometry(const DifferentialGeometry &a,
+		const DifferentialGeometry &b) {
+		return a.p.x == b.p.x && a.p.y == b.p.y && a.p.z == b.p.z &&
+			a.nn.x == b.nn.x && a.nn.y == b.nn.y && a.nn.z == b.nn.z &&
+			a.dpdu.x == b.dpdu.x && a.dpdu.y == b.dpdu.y &&
+			a.dpdu.z == b.dpdu.z &&
+			a.dpdv.x == b.dpdv.x && a.dpdv.y == b.dpdv.y &&
+			a.dpdv.z == b.dpdv.z &&
+			a.dndu.x == b.dndu.x && a.dndu.y == b.dndu.y &&
+			a.dndu.z == b.dndu.z &&
+			a.dndv.x == b.dndv.x && a.dndv.y == b.dndv.y &&
+			a.dndv.z == b.dndv.z &&
+			a.u == b.u && a.v == b.v;
+	}
+};
+
+static boost::thread_specific_ptr<ShadingPointCache> shadingPointCache;
+
+TextureEvaluationCache::Scope::Scope()
+{
+	ShadingPointCache *cache = shadingPointCache.get();
+	if (!cache) {
+		cache = new ShadingPointCache();
+		shadingPointCache.reset(cache);
+	}
+	if (cache->depth++ == 0)
+		cache->entries.clear();
+}
+
+TextureEvaluationCache::Scope::~Scope()
+{
+	--shadingPointCache->depth;
+}
+
+float TextureEvaluationCache::Evaluate(const Texture<float> &tex,
+	const SpectrumWavelengths &sw, const DifferentialGeometry &dg)
+{
+	ShadingPointCache *cache = shadingPointCache.get();
+	if (!cache || cache->depth == 0)
+		return tex.Evaluate(sw, dg);
+	const ShadingPointCache::Entry *e = cache->Find(&tex, dg, -1.f);
+	if (e)
+		return e->value[0];
+	const float value = tex.Evaluate(sw, dg);
+	cache->Add(&tex, dg, -1.f, value, 0.f);
+	return value;
+}
+
+void TextureEvaluationCache::GetDuv(const Texture<float> &tex,
+	const SpectrumWavelengths &sw, const DifferentialGeometry &dg,
+	float delta, float *du, float *dv)
+{
+	ShadingPointCache *cache = shadingPointCache.get();
+	if (!cache || cache->depth == 0) {
+		tex.GetDuv(sw, dg, delta, du, dv);
+		return;
+	}
+	const ShadingPointCache::Entry *e = cache->Find(&tex, dg, delta);
+	if (e) {
+		*du = e->value[0];
+		*dv = e->value[1];
+		return;
+	}
+	tex.GetDuv(sw, dg, delta, du, dv);
+	cache->Add(&tex, dg, delta, *du, *dv);
+}
+
 float Lanczos(float x, float tau)
 {
 	x = fabsf(x);
@@ -222,9 +222,20 @@ public:
 	virtual float Y() const = 0;
 	virtual float Filter() const { return Y(); }
 	virtual void SetIlluminant() { }
+	// Waits for data built in the background, called when the texture
+	// is handed to a material, a light or another texture
+	virtual void Resolve() { }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const = 0;
+	// EvalFloat() and GetDuv() at once, for textures that share work
+	// between their value and their derivatives
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		GetDuv(sw, dg, delta, du, dv);
+		return EvalFloat(sw, dg);
+	}
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
 		LOG(LUX_WARNING, LUX_SYSTEM) << "Invalid call to Texture<T>::GetMinMaxFloat";
 		*minValue = -1.f;
@@ -239,12 +250,40 @@ template<> inline float Texture<float>::EvalFloat(const SpectrumWavelengths &sw,
 	return Evaluate(sw, dg);
 }
 
+// Float textures and bump gradients already evaluated at the shading point
+// being shaded by the calling thread. While a scope is open, textures shared
+// by the components of a composite material are evaluated once per
+// differential geometry, otherwise they are evaluated directly
+class TextureEvaluationCache {
+public:
+	class Scope {
+	public:
+		Scope();
+		~Scope();
+	};
+
+	static float Evaluate(const Texture<float> &tex,
+		const SpectrumWavelengths &sw, const DifferentialGeometry &dg);
+	static void GetDuv(const Texture<float> &tex,
+		const SpectrumWavelengths &sw, const DifferentialGeometry &dg,
+		float delta, float *du, float *dv);
+};
+
 float Noise(float x, float y = .5f, float z = .5f);
 float Noise(const Point &P);
+// Noise() and its gradient
+float Noise(const Point &P, Vector *dNdP);
+// Noise() at 4 points at once
+void Noise4(const Point P[4], float noise[4]);
 float FBm(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	float omega, int octaves);
+// Sum of octaves without anti-aliasing
+float FBm(const Point &P, float omega, int octaves);
+// Sums of octaves without anti-aliasing and their gradients
+float FBm(const Point &P, float omega, int octaves, Vector *dFdP);
 float Turbulence(const Point &P, const Vector &dpdx, const Vector &dpdy,
 	float omega, int octaves);
+float Turbulence(const Point &P, float omega, int octaves, Vector *dTdP);
 float Lanczos(float, float tau=2);
 
 }//namespace lux
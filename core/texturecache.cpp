@@ -0,0 +1,422 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#include "texturecache.h"
+#include "error.h"
+#include "luxrays/utils/memory.h"
+
+#include <cstring>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace lux;
+
+u_int TextureCache::defaultBudget = 0;
+string TextureCache::directory;
+u_int TextureCache::compressionThreshold = 0;
+
+TextureCache::TextureCache() : Queryable("texture_cache"), hand(0),
+	nextId(1), evictions(0), enabled(true)
+{
+	AddIntAttribute(*this, "budget", "Memory budget for image map tiles in Mbytes, 0 keeps whole maps in memory", &TextureCache::GetBudget, &TextureCache::SetBudget);
+	AddIntAttribute(*this, "residentTiles", "Number of tiles in memory", &TextureCache::GetResidentTiles);
+	AddIntAttribute(*this, "residentMemory", "Memory used by the tiles in Kbytes", &TextureCache::GetResidentMemory);
+	AddDoubleAttribute(*this, "hits", "Number of texel lookups in resident tiles", &TextureCache::GetHits);
+	AddDoubleAttribute(*this, "hitRate", "Percentage of the texel lookups in resident tiles", &TextureCache::GetHitRate);
+	AddIntAttribute(*this, "faults", "Number of texel lookups waiting for a tile", &TextureCache::GetFaults);
+	AddIntAttribute(*this, "misses", "Number of tiles read from disk", &TextureCache::GetMisses);
+	AddIntAttribute(*this, "evictions", "Number of tiles evicted to stay in the budget", &TextureCache::GetEvictions);
+	AddStringAttribute(*this, "directory", "Directory of the MIPMap files built from image maps, empty to rebuild them for each scene", &TextureCache::GetCacheDirectory, &TextureCache::SetCacheDirectory);
+	AddIntAttribute(*this, "compression", "Size in Mbytes from which float image maps are stored with shared exponents, 0 to only compress them on request", &TextureCache::GetCompression, &TextureCache::SetCompression);
+
+	Resize();
+}
+
+TextureCache::~TextureCache()
+{
+	for (size_t i = 0; i < slots.size(); ++i)
+		luxrays::FreeAligned(slots[i].data);
+}
+
+void TextureCache::SetBudget(u_int budget)
+{
+	defaultBudget = budget;
+
+	boost::mutex::scoped_lock lock(cacheMutex);
+	// Slots can only be reallocated while no texture uses them,
+	// otherwise the budget applies to the next scene
+	if (textures.empty())
+		Resize();
+}
+
+void TextureCache::SetCacheDirectory(string dir)
+{
+	if (!dir.empty()) {
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(dir, ec);
+		if (!boost::filesystem::is_directory(dir, ec)) {
+			LOG(LUX_ERROR, LUX_NOFILE) << "Unable to use '" << dir <<
+				"' as MIPMap cache directory";
+			return;
+		}
+	}
+	directory = dir;
+}
+
+void TextureCache::Resize()
+{
+	// NOTE - requires cacheMutex to be acquired by caller if textures
+	// can be registered
+	for (size_t i = 0; i < slots.size(); ++i)
+		luxrays::FreeAligned(slots[i].data);
+	slots.clear();
+	freeSlots.clear();
+	hand = 0;
+
+	if (defaultBudget == 0)
+		return;
+
+	// Enough slots for every rendering thread to fault at the same time
+	const u_int count = max(64U, static_cast<u_int>(
+		(static_cast<unsigned long long>(defaultBudget) << 20) / slotSize));
+	slots.resize(count);
+	freeSlots.reserve(count);
+	// Slot memory is allocated on first use
+	for (u_int i = count; i > 0; --i)
+		freeSlots.push_back(i - 1);
+
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Texture cache: " << count <<
+		" tiles of " << (slotSize / 1024) << "Kbytes";
+}
+
+u_int TextureCache::Register(TiledTexture *texture)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	const u_int id = nextId++;
+	textures[id] = texture;
+	return id;
+}
+
+void TextureCache::Unregister(TiledTexture *texture)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	// No lookup can happen anymore, release the slots of the texture
+	for (u_int i = 0; i < texture->tileCount; ++i) {
+		const u_int index = texture->tileSlots[i];
+		if (index >= TiledTexture::loading)
+			continue;
+		Slot &slot(slots[index]);
+		osAtomicInc(&slot.version);
+		slot.owner = 0;
+		osAtomicInc(&slot.version);
+		freeSlots.push_back(index);
+		texture->tileSlots[i] = TiledTexture::notResident;
+	}
+	textures.erase(texture->id);
+}
+
+u_int TextureCache::Allocate()
+{
+	// NOTE - requires cacheMutex to be acquired by caller
+	if (!freeSlots.empty()) {
+		const u_int index = freeSlots.back();
+		freeSlots.pop_back();
+		Slot &slot(slots[index]);
+		if (!slot.data)
+			slot.data = luxrays::AllocAligned<char>(slotSize);
+		osAtomicInc(&slot.version);
+		return index;
+	}
+
+	// Give every slot a second chance before evicting it, tiles
+	// being loaded are skipped
+	for (size_t i = 0; i < 2 * slots.size(); ++i) {
+		const u_int index = hand;
+		Slot &slot(slots[index]);
+		hand = (hand + 1) % slots.size();
+		if (slot.version & 1)
+			continue;
+		if (osAtomicRead(&slot.referenced)) {
+			osAtomicWrite(&slot.referenced, 0);
+			continue;
+		}
+
+		osAtomicInc(&slot.version);
+		std::map<u_int, TiledTexture *>::iterator owner = textures.find(slot.owner);
+		if (owner != textures.end()) {
+			TiledTexture &texture(*(owner->second));
+			++texture.evictions;
+			osAtomicWrite(&texture.tileSlots[slot.tile], TiledTexture::notResident);
+		}
+		++evictions;
+		return index;
+	}
+
+	return ~0u;
+}
+
+void TextureCache::Fault(TiledTexture &texture, u_int tile)
+{
+	u_int index;
+	{
+		boost::mutex::scoped_lock lock(cacheMutex);
+		++texture.faults;
+		const u_int current = texture.tileSlots[tile];
+		if (current != TiledTexture::notResident) {
+			// Another thread is loading it
+			if (current == TiledTexture::loading) {
+				lock.unlock();
+				boost::this_thread::yield();
+			}
+			return;
+		}
+
+		index = Allocate();
+		if (index == ~0u) {
+			// Every slot is being loaded, wait for one
+			lock.unlock();
+			boost::this_thread::yield();
+			return;
+		}
+		osAtomicWrite(&texture.tileSlots[tile], TiledTexture::loading);
+		++texture.misses;
+	}
+
+	Slot &slot(slots[index]);
+	if (!texture.ReadTile(tile, slot.data))
+		memset(slot.data, 0, slotSize);
+
+	boost::mutex::scoped_lock lock(cacheMutex);
+	slot.owner = texture.id;
+	slot.tile = tile;
+	osAtomicWrite(&slot.referenced, 1);
+	osMemoryBarrier();
+	osAtomicInc(&slot.version);
+	osAtomicWrite(&texture.tileSlots[tile], index);
+}
+
+u_int TextureCache::GetResidentTiles()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return slots.size() - freeSlots.size();
+}
+
+u_int TextureCache::GetResidentMemory()
+{
+	return GetResidentTiles() * (slotSize / 1024);
+}
+
+double TextureCache::GetHits()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	double hits = 0.;
+	for (std::map<u_int, TiledTexture *>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+		hits += it->second->GetHits();
+	return hits;
+}
+
+double TextureCache::GetHitRate()
+{
+	// A fault is counted for each attempt of a lookup waiting for a
+	// tile being loaded, close enough to the number of lookups
+	const double hits = GetHits();
+	const double lookups = hits + GetFaults();
+	return lookups > 0. ? 100. * hits / lookups : 0.;
+}
+
+u_int TextureCache::GetFaults()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	u_int faults = 0;
+	for (std::map<u_int, TiledTexture *>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+		faults += it->second->GetFaults();
+	return faults;
+}
+
+u_int TextureCache::GetMisses()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	u_int misses = 0;
+	for (std::map<u_int, TiledTexture *>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+		misses += it->second->GetMisses();
+	return misses;
+}
+
+TiledTexture::TiledTexture(const boost::shared_ptr<TextureCache> &c,
+	u_int count, u_int size) : cache(c), tileCount(count), tileSize(size),
+	faults(0), misses(0), evictions(0), temporary(true), offset(0)
+{
+	boost::system::error_code ec;
+	const boost::filesystem::path path(boost::filesystem::temp_directory_path(ec) /
+		boost::filesystem::unique_path("luxtiles-%%%%-%%%%-%%%%-%%%%", ec));
+	filename = path.string();
+	if (!ec)
+		file.open(filename.c_str(), std::ios::in | std::ios::out |
+			std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to create tile file '" <<
+			filename << "'";
+
+	Init();
+}
+
+TiledTexture::TiledTexture(const boost::shared_ptr<TextureCache> &c,
+	const string &f, std::streamoff o, u_int count, u_int size) :
+	cache(c), tileCount(count), tileSize(size), faults(0), misses(0),
+	evictions(0), filename(f), temporary(false), offset(o)
+{
+	try {
+		mapping.open(filename);
+	} catch (std::exception &e) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to map tile file '" <<
+			filename << "': " << e.what();
+	}
+	if (mapping.is_open() && static_cast<std::streamoff>(mapping.size()) <
+		offset + static_cast<std::streamoff>(tileCount) * tileSize) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Tile file '" << filename <<
+			"' is truncated";
+		mapping.close();
+	}
+
+	Init();
+}
+
+void TiledTexture::Init()
+{
+	tileSlots = new u_int[tileCount];
+	for (u_int i = 0; i < tileCount; ++i)
+		tileSlots[i] = notResident;
+	hitCounters = luxrays::AllocAligned<HitCounter>(hitCounterCount);
+	for (u_int i = 0; i < hitCounterCount; ++i)
+		hitCounters[i].hits = 0;
+
+	id = cache->Register(this);
+}
+
+TiledTexture::~TiledTexture()
+{
+	cache->Unregister(this);
+	delete[] tileSlots;
+	luxrays::FreeAligned(hitCounters);
+
+	mapping.close();
+	file.close();
+	if (temporary) {
+		boost::system::error_code ec;
+		boost::filesystem::remove(filename, ec);
+	}
+}
+
+bool TiledTexture::WriteTile(u_int tile, const char *data)
+{
+	if (!temporary)
+		return false;
+	boost::mutex::scoped_lock lock(fileMutex);
+	file.seekp(static_cast<std::streamoff>(tile) * tileSize);
+	file.write(data, tileSize);
+	return !file.fail();
+}
+
+bool TiledTexture::ReadTile(u_int tile, char *data)
+{
+	// Mapped files can be read concurrently
+	if (mapping.is_open()) {
+		memcpy(data, mapping.data() + offset +
+			static_cast<std::streamoff>(tile) * tileSize, tileSize);
+		return true;
+	}
+
+	boost::mutex::scoped_lock lock(fileMutex);
+	file.seekg(static_cast<std::streamoff>(tile) * tileSize);
+	file.read(data, tileSize);
+	if (file.fail()) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to read tile " << tile <<
+			" from '" << filename << "'";
+		file.clear();
+		return false;
+	}
+	return true;
+}
+
+u_int TiledTexture::GetResidentTiles() const
+{
+	u_int count = 0;
+	for (u_int i = 0; i < tileCount; ++i) {
+		if (tileSlots[i] < loading)
+			++count;
+	}
+	return count;
+}
+
+// Next index given to a thread looking texels up
+static u_int nextThreadIndex = 0;
+static boost::thread_specific_ptr<u_int> threadIndex;
+
+u_int TiledTexture::ThreadIndex()
+{
+	u_int *index = threadIndex.get();
+	if (!index) {
+		index = new u_int(osAtomicInc(&nextThreadIndex) %
+			hitCounterCount);
+		threadIndex.reset(index);
+	}
+	return *index;
+}
+
+double TiledTexture::GetHits() const
+{
+	double hits = 0.;
+	for (u_int i = 0; i < hitCounterCount; ++i)
+		hits += static_cast<double>(hitCounters[i].hits);
+	return hits;
+}
+
+void TiledTexture::AddAttributes(Queryable &object)
+{
+	boost::shared_ptr<QueryableIntAttribute> attr;
+
+	attr.reset(new QueryableIntAttribute("tileCount", "Number of tiles of all levels"));
+	attr->getFunc = boost::bind(&TiledTexture::tileCount, boost::cref(*this));
+	object.AddAttribute(attr);
+
+	attr.reset(new QueryableIntAttribute("residentTiles", "Number of tiles in memory"));
+	attr->getFunc = boost::bind(&TiledTexture::GetResidentTiles, boost::cref(*this));
+	object.AddAttribute(attr);
+
+	boost::shared_ptr<QueryableDoubleAttribute> hitsAttr(new QueryableDoubleAttribute("hits", "Number of texel lookups in resident tiles"));
+	hitsAttr->getFunc = boost::bind(&TiledTexture::GetHits, boost::cref(*this));
+	object.AddAttribute(hitsAttr);
+
+	attr.reset(new QueryableIntAttribute("faults", "Number of texel lookups waiting for a tile"));
+	attr->getFunc = boost::bind(&TiledTexture::GetFaults, boost::cref(*this));
+	object.AddAttribute(attr);
+
+	attr.reset(new QueryableIntAttribute("misses", "Number of tiles read from disk"));
+	attr->getFunc = boost::bind(&TiledTexture::GetMisses, boost::cref(*this));
+	object.AddAttribute(attr);
+
+	attr.reset(new QueryableIntAttribute("evictions", "Number of tiles evicted to stay in the budget"));
+	attr->getFunc = boost::bind(&TiledTexture::GetEvictions, boost::cref(*this));
+	object.AddAttribute(attr);
+}
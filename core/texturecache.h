@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#ifndef LUX_TEXTURECACHE_H
+#define LUX_TEXTURECACHE_H
+
+#include "lux.h"
+#include "queryable.h"
+#include "osfunc.h"
+
+#include <fstream>
+#include <map>
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace lux
+{
+
+class TiledTexture;
+
+// Image map texels live in fixed size tiles when the texture cache has a
+// memory budget. Tiles are read from a backing file on their first lookup
+// and the least recently used ones are evicted (clock approximation of LRU)
+// to stay under the budget. Resident tiles are read without locking, each
+// slot carries a version which is odd while the slot content changes.
+class TextureCache : public Queryable {
+public:
+	TextureCache();
+	virtual ~TextureCache();
+
+	// Size of a tile slot in bytes
+	static const u_int slotSize = 64 * 1024;
+
+	struct Slot {
+		Slot() : version(0), owner(0), tile(0), referenced(0),
+			data(NULL) { }
+		u_int version;
+		// Id of the texture and index of the tile in the slot
+		u_int owner, tile;
+		// Set by lookups, cleared by the eviction clock, lookups only
+		// write it when it is cleared to keep the cache line shared
+		u_int referenced;
+		char *data;
+	};
+
+	// Tiling is used by image maps when the budget is not 0
+	bool IsEnabled() const { return enabled && !slots.empty(); }
+	// Keeps whole uncompressed maps in memory, for renderers which
+	// need them
+	void Disable() { enabled = false; }
+	bool IsCompressionEnabled() const { return enabled; }
+
+	Slot &GetSlot(u_int index) { return slots[index]; }
+	// Makes the tile resident, may return before it is if the caller
+	// has to retry
+	void Fault(TiledTexture &texture, u_int tile);
+
+	u_int Register(TiledTexture *texture);
+	void Unregister(TiledTexture *texture);
+
+	// Budget shared by all caches, in Mbytes
+	static u_int GetDefaultBudget() { return defaultBudget; }
+	// Directory of the MIPMap files built from image maps, empty if
+	// they are not kept
+	static const string &GetDirectory() { return directory; }
+	// Size in Mbytes from which float image maps are stored compressed,
+	// 0 if they are only compressed on request
+	static u_int GetCompressionThreshold() { return compressionThreshold; }
+
+private:
+	u_int GetBudget() { return defaultBudget; }
+	void SetBudget(u_int budget);
+	string GetCacheDirectory() { return directory; }
+	void SetCacheDirectory(string dir);
+	u_int GetCompression() { return compressionThreshold; }
+	void SetCompression(u_int threshold) {
+		compressionThreshold = threshold;
+	}
+	u_int GetResidentTiles();
+	u_int GetResidentMemory();
+	double GetHits();
+	double GetHitRate();
+	u_int GetFaults();
+	u_int GetMisses();
+	u_int GetEvictions() { return evictions; }
+	void Resize();
+	// Returns a slot with an odd version, ~0u if none is available
+	u_int Allocate();
+
+	static u_int defaultBudget;
+	static string directory;
+	static u_int compressionThreshold;
+
+	mutable boost::mutex cacheMutex;
+	vector<Slot> slots;
+	vector<u_int> freeSlots;
+	u_int hand; // eviction clock
+	std::map<u_int, TiledTexture *> textures;
+	u_int nextId;
+	u_int evictions;
+	bool enabled;
+};
+
+// The tiles of all the levels of a MIPMap, stored in a backing file
+class TiledTexture {
+public:
+	static const u_int notResident = ~0u;
+	static const u_int loading = ~0u - 1;
+
+	// Tiles written to a temporary file
+	TiledTexture(const boost::shared_ptr<TextureCache> &cache,
+		u_int tileCount, u_int tileSize);
+	// Tiles of an existing file, starting at offset, the file is mapped
+	// read only and kept
+	TiledTexture(const boost::shared_ptr<TextureCache> &cache,
+		const string &filename, std::streamoff offset,
+		u_int tileCount, u_int tileSize);
+	~TiledTexture();
+
+	bool IsValid() const { return file.is_open() || mapping.is_open(); }
+	// Tiles are written once, in order, before any lookup
+	bool WriteTile(u_int tile, const char *data);
+	bool ReadTile(u_int tile, char *data);
+
+	template <class T> T Get(u_int tile, u_int offset) {
+		for (;;) {
+			const u_int index = osAtomicRead(&tileSlots[tile]);
+			if (index < loading) {
+				TextureCache::Slot &slot(cache->GetSlot(index));
+				const u_int version = osAtomicRead(&slot.version);
+				osMemoryBarrier();
+				if (!(version & 1) && slot.owner == id &&
+					slot.tile == tile) {
+					const T texel(reinterpret_cast<const T *>(slot.data)[offset]);
+					osMemoryBarrier();
+					if (osAtomicRead(&slot.version) == version) {
+						if (!osAtomicRead(&slot.referenced))
+							osAtomicWrite(&slot.referenced, 1);
+						++hitCounters[ThreadIndex()].hits;
+						return texel;
+					}
+				}
+			}
+			cache->Fault(*this, tile);
+		}
+	}
+
+	// Adds the tile statistics to the object, usually the MIPMap
+	void AddAttributes(Queryable &object);
+
+	u_int GetResidentTiles() const;
+	u_int GetResidentMemory() const { return GetResidentTiles() * tileSize; }
+	double GetHits() const;
+	u_int GetFaults() const { return faults; }
+	u_int GetMisses() const { return misses; }
+	u_int GetEvictions() const { return evictions; }
+
+	friend class TextureCache;
+private:
+	void Init();
+	// Index of the hit counter of the calling thread
+	static u_int ThreadIndex();
+
+	boost::shared_ptr<TextureCache> cache;
+	u_int id;
+	u_int tileCount, tileSize;
+	// Slot of each tile, notResident or loading
+	u_int *tileSlots;
+	// Statistics, updated under the cache mutex
+	u_int faults, misses, evictions;
+	// Lookups of resident tiles, counted by each thread in its own cache
+	// line and summed on query. Threads beyond hitCounterCount share
+	// counters, which may then miss a few lookups.
+	static const u_int hitCounterCount = 64;
+	struct HitCounter {
+		boost::uint64_t hits;
+		char padding[64 - sizeof(boost::uint64_t)];
+	};
+	HitCounter *hitCounters;
+
+	string filename;
+	bool temporary;
+	boost::mutex fileMutex;
+	std::fstream file;
+	boost::iostreams::mapped_file_source mapping;
+	std::streamoff offset;
+};
+
+}//namespace lux
+
+#endif // LUX_TEXTURECACHE_H
@@ -350,5 +350,159 @@ template<> inline RGBAColor TextureColor<float, 4>::GetRGBAColor() const {
 	return RGBAColor(c[0], c[1], c[2], c[3]);
 }
 
+// Float colors stored on 8 bits per channel with a shared exponent (RGBE),
+// the alpha channel of RGBA colors is stored on 8 bits.
+// Negative components are stored as 0
+template <u_int colorSamples> class SharedExponentColor
+{
+public:
+	SharedExponentColor() {
+		for (u_int i = 0; i <= colorSamples; ++i)
+			c[i] = 0;
+	}
+	SharedExponentColor(const TextureColor<float, colorSamples> &color) {
+		// Negative and NaN values are stored as 0 and values too
+		// large for the exponent, including infinity, as the largest
+		// encodable value, 255/256 * 2^127
+		const float maxEncoded = ldexpf(255.f / 256.f, 127);
+		float value[colorChannels];
+		float maxValue = 0.f;
+		for (u_int i = 0; i < colorChannels; ++i) {
+			value[i] = color.c[i] > 0.f ? min(color.c[i], maxEncoded) : 0.f;
+			maxValue = max(maxValue, value[i]);
+		}
+		if (maxValue < 1e-32f) {
+			for (u_int i = 0; i < colorChannels; ++i)
+				c[i] = 0;
+			c[colorSamples] = 0;
+		} else {
+			int e;
+			const float scale = frexpf(maxValue, &e) * 256.f /
+				maxValue;
+			for (u_int i = 0; i < colorChannels; ++i)
+				c[i] = static_cast<unsigned char>(min(255.f,
+					value[i] * scale));
+			c[colorSamples] = static_cast<unsigned char>(e + 128);
+		}
+		if (colorChannels < colorSamples)
+			c[colorChannels] = static_cast<unsigned char>((color.c[colorChannels] > 0.f ?
+				min(color.c[colorChannels], 1.f) : 0.f) * 255.f + .5f);
+	}
+
+	TextureColor<float, colorSamples> Decode() const {
+		TextureColor<float, colorSamples> ret(0.f);
+		if (c[colorSamples] != 0) {
+			const float scale = ldexpf(1.f,
+				static_cast<int>(c[colorSamples]) - (128 + 8));
+			for (u_int i = 0; i < colorChannels; ++i)
+				ret.c[i] = (c[i] + .5f) * scale;
+		}
+		if (colorChannels < colorSamples)
+			ret.c[colorChannels] = c[colorChannels] / 255.f;
+		return ret;
+	}
+	SWCSpectrum GetSpectrum(const SpectrumWavelengths &sw) const {
+		return Decode().GetSpectrum(sw);
+	}
+	float GetFloat(Channel channel) const {
+		return Decode().GetFloat(channel);
+	}
+	RGBAColor GetRGBAColor() const { return Decode().GetRGBAColor(); }
+
+	// Color channels and alpha channel, then the shared exponent
+	unsigned char c[colorSamples + 1];
+
+private:
+	static const u_int colorChannels = colorSamples < 3 ? colorSamples : 3;
+};
+
+// Compact storage of texels of type T, T itself if there is none
+template <class T> struct CompressedTexel {
+	typedef T Type;
+};
+template <> struct CompressedTexel<TextureColor<float, 3> > {
+	typedef SharedExponentColor<3> Type;
+};
+template <> struct CompressedTexel<TextureColor<float, 4> > {
+	typedef SharedExponentColor<4> Type;
+};
+
+// Texels converted to spectra through RGB
+template <class T> struct RGBTexel {
+	static const bool value = false;
+};
+template <class U> struct RGBTexel<TextureColor<U, 3> > {
+	static const bool value = true;
+};
+template <class U> struct RGBTexel<TextureColor<U, 4> > {
+	static const bool value = true;
+};
+template <> struct RGBTexel<SharedExponentColor<3> > {
+	static const bool value = true;
+};
+template <> struct RGBTexel<SharedExponentColor<4> > {
+	static const bool value = true;
+};
+
+// Weighted sum of the spectra of texels for a filtered lookup
+template <class T, bool rgb = RGBTexel<T>::value> class TexelSpectrumSum
+{
+public:
+	TexelSpectrumSum(const SpectrumWavelengths &w) : sw(w), sum(0.f) { }
+
+	void Add(const T &texel, float weight) {
+		sum += texel.GetSpectrum(sw) * weight;
+	}
+	SWCSpectrum GetSpectrum() const { return sum; }
+
+private:
+	const SpectrumWavelengths &sw;
+	SWCSpectrum sum;
+};
+
+// The RGB to spectrum conversion is linear for colors sharing the same
+// ordering of their components. RGB texels are summed per ordering, so a
+// lookup converts one color per ordering found in its footprint instead
+// of every texel
+template <class T> class TexelSpectrumSum<T, true>
+{
+public:
+	TexelSpectrumSum(const SpectrumWavelengths &w) : sw(w), used(0U) { }
+
+	void Add(const T &texel, float weight) {
+		const RGBAColor color(texel.GetRGBAColor());
+		const RGBColor c(color.c[0], color.c[1], color.c[2]);
+		const u_int i = Ordering(c);
+		if (used & (1U << i))
+			sums[i] += c * weight;
+		else {
+			sums[i] = c * weight;
+			used |= 1U << i;
+		}
+	}
+	SWCSpectrum GetSpectrum() const {
+		SWCSpectrum sum(0.f);
+		for (u_int i = 0; i < 6; ++i) {
+			if (used & (1U << i))
+				sum += SWCSpectrum(sw, sums[i]);
+		}
+		return sum;
+	}
+
+private:
+	// Same cases as the RGB to spectrum conversion
+	static u_int Ordering(const RGBColor &c) {
+		if (c.c[0] <= c.c[1] && c.c[0] <= c.c[2])
+			return c.c[1] <= c.c[2] ? 0 : 1;
+		if (c.c[1] <= c.c[0] && c.c[1] <= c.c[2])
+			return c.c[0] <= c.c[2] ? 2 : 3;
+		return c.c[0] <= c.c[1] ? 4 : 5;
+	}
+
+	const SpectrumWavelengths &sw;
+	RGBColor sums[6];
+	u_int used;
+};
+
 }
 #endif // LUX_COLORBASE_H
@@ -33,7 +33,7 @@
 #define LUX_VN_BUILD 0
 #define LUX_VN_LABEL "RC1"
 
-#define LUX_SERVER_PROTOCOL_VERSION  1011
+#define LUX_SERVER_PROTOCOL_VERSION  1013
 
 #define LUX_VERSION_STRING           VERSION_STR(LUX_VN_MAJOR)     \
                                      "." VERSION_STR(LUX_VN_MINOR) \
@@ -23,6 +23,7 @@
 // This file wraps the lux::Context and lux::ParamSet classes, which is enough
 // to provide a complete interface to rendering.
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -460,6 +461,95 @@ void lux_wrapped_context::worldEnd()
 	render_threads.push_back(new boost::thread( boost::bind(&lux_wrapped_context::world_end_thread, this) ));
 }
 
+// interactive edits of the scene being rendered
+void lux_wrapped_context::editBegin()
+{
+	boost::mutex::scoped_lock lock(ctxMutex);
+	checkContext();
+	ctx->EditBegin();
+}
+void lux_wrapped_context::editEnd()
+{
+	boost::mutex::scoped_lock lock(ctxMutex);
+	checkContext();
+	ctx->EditEnd();
+}
+
+// bulk geometry methods
+
+// Calls the caller supplied release callback once the last ParamSet array
+// referencing the mesh data has been dropped
+class lux_mesh_owner {
+public:
+	lux_mesh_owner(void (*r)(void *), void *d) : release(r), releaseData(d) { }
+	~lux_mesh_owner() { release(releaseData); }
+private:
+	void (*release)(void *);
+	void *releaseData;
+};
+
+// Adopts the caller array when its lifetime is known, copies it otherwise
+#define ADD_MESH_ARRAY(_add, _name, _type, _data, _n) \
+	if (_data) { \
+		if (owner) \
+			ps._add(_name, reinterpret_cast<const _type *>(_data), _n, owner); \
+		else \
+			ps._add(_name, reinterpret_cast<const _type *>(_data), _n); \
+	}
+
+void lux_wrapped_context::submitMesh(const char *mType, const lux_mesh &m)
+{
+	boost::shared_ptr<const void> owner;
+	if (m.release)
+		owner.reset(new lux_mesh_owner(m.release, m.releaseData));
+
+	lux::ParamSet ps;
+	if (m.params)
+		ps.Add(*((lux_wrapped_paramset*)m.params)->GetParamSet());
+	if (m.name) {
+		const std::string meshName(m.name);
+		ps.AddString("name", &meshName);
+	}
+	ADD_MESH_ARRAY(AddPoint, "P", lux::Point, m.P, m.nVertices)
+	ADD_MESH_ARRAY(AddInt, "indices", int, m.indices, 3 * m.nTriangles)
+	ADD_MESH_ARRAY(AddInt, "quadindices", int, m.quadIndices, 4 * m.nQuads)
+	ADD_MESH_ARRAY(AddNormal, "N", lux::Normal, m.N, m.nVertices)
+	ADD_MESH_ARRAY(AddFloat, "uv", float, m.uv, 2 * m.nVertices)
+	ADD_MESH_ARRAY(AddFloat, "C", float, m.C, 3 * m.nVertices)
+	ADD_MESH_ARRAY(AddFloat, "A", float, m.A, m.nVertices)
+	// Only the ParamSet holds the data from now on
+	owner.reset();
+
+	const bool scoped = m.transform || m.material;
+	if (scoped) {
+		ctx->AttributeBegin();
+		if (m.transform) {
+			float tx[16];
+			std::copy(m.transform, m.transform + 16, tx);
+			ctx->ConcatTransform(tx);
+		}
+		if (m.material)
+			ctx->NamedMaterial(m.material);
+	}
+	ctx->Shape(mType, ps);
+	if (scoped)
+		ctx->AttributeEnd();
+}
+void lux_wrapped_context::mesh(const char *mType, const lux_mesh *m)
+{
+	boost::mutex::scoped_lock lock(ctxMutex);
+	checkContext();
+	submitMesh(mType, *m);
+}
+void lux_wrapped_context::meshes(const char *mType, const lux_mesh *m, unsigned int count)
+{
+	// The whole batch is submitted under a single lock
+	boost::mutex::scoped_lock lock(ctxMutex);
+	checkContext();
+	for (unsigned int i = 0; i < count; ++i)
+		submitMesh(mType, m[i]);
+}
+
 // I/O and imaging
 void lux_wrapped_context::loadFLM(const char* fName)
 {
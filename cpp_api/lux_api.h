@@ -108,6 +108,14 @@ public:
 	void worldBegin();
 	void worldEnd();
 
+	// interactive edits of the scene being rendered
+	void editBegin();
+	void editEnd();
+
+	// bulk geometry methods
+	void mesh(const char *mType, const lux_mesh *m);
+	void meshes(const char *mType, const lux_mesh *m, unsigned int count);
+
 	// I/O and imaging
 	void loadFLM(const char* fName);
 	void saveFLM(const char* fName);
@@ -171,6 +179,7 @@ private:
 	{
 		ctx->WorldEnd();
 	}
+	void submitMesh(const char *mType, const lux_mesh &m);
 };
 
 class lux_wrapped_paramset : public lux_paramset {
@@ -28,6 +28,32 @@
 #include "export_defs.h"
 #include "lux_paramset.h"
 
+// Description of a triangle/quad mesh for the bulk geometry methods.
+// The arrays are owned by the caller and are used in place by the core until
+// the mesh has been built: when release is set it is called with
+// releaseData once the core doesn't reference the arrays anymore (possibly
+// from another thread), otherwise the arrays are copied during the call.
+struct lux_mesh {
+	const char *name;		// optional, for messages
+	const float *transform;		// optional 4x4 matrix applied on top of the current transform
+	const char *material;		// optional named material, current one otherwise
+	const lux_paramset *params;	// optional extra shape parameters
+
+	const float *P;			// 3 floats per vertex
+	unsigned int nVertices;
+	const int *indices;		// 3 vertex indices per triangle
+	unsigned int nTriangles;
+	const int *quadIndices;		// optional, 4 vertex indices per quad
+	unsigned int nQuads;
+	const float *N;			// optional, 3 floats per vertex
+	const float *uv;		// optional, 2 floats per vertex
+	const float *C;			// optional, 3 floats per vertex
+	const float *A;			// optional, 1 float per vertex
+
+	void (*release)(void *releaseData);
+	void *releaseData;
+};
+
 // This is the CPP API Interface for LuxRender
 CPP_EXPORT class CPP_API lux_instance {
 public:
@@ -148,6 +174,16 @@ public:
 	virtual void disableRandomMode() = 0;
 	virtual void setEpsilon(const float minValue, const float maxValue) = 0;
 
+	// Methods added after the initial interface are appended here so that
+	// the vtable layout stays compatible with existing binaries
+
+	// bulk geometry methods, mType is the mesh shape plugin ("mesh" or "trianglemesh")
+	virtual void mesh(const char *mType, const lux_mesh *m) = 0;
+	virtual void meshes(const char *mType, const lux_mesh *m, unsigned int count) = 0;
+
+	// interactive edits of the scene being rendered
+	virtual void editBegin() = 0;
+	virtual void editEnd() = 0;
 };
 
 // Pointer to lux_instance factory function
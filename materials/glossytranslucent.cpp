@@ -45,8 +45,9 @@ BSDF *GlossyTranslucent::GetBSDF(MemoryArena &arena, const SpectrumWavelengths &
 	SWCSpectrum d(Kd->Evaluate(sw, dgs).Clamp(0.f, 1.f));
 	SWCSpectrum t(Kt->Evaluate(sw, dgs).Clamp(0.f, 1.f));
 	
-	SWCSpectrum s(Ks->Evaluate(sw, dgs));
-	float i = index->Evaluate(sw, dgs);
+	const SWCSpectrum ks(Ks->Evaluate(sw, dgs));
+	SWCSpectrum s(ks);
+	float i = TextureEvaluationCache::Evaluate(*index, sw, dgs);
 	if (i > 0.f) {
 		const float ti = (i - 1.f) / (i + 1.f);
 		s *= ti * ti;
@@ -54,22 +55,26 @@ BSDF *GlossyTranslucent::GetBSDF(MemoryArena &arena, const SpectrumWavelengths &
 	s = s.Clamp(0.f, 1.f);
 	
 	SWCSpectrum a(Ka->Evaluate(sw, dgs).Clamp(0.f, 1.f));
-	float ld = depth->Evaluate(sw, dgs);
+	float ld = TextureEvaluationCache::Evaluate(*depth, sw, dgs);
 
-	SWCSpectrum bs(Ks_bf->Evaluate(sw, dgs));
-	float bi = index_bf->Evaluate(sw, dgs);
+	// One sided materials share the front face textures
+	SWCSpectrum bs(Ks_bf == Ks ? ks : Ks_bf->Evaluate(sw, dgs));
+	float bi = TextureEvaluationCache::Evaluate(*index_bf, sw, dgs);
 	if (bi > 0.f) {
 		const float bti = (bi - 1.f) / (bi + 1.f);
 		bs *= bti * bti;
 	}
 	bs = bs.Clamp(0.f, 1.f);
 
-	SWCSpectrum ba(Ka_bf->Evaluate(sw, dgs).Clamp(0.f, 1.f));
-	float bld = depth_bf->Evaluate(sw, dgs);
+	SWCSpectrum ba(Ka_bf == Ka ? a :
+		Ka_bf->Evaluate(sw, dgs).Clamp(0.f, 1.f));
+	float bld = TextureEvaluationCache::Evaluate(*depth_bf, sw, dgs);
 
 	// Clamp roughness values to avoid artifacts with too small values
-	const float u = Clamp(nu->Evaluate(sw, dgs), 6e-3f, 1.f);
-	const float v = Clamp(nv->Evaluate(sw, dgs), 6e-3f, 1.f);
+	const float u = Clamp(TextureEvaluationCache::Evaluate(*nu, sw, dgs),
+		6e-3f, 1.f);
+	const float v = Clamp(TextureEvaluationCache::Evaluate(*nv, sw, dgs),
+		6e-3f, 1.f);
 	const float u2 = u * u;
 	const float v2 = v * v;
 
@@ -77,8 +82,10 @@ BSDF *GlossyTranslucent::GetBSDF(MemoryArena &arena, const SpectrumWavelengths &
 	const float anisotropy = u2 < v2 ? 1.f - u2 / v2 : v2 / u2 - 1.f;
 	
 	// Clamp roughness values to avoid artifacts with too small values
-	const float bu = Clamp(nu_bf->Evaluate(sw, dgs), 6e-3f, 1.f);
-	const float bv = Clamp(nv_bf->Evaluate(sw, dgs), 6e-3f, 1.f);
+	const float bu = Clamp(TextureEvaluationCache::Evaluate(*nu_bf, sw,
+		dgs), 6e-3f, 1.f);
+	const float bv = Clamp(TextureEvaluationCache::Evaluate(*nv_bf, sw,
+		dgs), 6e-3f, 1.f);
 	const float bu2 = bu * bu;
 	const float bv2 = bv * bv;
 
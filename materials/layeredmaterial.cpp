@@ -45,7 +45,7 @@ void LayeredMaterial::addMat(MemoryArena &arena, const SpectrumWavelengths &sw,
 	BSDF *bsdfmat=mat->GetBSDF(arena,sw,isect, dgS);
 	float op = 1.0f;
 	if (opacity) {	// then need to mix with null
-			op= opacity->Evaluate(sw, dgS);
+			op= TextureEvaluationCache::Evaluate(*opacity, sw, dgS);
 			if (op<=0.0f) { // don't bother adding it
 				return;
 			}
@@ -53,9 +53,6 @@ void LayeredMaterial::addMat(MemoryArena &arena, const SpectrumWavelengths &sw,
 				isect.exterior, isect.interior);
 			mixbsdf->Add(op, bsdfmat);
 
-			dgS = dgShading;
-			mat->GetShadingGeometry(sw, isect.dg.nn, &dgS); // Why do we need to do this again?
-
 			SingleBSDF *nullbsdf = ARENA_ALLOC(arena, SingleBSDF)(dgShading,
 				isect.dg.nn, ARENA_ALLOC(arena, NullTransmission)(),
 				isect.exterior, isect.interior);
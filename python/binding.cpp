@@ -44,7 +44,11 @@ boost::python::object pythonErrorHandler;
 
 void luxErrorPython(int code, int severity, const char *message)
 {
+	// Messages can come from rendering threads or from calls made
+	// without the interpreter lock
+	PyGILState_STATE state = PyGILState_Ensure();
 	pythonErrorHandler(code, severity, message);
+	PyGILState_Release(state);
 }
 
 void pyLuxErrorHandler(boost::python::object handler)
@@ -40,13 +40,14 @@
 #define	EXTRACT_PARAMETERS(_params) \
 	std::vector<LuxToken> aTokens; \
 	std::vector<LuxPointer> aValues; \
-	int count = getParametersFromPython(_params, aTokens, aValues);
+	ParamSet bufferParams; \
+	int count = getParametersFromPython(_params, aTokens, aValues, bufferParams);
 
 #define PASS_PARAMETERS \
 	count, aTokens.size()>0?&aTokens[0]:0, aValues.size()>0?&aValues[0]:0
 
 #define PASS_PARAMSET \
-	ParamSet( count, name, aTokens.size()>0?&aTokens[0]:0, aValues.size()>0?&aValues[0]:0 )
+	makeParamSet(count, name, aTokens, aValues, bufferParams)
 
 namespace lux {
 
@@ -55,8 +56,161 @@ boost::once_flag luxInitFlag = BOOST_ONCE_INIT;
 //The memory pool handles temporary allocations and is freed after each C API Call
 boost::pool<> memoryPool(sizeof(char));
 
-//Here we transform a python list to lux C API parameter lists
-int getParametersFromPython(boost::python::list& pList, std::vector<LuxToken>& aTokens, std::vector<LuxPointer>& aValues )
+// Releases the Python interpreter lock for the lifetime of the object
+class ScopedGILRelease {
+public:
+	ScopedGILRelease() : state(PyEval_SaveThread()) { }
+	~ScopedGILRelease() { PyEval_RestoreThread(state); }
+private:
+	PyThreadState *state;
+};
+
+// Keeps a Python buffer alive as long as ParamSet arrays point into it
+struct PyBufferOwner {
+	PyBufferOwner(const Py_buffer &v) : view(v) { }
+	~PyBufferOwner() {
+		// The last reference can be dropped from any thread
+		PyGILState_STATE state = PyGILState_Ensure();
+		PyBuffer_Release(&view);
+		PyGILState_Release(state);
+	}
+	Py_buffer view;
+};
+
+template <class S, class T> bool convertBufferItems(const Py_buffer &view,
+	T *dst)
+{
+	if (view.itemsize != sizeof(S))
+		return false;
+	const S *src = static_cast<const S *>(view.buf);
+	const Py_ssize_t n = view.len / view.itemsize;
+	for (Py_ssize_t i = 0; i < n; ++i)
+		dst[i] = static_cast<T>(src[i]);
+	return true;
+}
+
+// Converts a buffer of any native numeric format in one tight loop
+template <class T> bool convertBuffer(const Py_buffer &view, char format,
+	T *dst)
+{
+	switch (format) {
+		case 'b': return convertBufferItems<signed char>(view, dst);
+		case 'B': return convertBufferItems<unsigned char>(view, dst);
+		case 'h': return convertBufferItems<short>(view, dst);
+		case 'H': return convertBufferItems<unsigned short>(view, dst);
+		case 'i': return convertBufferItems<int>(view, dst);
+		case 'I': return convertBufferItems<unsigned int>(view, dst);
+		case 'l': return convertBufferItems<long>(view, dst);
+		case 'L': return convertBufferItems<unsigned long>(view, dst);
+		case 'q': return convertBufferItems<long long>(view, dst);
+		case 'Q': return convertBufferItems<unsigned long long>(view, dst);
+		case 'f': return convertBufferItems<float>(view, dst);
+		case 'd': return convertBufferItems<double>(view, dst);
+		default: return false;
+	}
+}
+
+// Returns the data of the buffer as an array of T, without copy when the
+// buffer already has the right format, NULL if it can't be converted
+template <class T> const T *getBufferData(
+	const boost::shared_ptr<PyBufferOwner> &buffer, char format,
+	bool native, boost::shared_ptr<const void> &owner)
+{
+	const Py_buffer &view(buffer->view);
+	if (native) {
+		owner = buffer;
+		return static_cast<const T *>(view.buf);
+	}
+	T *data = new T[view.len / view.itemsize];
+	owner.reset(data, boost::checked_array_deleter<T>());
+	if (!convertBuffer(view, format, data))
+		return NULL;
+	return data;
+}
+
+// Adds a numeric parameter from an object supporting the buffer protocol
+// (numpy arrays, array.array, memoryview...) to params without going
+// through Python objects, returns false if the object isn't a buffer
+bool getBufferParameter(const std::string &token, PyObject *obj,
+	ParamSet &params)
+{
+	if (!PyObject_CheckBuffer(obj) || PyBytes_Check(obj) ||
+		PyUnicode_Check(obj))
+		return false;
+
+	Py_buffer view;
+	if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+		PyErr_Clear();
+		LOG( LUX_SEVERE,LUX_CONSISTENCY)<< "Passing non contiguous buffer to Python API for '"<<token<<"' token.";
+		return true;
+	}
+	boost::shared_ptr<PyBufferOwner> buffer(new PyBufferOwner(view));
+
+	ParamType type;
+	std::string name;
+	if (!LookupType(token.c_str(), &type, name))
+		return true;
+
+	// Only native and little endian formats are handled
+	const char *format = view.format ? view.format : "B";
+	if (*format == '@' || *format == '=' || *format == '<')
+		++format;
+	if (format[0] == '\0' || format[1] != '\0') {
+		LOG( LUX_SEVERE,LUX_CONSISTENCY)<< "Passing unrecognised buffer format '"<<view.format<<"' to Python API for '"<<token<<"' token.";
+		return true;
+	}
+	const u_int nItems = static_cast<u_int>(view.len / view.itemsize);
+
+	boost::shared_ptr<const void> owner;
+	if (type == PARAM_TYPE_INT) {
+		const bool native = (*format == 'i' || *format == 'l') &&
+			view.itemsize == sizeof(int);
+		const int *data = getBufferData<int>(buffer, *format, native, owner);
+		if (data)
+			params.AddInt(name, data, nItems, owner);
+		else
+			LOG( LUX_SEVERE,LUX_CONSISTENCY)<< "Passing unrecognised buffer format '"<<view.format<<"' to Python API for '"<<token<<"' token.";
+		return true;
+	}
+	if (type != PARAM_TYPE_FLOAT && type != PARAM_TYPE_POINT &&
+		type != PARAM_TYPE_VECTOR && type != PARAM_TYPE_NORMAL &&
+		type != PARAM_TYPE_COLOR) {
+		LOG( LUX_SEVERE,LUX_CONSISTENCY)<< "Passing buffer to Python API for non numeric '"<<token<<"' token.";
+		return true;
+	}
+	const bool native = *format == 'f' && view.itemsize == sizeof(float);
+	const float *data = getBufferData<float>(buffer, *format, native, owner);
+	if (!data) {
+		LOG( LUX_SEVERE,LUX_CONSISTENCY)<< "Passing unrecognised buffer format '"<<view.format<<"' to Python API for '"<<token<<"' token.";
+		return true;
+	}
+	switch (type) {
+		case PARAM_TYPE_FLOAT:
+			params.AddFloat(name, data, nItems, owner);
+			break;
+		case PARAM_TYPE_POINT:
+			params.AddPoint(name, reinterpret_cast<const Point *>(data),
+				nItems / 3, owner);
+			break;
+		case PARAM_TYPE_VECTOR:
+			params.AddVector(name, reinterpret_cast<const Vector *>(data),
+				nItems / 3, owner);
+			break;
+		case PARAM_TYPE_NORMAL:
+			params.AddNormal(name, reinterpret_cast<const Normal *>(data),
+				nItems / 3, owner);
+			break;
+		default:
+			params.AddRGBColor(name, reinterpret_cast<const RGBColor *>(data),
+				nItems / 3, owner);
+			break;
+	}
+	return true;
+}
+
+//Here we transform a python list to lux C API parameter lists,
+//parameters given as buffers are directly added to bufferParams
+int getParametersFromPython(boost::python::list& pList, std::vector<LuxToken>& aTokens, std::vector<LuxPointer>& aValues, ParamSet &bufferParams)
 {
 	boost::python::ssize_t n = boost::python::len(pList);
 
@@ -92,6 +246,10 @@ int getParametersFromPython(boost::python::list& pList, std::vector<LuxToken>& a
 			parameter_value = boost::python::extract<boost::python::object>(l[1]);
 		}
 
+		// Buffers are handed to the core without per element conversion
+		if (getBufferParameter(tokenString, parameter_value.ptr(), bufferParams))
+			continue;
+
 		char *tok=(char *)memoryPool.ordered_malloc(sizeof(char)*tokenString.length()+1);
 		strcpy(tok,tokenString.c_str());
 		aTokens.push_back(tok);
@@ -219,7 +377,17 @@ int getParametersFromPython(boost::python::list& pList, std::vector<LuxToken>& a
 		}
 
 	}
-	return(n);
+	return static_cast<int>(aTokens.size());
+}
+
+ParamSet makeParamSet(int count, const char *name,
+	std::vector<LuxToken>& aTokens, std::vector<LuxPointer>& aValues,
+	const ParamSet &bufferParams)
+{
+	ParamSet params(count, name, aTokens.size()>0?&aTokens[0]:0, aValues.size()>0?&aValues[0]:0);
+	// The buffer arrays are shared, not copied
+	params.Add(bufferParams);
+	return params;
 }
 
 int framebuffer_getbuffer(PyObject *exporter, Py_buffer *view, int flags) {
@@ -805,6 +973,21 @@ public:
 		pyLuxWorldEndThreads.push_back(new boost::thread( boost::bind(&PyContext::pyWorldEnd, this) ));
 	}
 
+	void editBegin()
+	{
+		checkActiveContext();
+		// Waits for the rendering threads to be suspended
+		ScopedGILRelease releaseGIL;
+		context->EditBegin();
+	}
+
+	void editEnd()
+	{
+		checkActiveContext();
+		ScopedGILRelease releaseGIL;
+		context->EditEnd();
+	}
+
 	void loadFLM(const char* name)
 	{
 		checkActiveContext();
@@ -1281,6 +1464,12 @@ public:
 		context->DisableRandomMode();
 	}
 
+	void setSceneEditing(bool enable)
+	{
+		checkActiveContext();
+		context->SetSceneEditing(enable);
+	}
+
 	std::string name;
 
 private:
@@ -1453,6 +1642,16 @@ void export_PyContext()
 			args("Context"),
 			ds_pylux_Context_disableRandomMode
 		)
+		.def("editBegin",
+			&PyContext::editBegin,
+			args("Context"),
+			ds_pylux_Context_editBegin
+		)
+		.def("editEnd",
+			&PyContext::editEnd,
+			args("Context"),
+			ds_pylux_Context_editEnd
+		)
 		.def("enableDebugMode",
 			&PyContext::enableDebugMode,
 			args("Context"),
@@ -1742,6 +1941,11 @@ void export_PyContext()
 			args("Context"),
 			ds_pylux_Context_setStringParameterValue
 		)
+		.def("setSceneEditing",
+			&PyContext::setSceneEditing,
+			args("Context", "enable"),
+			ds_pylux_Context_setSceneEditing
+		)
 		.def("shape",
 			&PyContext::shape,
 			args("Context", "type", "ParamSet"),
@@ -87,6 +87,16 @@ const char * ds_pylux_Context_coordinateSystem =
 const char * ds_pylux_Context_disableRandomMode =
 "Disables random mode in the renderer core.";
 
+const char * ds_pylux_Context_editBegin =
+"Suspends the rendering to edit the scene being rendered. Until editEnd() the\n"
+"camera() call replaces the camera, makeNamedMaterial() and texture() replace\n"
+"named materials and textures, and objectInstance() moves all instances of an\n"
+"object to the current transform. Requires setSceneEditing(True).";
+
+const char * ds_pylux_Context_editEnd =
+"Applies the scene edits started with editBegin() and resumes the rendering\n"
+"from a clean film.";
+
 const char * ds_pylux_Context_enableDebugMode =
 "Puts the renderer core into Debug mode.";
 
@@ -301,6 +311,10 @@ const char * ds_pylux_Context_setEpsilon =
 const char * ds_pylux_Context_setHaltSamplesPerPixel =
 "";
 
+const char * ds_pylux_Context_setSceneEditing =
+"Keeps the texture and material descriptions needed by editBegin(), must be\n"
+"enabled before loading the scene to edit.";
+
 const char * ds_pylux_Context_setNetworkServerUpdateInterval =
 "Sets the network server update interval in seconds";
 
@@ -326,7 +340,10 @@ const char * ds_pylux_Context_shape =
 "- plymesh\n"
 "- sphere\n"
 "- trianglemesh\n"
-"- mesh";
+"- mesh\n"
+"Numeric parameter values can be given as objects supporting the buffer\n"
+"protocol (numpy arrays, array.array, memoryview), C contiguous float32 and\n"
+"int32 data is then used without copy and must not be modified afterwards.";
 
 const char * ds_pylux_Context_start =
 "(+) Re-start local rendering threads after a pause()";
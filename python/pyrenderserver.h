@@ -72,7 +72,7 @@ void export_PyRenderServer()
 	class_<RenderServer, boost::noncopyable>(
 		"RenderServer",
 		ds_pylux_RenderServer,
-		init<int, std::string, optional<int,bool> >(args("RenderServer", "threadCount", "serverPass", "tcpPort", "writeFlmFile"))
+		init<int, std::string, optional<int,bool,unsigned int,unsigned int> >(args("RenderServer", "threadCount", "serverPass", "tcpPort", "writeFlmFile", "queueSize", "cacheSize"))
 		)
 		/* .def_readonly("DEFAULT_TCP_PORT", &RenderServer::DEFAULT_TCP_PORT) // Doesn't currently work */
 		.def("getServerPort",
@@ -30,6 +30,7 @@
 #include "hybridsamplerrenderer.h"
 #include "randomgen.h"
 #include "context.h"
+#include "loadprofiler.h"
 #include "integrators/path.h"
 #include "renderers/statistics/hybridsamplerstatistics.h"
 
@@ -377,9 +378,18 @@ void HybridSamplerRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		scene->sampler->SetFilm(scene->camera()->film);
-		scene->surfaceIntegrator->Preprocess(rng, *scene);
-		scene->volumeIntegrator->Preprocess(rng, *scene);
-		scene->camera()->film->CreateBuffers();
+		{
+			LoadPhase phase("preprocess.surfaceintegrator");
+			scene->surfaceIntegrator->Preprocess(rng, *scene);
+		}
+		{
+			LoadPhase phase("preprocess.volumeintegrator");
+			scene->volumeIntegrator->Preprocess(rng, *scene);
+		}
+		{
+			LoadPhase phase("film.buffers");
+			scene->camera()->film->CreateBuffers();
+		}
 
 		scene->surfaceIntegrator->RequestSamples(scene->sampler, *scene);
 		scene->volumeIntegrator->RequestSamples(scene->sampler, *scene);
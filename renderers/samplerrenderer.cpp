@@ -28,6 +28,7 @@
 #include "samplerrenderer.h"
 #include "randomgen.h"
 #include "context.h"
+#include "loadprofiler.h"
 #include "renderers/statistics/samplerstatistics.h"
 
 using namespace lux;
@@ -76,12 +77,15 @@ SRHostDescription::~SRHostDescription() {
 
 SamplerRenderer::SamplerRenderer() : Renderer() {
 	state = INIT;
+	stateBeforeEdit = INIT;
 
 	SRHostDescription *host = new SRHostDescription(this, "Localhost");
 	hosts.push_back(host);
 
 	preprocessDone = false;
 	suspendThreadsWhenDone = false;
+	pausedThreads = 0;
+	sceneEdits = 0;
 
 	AddStringConstant(*this, "name", "Name of current renderer", "sampler");
 
@@ -173,9 +177,18 @@ void SamplerRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		scene->sampler->SetFilm(scene->camera()->film);
-		scene->surfaceIntegrator->Preprocess(rng, *scene);
-		scene->volumeIntegrator->Preprocess(rng, *scene);
-		scene->camera()->film->CreateBuffers();
+		{
+			LoadPhase phase("preprocess.surfaceintegrator");
+			scene->surfaceIntegrator->Preprocess(rng, *scene);
+		}
+		{
+			LoadPhase phase("preprocess.volumeintegrator");
+			scene->volumeIntegrator->Preprocess(rng, *scene);
+		}
+		{
+			LoadPhase phase("film.buffers");
+			scene->camera()->film->CreateBuffers();
+		}
 
 		scene->surfaceIntegrator->RequestSamples(scene->sampler, *scene);
 		scene->volumeIntegrator->RequestSamples(scene->sampler, *scene);
@@ -242,11 +255,67 @@ void SamplerRenderer::Resume() {
 	boost::mutex::scoped_lock lock(classWideMutex);
 	state = RUN;
 	rendererStatistics->start();
+	pauseCondition.notify_all();
 }
 
 void SamplerRenderer::Terminate() {
 	boost::mutex::scoped_lock lock(classWideMutex);
 	state = TERMINATE;
+	pauseCondition.notify_all();
+}
+
+bool SamplerRenderer::BeginSceneEdit() {
+	// The number of threads can't change until EndSceneEdit()
+	renderThreadsMutex.lock();
+
+	boost::mutex::scoped_lock lock(classWideMutex);
+	// Threads waiting for the end of the preprocessing would never be
+	// counted as paused
+	if (!preprocessDone || (state != RUN && state != PAUSE)) {
+		renderThreadsMutex.unlock();
+		return false;
+	}
+	// A render paused by the user stays paused after the edit
+	stateBeforeEdit = state;
+	if (state == RUN) {
+		state = PAUSE;
+		rendererStatistics->stop();
+	}
+
+	// Wait for all threads to be out of the scene, the threads which
+	// already exited will never be paused
+	u_int running = RunningThreads();
+	while (state == PAUSE && running > 0 && pausedThreads < running) {
+		pauseCondition.wait(lock);
+		running = RunningThreads();
+	}
+	if (state != PAUSE || running == 0) {
+		if (state == PAUSE && stateBeforeEdit == RUN) {
+			state = RUN;
+			rendererStatistics->start();
+			pauseCondition.notify_all();
+		}
+		renderThreadsMutex.unlock();
+		return false;
+	}
+
+	// Nothing computed before the edit must reach the film
+	scene->camera()->film->contribPool->Discard();
+
+	return true;
+}
+
+void SamplerRenderer::EndSceneEdit() {
+	{
+		boost::mutex::scoped_lock lock(classWideMutex);
+		++sceneEdits;
+		if (state == PAUSE && stateBeforeEdit == RUN) {
+			state = RUN;
+			rendererStatistics->start();
+		}
+		pauseCondition.notify_all();
+	}
+	renderThreadsMutex.unlock();
 }
 
 //------------------------------------------------------------------------------
@@ -267,6 +336,30 @@ void SamplerRenderer::CreateRenderThread() {
 	}
 }
 
+void SamplerRenderer::WaitWhilePaused() {
+	boost::mutex::scoped_lock lock(classWideMutex);
+	++pausedThreads;
+	pauseCondition.notify_all();
+	while (state == PAUSE && !boost::this_thread::interruption_requested())
+		pauseCondition.timed_wait(lock, boost::posix_time::seconds(1));
+	--pausedThreads;
+}
+
+void SamplerRenderer::ThreadExited(RenderThread *rt) {
+	boost::mutex::scoped_lock lock(classWideMutex);
+	rt->running = false;
+	pauseCondition.notify_all();
+}
+
+u_int SamplerRenderer::RunningThreads() const {
+	u_int running = 0;
+	for (u_int i = 0; i < renderThreads.size(); ++i) {
+		if (renderThreads[i]->running)
+			++running;
+	}
+	return running;
+}
+
 void SamplerRenderer::RemoveRenderThread() {
 	if (renderThreads.size() == 0)
 		return;
@@ -283,7 +376,8 @@ void SamplerRenderer::RemoveRenderThread() {
 
 
 SamplerRenderer::RenderThread::RenderThread(u_int index, SamplerRenderer *r) :
-	n(index), renderer(r), thread(NULL), samples(0.), blackSamples(0.), blackSamplePaths(0.) {
+	n(index), renderer(r), thread(NULL), samples(0.), blackSamples(0.), blackSamplePaths(0.),
+	running(true) {
 }
 
 SamplerRenderer::RenderThread::~RenderThread() {
@@ -293,8 +387,10 @@ SamplerRenderer::RenderThread::~RenderThread() {
 void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 	SamplerRenderer *renderer = myThread->renderer;
 	Scene &scene(*(renderer->scene));
-	if (scene.IsFilmOnly())
+	if (scene.IsFilmOnly()) {
+		renderer->ThreadExited(myThread);
 		return;
+	}
 
 	// To avoid interrupt exception
 	boost::this_thread::disable_interruption di;
@@ -322,6 +418,7 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 	sample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool);
 	sample.camera = scene.camera()->Clone();
 	sample.realTime = 0.f;
+	u_int sceneEdits = renderer->sceneEdits;
 
 	// Trace rays: The main loop
 	while (true) {
@@ -330,9 +427,7 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 			if (renderer->suspendThreadsWhenDone) {
 				// Dade - wait for a resume rendering or exit
 				renderer->Pause();
-				while (renderer->state == PAUSE) {
-					boost::this_thread::sleep(boost::posix_time::seconds(1));
-				}
+				renderer->WaitWhilePaused();
 
 				if (renderer->state == TERMINATE)
 					break;
@@ -352,12 +447,22 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 		// Sample new SWC thread wavelengths
 		sample.swl.Sample(sample.wavelengths);
 
-		while (renderer->state == PAUSE && !boost::this_thread::interruption_requested()) {
-			boost::this_thread::sleep(boost::posix_time::seconds(1));
-		}
+		if (renderer->state == PAUSE)
+			renderer->WaitWhilePaused();
 		if ((renderer->state == TERMINATE) || boost::this_thread::interruption_requested())
 			break;
 
+		// Pick up the edited camera and drop what was computed for the
+		// previous version of the scene
+		if (renderer->sceneEdits != sceneEdits) {
+			sceneEdits = renderer->sceneEdits;
+			delete sample.camera;
+			sample.camera = scene.camera()->Clone();
+			sample.realTime = sample.camera->GetTime(sample.time);
+			sample.camera->SampleMotion(sample.realTime);
+			sample.contribBuffer->Discard();
+		}
+
 		// Evaluate radiance along camera ray
 		// Jeanphi - Hijack statistics until volume integrator revamp
 		{
@@ -386,6 +491,7 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 	sample.contribBuffer = NULL;
 
 	sampler->FreeSample(&sample);
+	renderer->ThreadExited(myThread);
 }
 
 Renderer *SamplerRenderer::CreateRenderer(const ParamSet &params) {
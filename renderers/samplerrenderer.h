@@ -107,6 +107,9 @@ public:
 	void Resume();
 	void Terminate();
 
+	bool BeginSceneEdit();
+	void EndSceneEdit();
+
 	friend class SRDeviceDescription;
 	friend class SRHostDescription;
 	friend class SRStatistics;
@@ -130,17 +133,30 @@ private:
 		boost::thread *thread; // keep pointer to delete the thread object
 		double samples, blackSamples, blackSamplePaths;
 		fast_mutex statLock;
+		// Cleared under classWideMutex when RenderImpl() returns
+		bool running;
 	};
 
 	void CreateRenderThread();
 	void RemoveRenderThread();
+	// Blocks the calling rendering thread while the renderer is paused
+	void WaitWhilePaused();
+	// Marks a rendering thread as no longer rendering
+	void ThreadExited(RenderThread *rt);
+	// Number of rendering threads which haven't exited yet,
+	// called with renderThreadsMutex and classWideMutex locked
+	u_int RunningThreads() const;
 
 	//--------------------------------------------------------------------------
 
 	mutable boost::mutex classWideMutex;
 	mutable boost::mutex renderThreadsMutex;
+	// Signaled on state changes and when a rendering thread is paused
+	boost::condition_variable pauseCondition;
 
 	RendererState state;
+	// State restored by EndSceneEdit()
+	RendererState stateBeforeEdit;
 	vector<RendererHostDescription *> hosts;
 	vector<RenderThread *> renderThreads;
 	Scene *scene;
@@ -148,6 +164,11 @@ private:
 	fast_mutex sampPosMutex;
 	u_int sampPos;
 
+	// Number of rendering threads waiting in WaitWhilePaused()
+	u_int pausedThreads;
+	// Incremented after each scene edit
+	u_int sceneEdits;
+
 	// Put them last for better data alignment
 	// used to suspend render threads until the preprocessing phase is done
 	bool preprocessDone;
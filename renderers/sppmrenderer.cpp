@@ -35,6 +35,7 @@
 #include "sampling.h"
 #include "randomgen.h"
 #include "context.h"
+#include "loadprofiler.h"
 #include "light.h"
 #include "luxrays/core/color/spectrumwavelengths.h"
 #include "reflection/bxdf.h"
@@ -193,8 +194,14 @@ void SPPMRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		// sppm integrator will create film buffers
-		scene->surfaceIntegrator->Preprocess(*rng, *scene);
-		scene->volumeIntegrator->Preprocess(*rng, *scene);
+		{
+			LoadPhase phase("preprocess.surfaceintegrator");
+			scene->surfaceIntegrator->Preprocess(*rng, *scene);
+		}
+		{
+			LoadPhase phase("preprocess.volumeintegrator");
+			scene->volumeIntegrator->Preprocess(*rng, *scene);
+		}
 
 		// Told each Buffer how to scale things
 		for(u_int bg = 0; bg < scene->camera()->film->GetNumBufferGroups(); ++bg)
@@ -0,0 +1,231 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#include "filecache.h"
+#include "error.h"
+
+#include <algorithm>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+using namespace lux;
+using namespace std;
+
+FileCache::FileCache(unsigned long long mSize) : maxSize(mSize), size(0),
+	hits(0), lookups(0)
+{
+}
+
+void FileCache::Scan()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	entries.clear();
+	size = 0;
+
+	boost::system::error_code ec;
+	boost::filesystem::directory_iterator it(boost::filesystem::current_path(), ec), end;
+	for (; !ec && it != end; it.increment(ec)) {
+		const string filename(it->path().filename().string());
+		// Files left over by interrupted uploads
+		if (filename.compare(0, 5, "part_") == 0) {
+			boost::filesystem::remove(it->path(), ec);
+			ec.clear();
+			continue;
+		}
+		// Only the files written by the render server
+		if (filename.compare(0, 4, "tmp_") != 0 ||
+			!boost::filesystem::is_regular_file(it->status()))
+			continue;
+
+		Entry &entry(entries[filename]);
+		entry.size = boost::filesystem::file_size(it->path(), ec);
+		entry.lastUse = boost::filesystem::last_write_time(it->path(), ec);
+		if (ec) {
+			entries.erase(filename);
+			ec.clear();
+			continue;
+		}
+		size += entry.size;
+	}
+
+	LOG(LUX_INFO, LUX_NOERROR) << "File cache: " << entries.size() <<
+		" files, " << (size / 1000000) << " Mbytes";
+	if (maxSize > 0)
+		Evict();
+}
+
+void FileCache::BeginSession(const string &session)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	currentSession = session;
+}
+
+string FileCache::GetSession() const
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return currentSession;
+}
+
+bool FileCache::Lookup(const string &filename, const string &session)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	++lookups;
+	boost::system::error_code ec;
+	map<string, Entry>::iterator it = entries.find(filename);
+	if (it == entries.end()) {
+		// The file may have been put there by hand
+		if (!boost::filesystem::exists(filename, ec))
+			return false;
+		Entry &entry(entries[filename]);
+		entry.size = boost::filesystem::file_size(filename, ec);
+		if (ec)
+			entry.size = 0;
+		size += entry.size;
+		it = entries.find(filename);
+	} else if (!boost::filesystem::exists(filename, ec)) {
+		// Removed behind our back
+		size -= it->second.size;
+		entries.erase(it);
+		return false;
+	}
+
+	++hits;
+	Touch(filename, it->second, session);
+	return true;
+}
+
+void FileCache::Insert(const string &filename, const string &session)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	boost::system::error_code ec;
+	// Empty files are not written
+	if (!boost::filesystem::exists(filename, ec))
+		return;
+
+	Entry &entry(entries[filename]);
+	size -= entry.size;
+	entry.size = boost::filesystem::file_size(filename, ec);
+	if (ec)
+		entry.size = 0;
+	size += entry.size;
+	Touch(filename, entry, session);
+
+	if (maxSize > 0)
+		Evict();
+}
+
+void FileCache::EndSession()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	if (lookups > 0)
+		LOG(LUX_INFO, LUX_NOERROR) << "File cache: " << hits << " hits out of " <<
+			lookups << " lookups (" << (100 * hits / lookups) << "%), " <<
+			entries.size() << " files, " << (size / 1000000) << " Mbytes";
+	// The files prefetched by queued sessions stay pinned
+	sessionFiles.erase(currentSession);
+	currentSession.clear();
+}
+
+void FileCache::ReleaseSession(const string &session)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	sessionFiles.erase(session);
+}
+
+unsigned long long FileCache::GetSize() const
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return size;
+}
+
+u_int FileCache::GetHits() const
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return hits;
+}
+
+u_int FileCache::GetLookups() const
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return lookups;
+}
+
+void FileCache::Touch(const string &filename, Entry &entry,
+	const string &session)
+{
+	// NOTE - requires cacheMutex to be acquired by caller
+	entry.lastUse = time(NULL);
+	sessionFiles[session].insert(filename);
+	// The modification time keeps the use order across server restarts
+	boost::system::error_code ec;
+	boost::filesystem::last_write_time(filename, entry.lastUse, ec);
+}
+
+bool FileCache::IsUsed(const string &filename) const
+{
+	// NOTE - requires cacheMutex to be acquired by caller
+	for (map<string, set<string> >::const_iterator it = sessionFiles.begin(); it != sessionFiles.end(); ++it) {
+		if (it->second.find(filename) != it->second.end())
+			return true;
+	}
+	return false;
+}
+
+static bool OlderUse(const pair<time_t, string> &a, const pair<time_t, string> &b)
+{
+	return a.first < b.first;
+}
+
+void FileCache::Evict()
+{
+	// NOTE - requires cacheMutex to be acquired by caller
+	if (size <= maxSize)
+		return;
+
+	vector<pair<time_t, string> > candidates;
+	for (map<string, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+		if (!IsUsed(it->first))
+			candidates.push_back(make_pair(it->second.lastUse, it->first));
+	}
+	sort(candidates.begin(), candidates.end(), OlderUse);
+
+	for (size_t i = 0; i < candidates.size() && size > maxSize; ++i) {
+		const string &filename(candidates[i].second);
+		boost::system::error_code ec;
+		if (!boost::filesystem::remove(filename, ec) && ec) {
+			LOG(LUX_ERROR, LUX_SYSTEM) << "Error removing cached file '" <<
+				filename << "', error code: '" << ec << "'";
+			continue;
+		}
+		LOG(LUX_DEBUG, LUX_NOERROR) << "Evicting cached file '" << filename << "'";
+		size -= entries[filename].size;
+		entries.erase(filename);
+	}
+
+	if (size > maxSize)
+		LOG(LUX_WARNING, LUX_NOERROR) << "File cache size " << (size / 1000000) <<
+			" Mbytes exceeds the limit, the current and queued sessions use all the files";
+}
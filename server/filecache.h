@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#ifndef LUX_FILECACHE_H
+#define LUX_FILECACHE_H
+
+#include "lux.h"
+
+#include <ctime>
+#include <map>
+#include <set>
+#include <boost/thread/mutex.hpp>
+
+namespace lux
+{
+
+// Keeps the files uploaded by masters in the server cache directory across
+// sessions. Files are named after their tiger hash, so a file is found again
+// whatever scene references it. The least recently used files are removed
+// when the cache grows beyond its size limit, except the ones used by the
+// current session or prefetched by a queued session.
+class FileCache {
+public:
+	// maxSize is in bytes, 0 means no limit
+	FileCache(unsigned long long maxSize = 0);
+
+	// Indexes the cached files already present in the current directory
+	void Scan();
+
+	// Makes session the current one
+	void BeginSession(const std::string &session);
+	std::string GetSession() const;
+
+	// Returns true if the file is in the cache and marks it as used
+	// by session
+	bool Lookup(const std::string &filename, const std::string &session);
+	// Adds a newly received file used by session and evicts old ones
+	// if needed
+	void Insert(const std::string &filename, const std::string &session);
+	// Releases the files used by the current session
+	void EndSession();
+	// Releases the files used by session, e.g. a cancelled queued one
+	void ReleaseSession(const std::string &session);
+
+	unsigned long long GetMaxSize() const { return maxSize; }
+	unsigned long long GetSize() const;
+	u_int GetHits() const;
+	u_int GetLookups() const;
+
+private:
+	struct Entry {
+		unsigned long long size;
+		std::time_t lastUse;
+	};
+
+	void Touch(const std::string &filename, Entry &entry,
+		const std::string &session);
+	bool IsUsed(const std::string &filename) const;
+	void Evict();
+
+	unsigned long long maxSize;
+	unsigned long long size;
+	u_int hits, lookups;
+
+	std::map<std::string, Entry> entries;
+	// Files used by each session, never evicted while the session
+	// is current or queued
+	std::map<std::string, std::set<std::string> > sessionFiles;
+	std::string currentSession;
+	mutable boost::mutex cacheMutex;
+};
+
+}//namespace lux
+
+#endif // LUX_FILECACHE_H
@@ -38,6 +38,7 @@
 #include <boost/version.hpp>
 #include <boost/filesystem.hpp>
 #include <fstream>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
@@ -77,25 +78,35 @@ typedef boost::asio::ip::tcp::iostream socket_stream_t;
 // RenderServer
 //------------------------------------------------------------------------------
 
-RenderServer::RenderServer(int tCount, const std::string &serverPassword, int port, bool wFlmFile) : errorMessages(), threadCount(tCount),
-	tcpPort(port), writeFlmFile(wFlmFile), state(UNSTARTED), serverPass(serverPassword), serverThread(NULL)
+RenderServer::RenderServer(int tCount, const std::string &serverPassword, int port, bool wFlmFile, unsigned int qSize, unsigned int cacheSize) : errorMessages(), threadCount(tCount),
+	tcpPort(port), writeFlmFile(wFlmFile), state(UNSTARTED), serverPass(serverPassword), serverThread(NULL),
+	queueSize(qSize), awaitingScene(false), fileCache(cacheSize * 1000000ULL)
 {
 }
 
 RenderServer::~RenderServer()
 {
-	if ((state == READY) || (state == BUSY))
+	const ServerState currentState = getServerState();
+	if ((currentState == READY) || (currentState == BUSY))
 		stop();
 }
 
 void RenderServer::start() {
-	if (state != UNSTARTED) {
-		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not start a rendering server in state: " << state;
+	const ServerState currentState = getServerState();
+	if (currentState != UNSTARTED) {
+		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not start a rendering server in state: " << currentState;
 		return;
 	}
 
 	LOG( LUX_INFO,LUX_NOERROR) << "Launching server mode [" << threadCount << " threads]";
+	if (queueSize > 0)
+		LOG( LUX_INFO,LUX_NOERROR) << "Queueing up to " << queueSize << " sessions";
 	LOG( LUX_DEBUG,LUX_NOERROR) << "Server version " << LUX_SERVER_VERSION_STRING;
+	if (fileCache.GetMaxSize() > 0)
+		LOG( LUX_INFO,LUX_NOERROR) << "File cache limited to " << (fileCache.GetMaxSize() / 1000000) << " Mbytes";
+
+	// The files of previous runs are in the cache directory
+	fileCache.Scan();
 
 	// Dade - start the tcp server threads
 	serverThread = new NetworkRenderServerThread(this);
@@ -105,13 +116,14 @@ void RenderServer::start() {
 	serverThread->serverThread4 = new boost::thread(boost::bind(
 		NetworkRenderServerThread::run, 4, serverThread));
 
-	state = READY;
+	setServerState(READY);
 }
 
 void RenderServer::join()
 {
-	if ((state != READY) && (state != BUSY)) {
-		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not join a rendering server in state: " << state;
+	const ServerState currentState = getServerState();
+	if ((currentState != READY) && (currentState != BUSY)) {
+		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not join a rendering server in state: " << currentState;
 		return;
 	}
 
@@ -120,15 +132,16 @@ void RenderServer::join()
 
 void RenderServer::stop()
 {
-	if ((state != READY) && (state != BUSY)) {
-		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not stop a rendering server in state: " << state;
+	const ServerState currentState = getServerState();
+	if ((currentState != READY) && (currentState != BUSY)) {
+		LOG( LUX_ERROR,LUX_SYSTEM) << "Can not stop a rendering server in state: " << currentState;
 		return;
 	}
 
 	serverThread->interrupt();
 	serverThread->join();
 
-	state = STOPPED;
+	setServerState(STOPPED);
 }
 
 void RenderServer::errorHandler(int code, int severity, const char *msg) {
@@ -267,7 +280,11 @@ static bool receiveFile(const std::string &filename, const std::string &filehash
 
 	// Dade - fix for bug 514: avoid to create the file if it is empty
 	if (len > 0) {
-		std::ofstream out(filename.c_str(), ios::out | ios::binary);
+		// Written under another name then renamed, a session looking
+		// up the file while a prefetch receives it never sees it
+		// partially written
+		const string partFilename("part_" + filename);
+		std::ofstream out(partFilename.c_str(), ios::out | ios::binary);
 
 		//std::streamsize written = boost::iostreams::copy(
 		//	boost::iostreams::restrict(stream, 0, len), out);
@@ -299,11 +316,11 @@ static bool receiveFile(const std::string &filename, const std::string &filehash
 
 			LOG( LUX_ERROR,LUX_SYSTEM) << "There was an error while receiving file '" << filename << "', received " << written 
 				<< " bytes, source size " << source_len << " bytes, received file hash " << hash << ", source hash " << filehash;
-			LOG( LUX_INFO,LUX_SYSTEM) << "Removing incomplete file '" << filename << "'";
+			LOG( LUX_INFO,LUX_SYSTEM) << "Removing incomplete file '" << partFilename << "'";
 
 			boost::system::error_code ec;
-			if (!boost::filesystem::remove(filename, ec)) {
-				LOG( LUX_ERROR,LUX_SYSTEM) << "Error removing file '" << filename << "', error code: '" << ec << "'";
+			if (!boost::filesystem::remove(partFilename, ec)) {
+				LOG( LUX_ERROR,LUX_SYSTEM) << "Error removing file '" << partFilename << "', error code: '" << ec << "'";
 			}
 
 			if (output_error)
@@ -312,12 +329,22 @@ static bool receiveFile(const std::string &filename, const std::string &filehash
 			
 			return false;
 		}
+
+		out.close();
+		boost::system::error_code ec;
+		boost::filesystem::rename(partFilename, filename, ec);
+		if (ec) {
+			LOG( LUX_ERROR,LUX_SYSTEM) << "Error renaming file '" << partFilename << "' to '" << filename << "', error code: '" << ec << "'";
+			boost::filesystem::remove(partFilename, ec);
+			throw std::runtime_error("Error writing file '" + filename + "'");
+		}
 	}
 	return true;
 }
 
 //static void processFiles(ParamSet &params, std::set<string> &tmpFiles, std::iostream &stream) {
-static void processFiles(ParamSet &params, socket_stream_t &stream) {
+static void processFiles(FileCache &cache, ParamSet &params, socket_stream_t &stream,
+	const string &session) {
 	LOG(LUX_DEBUG,LUX_NOERROR) << "Receiving file index";
 
 	string s = get_response(stream);
@@ -363,8 +390,7 @@ static void processFiles(ParamSet &params, socket_stream_t &stream) {
 		tfile.replace_extension(fname.extension());
 
 		//if (tmpFiles.find(tfile.string()) == tmpFiles.end()) {
-		boost::system::error_code ec;
-		if (!boost::filesystem::exists(tfile, ec)) {
+		if (!cache.Lookup(tfile.string(), session)) {
 			LOG( LUX_INFO,LUX_NOERROR) << "Requesting file '" << filename << "' (as '" << tfile.string() << "')";
 			neededFiles.push_back(std::make_pair(hash, tfile.string()));
 		} else {
@@ -392,17 +418,26 @@ static void processFiles(ParamSet &params, socket_stream_t &stream) {
 				throw std::runtime_error("Error receiving file '" + fname + "'");
 		}
 		stream << "FILE OK" << "\n";
+		cache.Insert(fname, session);
 		//tmpFiles.insert(neededFiles[i].second);
 	}
 
+	// Let the master know how well the cache does
+	stream << "FILE CACHE " << cache.GetHits() << " " << cache.GetLookups() << "\n";
 	stream << "END FILES" << "\n";
 
 	if (!read_response(stream, "END FILES OK"))
 		return;
 }
 
+// Files of the commands of the current session
+static void processFiles(FileCache &cache, ParamSet &params, socket_stream_t &stream) {
+	processFiles(cache, params, stream, cache.GetSession());
+}
+
 static void processCommandFilm(bool isLittleEndian,
-		void (Context::*f)(const string &, const ParamSet &), socket_stream_t &stream)
+		void (Context::*f)(const string &, const ParamSet &),
+		FileCache &cache, socket_stream_t &stream)
 {
 	string type;
 	getline(stream, type);
@@ -415,7 +450,7 @@ static void processCommandFilm(bool isLittleEndian,
 	ParamSet params;
 	processCommandParams(isLittleEndian, params, stream);
 
-	processFiles(params, stream);
+	processFiles(cache, params, stream);
 
 	// Dade - overwrite some option for the servers
 
@@ -454,7 +489,7 @@ static void processCommandFilm(bool isLittleEndian,
 
 static void processCommand(bool isLittleEndian,
 	void (Context::*f)(const string &, const ParamSet &),
-	vector<string> &tmpFileList, socket_stream_t &stream)
+	FileCache &cache, socket_stream_t &stream)
 {
 	string type;
 	getline(stream, type);
@@ -466,7 +501,7 @@ static void processCommand(bool isLittleEndian,
 	//processFile("iesname", params, tmpFileList, stream);
 	//processFile("configfile", params, tmpFileList, stream);
 	//processFile("filename", params, tmpFileList, stream);
-	processFiles(params, stream);
+	processFiles(cache, params, stream);
 
 	(Context::GetActive()->*f)(type, params);
 }
@@ -541,39 +576,147 @@ static void cleanupSession(NetworkRenderServerThread *serverThread, vector<strin
 	// Dade - remove all temporary files
 	for (size_t i = 1; i < tmpFileList.size(); i++)
 		remove(tmpFileList[i]);
+	// uploaded files stay in the cache for the next sessions
+	serverThread->renderServer->getFileCache().EndSession();
+
+	// The next queued session, if any, takes over right away, its
+	// master sends the scene once it notices on reconnection
+	if (serverThread->renderServer->startQueuedSession()) {
+		LOG( LUX_INFO,LUX_NOERROR) << "Starting queued session ID: " << serverThread->renderServer->getCurrentSID();
+		return;
+	}
 
 	serverThread->renderServer->setServerState(RenderServer::READY);
 	LOG( LUX_INFO,LUX_NOERROR) << "Server ready";
 }
 
+static bool readSessionID(basic_istream<char> &stream, boost::uuids::uuid &sid) {
+	string sidstr;
+	if (!getline(stream, sidstr))
+		return false;
+
+	sid = boost::uuids::string_generator()(sidstr);
+	return true;
+}
+
 void RenderServer::createNewSessionID() {
 	currentSID = boost::uuids::random_generator()();
+	fileCache.BeginSession(boost::lexical_cast<string>(currentSID));
 }
 
 bool RenderServer::validateAccess(basic_istream<char> &stream) const {
-	string sidstr;
-	if (!getline(stream, sidstr))
+	boost::uuids::uuid sid;
+	if (!readSessionID(stream, sid))
 		return false;
 
-	if (serverThread->renderServer->state != RenderServer::BUSY) {
+	return validateAccess(sid);
+}
+
+bool RenderServer::validateAccess(const boost::uuids::uuid &sid) const {
+	if (getServerState() != RenderServer::BUSY) {
 		LOG( LUX_INFO,LUX_NOERROR)<< "Server does not have an active session";
 		return false;
 	}
 
-	boost::uuids::uuid sid = boost::uuids::string_generator()(sidstr);
-
 	LOG( LUX_DEBUG,LUX_NOERROR) << "Validating SID: " << sid << " = " << currentSID;
 
 	return (sid == currentSID);
 }
 
+bool RenderServer::startSession() {
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	if (state != READY)
+		return false;
+	// The master is connected and sends the scene right away
+	awaitingScene = false;
+	state = BUSY;
+	return true;
+}
+
+bool RenderServer::queueSession(boost::uuids::uuid &sid) {
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	if (queuedSIDs.size() >= queueSize)
+		return false;
+
+	sid = boost::uuids::random_generator()();
+	queuedSIDs.push_back(sid);
+	return true;
+}
+
+bool RenderServer::isQueued(const boost::uuids::uuid &sid) const {
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	return std::find(queuedSIDs.begin(), queuedSIDs.end(), sid) != queuedSIDs.end();
+}
+
+bool RenderServer::cancelQueuedSession(const boost::uuids::uuid &sid) {
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	std::deque<boost::uuids::uuid>::iterator it =
+		std::find(queuedSIDs.begin(), queuedSIDs.end(), sid);
+	if (it == queuedSIDs.end())
+		return false;
+
+	queuedSIDs.erase(it);
+	// Its prefetched files may be evicted again
+	fileCache.ReleaseSession(boost::lexical_cast<string>(sid));
+	return true;
+}
+
+bool RenderServer::startQueuedSession() {
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	if (queuedSIDs.empty())
+		return false;
+
+	currentSID = queuedSIDs.front();
+	queuedSIDs.pop_front();
+	// The files it prefetched are now used by the current session
+	fileCache.BeginSession(boost::lexical_cast<string>(currentSID));
+	awaitingScene = true;
+	sessionStartTime = boost::posix_time::second_clock::local_time();
+	state = BUSY;
+	return true;
+}
+
+bool RenderServer::queuedSessionExpired() const {
+	// Masters poll their servers every few minutes, one that did not
+	// come back for its session long after that is gone
+	static const boost::posix_time::minutes timeout(15);
+
+	boost::mutex::scoped_lock lock(queueMutex);
+
+	return state == BUSY && awaitingScene &&
+		boost::posix_time::second_clock::local_time() - sessionStartTime > timeout;
+}
+
+// A queued session whose master never came back must not keep the server
+// busy, checked whenever a master asks for the server
+static void dropExpiredSession(NetworkRenderServerThread *serverThread, vector<string> &tmpFileList) {
+	if (serverThread->renderServer->queuedSessionExpired()) {
+		LOG( LUX_WARNING,LUX_SYSTEM) << "Queued session ID " << serverThread->renderServer->getCurrentSID() << " was not picked up by its master, dropping it";
+		cleanupSession(serverThread, tmpFileList);
+	}
+}
+
 // command handlers
 void cmd_NOOP(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 	// do nothing
 }
 void cmd_ServerDisconnect(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_SERVER_DISCONNECT:
-	if (!serverThread->renderServer->validateAccess(stream))
+	boost::uuids::uuid sid;
+	if (!readSessionID(stream, sid))
+		return;
+
+	if (serverThread->renderServer->cancelQueuedSession(sid)) {
+		LOG( LUX_INFO,LUX_NOERROR) << "Master cancelled queued session ID: " << sid;
+		return;
+	}
+
+	if (!serverThread->renderServer->validateAccess(sid))
 		return;
 
 	LOG( LUX_INFO,LUX_NOERROR) << "Master ended session, cleaning up";
@@ -582,8 +725,10 @@ void cmd_ServerDisconnect(bool isLittleEndian, NetworkRenderServerThread *server
 }
 void cmd_ServerConnect(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_SERVER_CONNECT:
-	if (serverThread->renderServer->getServerState() == RenderServer::READY) {
-		serverThread->renderServer->setServerState(RenderServer::BUSY);
+	dropExpiredSession(serverThread, tmpFileList);
+
+	boost::uuids::uuid queuedSID;
+	if (serverThread->renderServer->startSession()) {
 		stream << "OK" << endl;
 
 		// Send version string
@@ -606,14 +751,79 @@ void cmd_ServerConnect(bool isLittleEndian, NetworkRenderServerThread *serverThr
 			return;
 		}
 
+		stream << "CONNECTED" << endl;
+	} else if (serverThread->renderServer->getServerState() == RenderServer::BUSY &&
+		serverThread->renderServer->queueSession(queuedSID)) {
+		stream << "QUEUED" << endl;
+
+		// Send version string
+		stream << LUX_SERVER_VERSION_STRING << endl;
+
+		LOG( LUX_INFO,LUX_NOERROR) << "Queued session ID: " << queuedSID;
+		stream << queuedSID << endl;
+
+		// now perform handshake
+		boost::uuids::uuid sid;
+		if (!stream.good() || !readSessionID(stream, sid) || sid != queuedSID) {
+			LOG( LUX_WARNING,LUX_SYSTEM)<< "Connection handshake failed, queued session aborted";
+			serverThread->renderServer->cancelQueuedSession(queuedSID);
+			return;
+		}
+
 		stream << "CONNECTED" << endl;
 	} else
 		stream << "BUSY" << endl;
 }
+void cmd_ServerPrefetch(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
+//case CMD_SERVER_PREFETCH:
+	// The master of a queued session uploads its scene files while
+	// the current session renders, they are then found when the scene
+	// is sent
+	boost::uuids::uuid sid;
+	if (!readSessionID(stream, sid) || !serverThread->renderServer->isQueued(sid)) {
+		LOG( LUX_ERROR,LUX_SYSTEM)<< "Unknown queued session ID";
+		stream.close();
+		return;
+	}
+
+	LOG( LUX_INFO,LUX_NOERROR) << "Receiving files for queued session ID: " << sid;
+
+	// A failed upload only concerns the queued session, the current
+	// session must not be cleaned up
+	const string session(boost::lexical_cast<string>(sid));
+	try {
+		ParamSet params;
+		processFiles(serverThread->renderServer->getFileCache(), params,
+			stream, session);
+	} catch (std::exception &e) {
+		LOG( LUX_ERROR,LUX_SYSTEM) << "Error receiving files for queued session ID " << sid << ": " << e.what();
+		// The files it received may be evicted again, its master
+		// sends the missing ones with the scene
+		if (serverThread->renderServer->isQueued(sid))
+			serverThread->renderServer->getFileCache().ReleaseSession(session);
+		stream.close();
+	}
+}
+
+// Prefetches may upload large files, they run on their own thread with
+// their own connection so that the current session keeps being served
+static void prefetchThread(bool isLittleEndian, NetworkRenderServerThread *serverThread,
+	boost::shared_ptr<socket_stream_t> stream)
+{
+	vector<string> tmpFileList;
+	cmd_ServerPrefetch(isLittleEndian, serverThread, *stream, tmpFileList);
+}
 void cmd_ServerReconnect(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_SERVER_RECONNECT:
-	if (serverThread->renderServer->validateAccess(stream)) {
+	dropExpiredSession(serverThread, tmpFileList);
+
+	boost::uuids::uuid sid;
+	const bool gotSID = readSessionID(stream, sid);
+	if (gotSID && serverThread->renderServer->validateAccess(sid)) {
 		stream << "CONNECTED" << endl;
+	} else if (gotSID && serverThread->renderServer->isQueued(sid)) {
+		// still waiting for the current session to end
+		stream << "QUEUED" << endl;
 	} else if (serverThread->renderServer->getServerState() == RenderServer::BUSY) {
 		// server is busy, but validation failed, means the master's SID didn't match ours.
 		stream << "DENIED" << endl;
@@ -723,34 +933,34 @@ void cmd_luxCoordSysTransform(bool isLittleEndian, NetworkRenderServerThread *se
 }
 void cmd_luxPixelFilter(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXPIXELFILTER:
-	processCommand(isLittleEndian, &Context::PixelFilter, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::PixelFilter, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxFilm(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXFILM:
 	// Dade - Servers use a special kind of film to buffer the
 	// samples. I overwrite some option here.
 
-	processCommandFilm(isLittleEndian, &Context::Film, stream);
+	processCommandFilm(isLittleEndian, &Context::Film, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxSampler(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXSAMPLER:
-	processCommand(isLittleEndian, &Context::Sampler, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Sampler, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxAccelerator(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXACCELERATOR:
-	processCommand(isLittleEndian, &Context::Accelerator, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Accelerator, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxSurfaceIntegrator(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXSURFACEINTEGRATOR:
-	processCommand(isLittleEndian, &Context::SurfaceIntegrator, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::SurfaceIntegrator, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxVolumeIntegrator(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXVOLUMEINTEGRATOR:
-	processCommand(isLittleEndian, &Context::VolumeIntegrator, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::VolumeIntegrator, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxCamera(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXCAMERA:
-	processCommand(isLittleEndian, &Context::Camera, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Camera, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxWorldBegin(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXWORLDBEGIN:
@@ -784,17 +994,17 @@ void cmd_luxTexture(bool isLittleEndian, NetworkRenderServerThread *serverThread
 	processCommandParams(isLittleEndian, params, stream);
 
 	//processFile("filename", params, tmpFileList, stream);
-	processFiles(params, stream);
+	processFiles(serverThread->renderServer->getFileCache(), params, stream);
 
 	Context::GetActive()->Texture(name, type, texname, params);
 }
 void cmd_luxMaterial(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXMATERIAL:
-	processCommand(isLittleEndian, &Context::Material, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Material, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxMakeNamedMaterial(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXMAKENAMEDMATERIAL:
-	processCommand(isLittleEndian, &Context::MakeNamedMaterial, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::MakeNamedMaterial, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxNamedMaterial(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXNAMEDMATERIAL:
@@ -802,23 +1012,23 @@ void cmd_luxNamedMaterial(bool isLittleEndian, NetworkRenderServerThread *server
 }
 void cmd_luxLightGroup(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXLIGHTGROUP:
-	processCommand(isLittleEndian, &Context::LightGroup, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::LightGroup, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxLightSource(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXLIGHTSOURCE:
-	processCommand(isLittleEndian, &Context::LightSource, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::LightSource, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxAreaLightSource(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXAREALIGHTSOURCE:
-	processCommand(isLittleEndian, &Context::AreaLightSource, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::AreaLightSource, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxPortalShape(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXPORTALSHAPE:
-	processCommand(isLittleEndian, &Context::PortalShape, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::PortalShape, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxShape(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXSHAPE:
-	processCommand(isLittleEndian, &Context::Shape, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Shape, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxReverseOrientation(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXREVERSEORIENTATION:
@@ -833,13 +1043,13 @@ void cmd_luxMakeNamedVolume(bool isLittleEndian, NetworkRenderServerThread *serv
 
 	processCommandParams(isLittleEndian,
 		params, stream);
-	processFiles(params, stream); // expected due to presence of ParamSet
+	processFiles(serverThread->renderServer->getFileCache(), params, stream); // expected due to presence of ParamSet
 
 	Context::GetActive()->MakeNamedVolume(id, name, params);
 }
 void cmd_luxVolume(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXVOLUME:
-	processCommand(isLittleEndian, &Context::Volume, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Volume, serverThread->renderServer->getFileCache(), stream);
 }
 void cmd_luxExterior(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXEXTERIOR:
@@ -890,6 +1100,7 @@ void cmd_luxMotionInstance(bool isLittleEndian, NetworkRenderServerThread *serve
 }
 void cmd_luxWorldEnd(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXWORLDEND:
+	serverThread->renderServer->sessionSceneReceived();
 	serverThread->engineThread = new boost::thread(&luxWorldEnd);
 
 	// Wait the scene parsing to finish
@@ -975,7 +1186,7 @@ void cmd_luxSetEpsilon(bool isLittleEndian, NetworkRenderServerThread *serverThr
 }
 void cmd_luxRenderer(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
 //case CMD_LUXRENDERER:
-	processCommand(isLittleEndian, &Context::Renderer, tmpFileList, stream);
+	processCommand(isLittleEndian, &Context::Renderer, serverThread->renderServer->getFileCache(), stream);
 }
 
 void cmd_luxSetNoiseAwareMap(bool isLittleEndian, NetworkRenderServerThread *serverThread, socket_stream_t &stream, vector<string> &tmpFileList) {
@@ -1078,6 +1289,7 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 	INSERT_CMD(ServerConnect);
 	INSERT_CMD(ServerReconnect);
 	INSERT_CMD(ServerReset);
+	INSERT_CMD(ServerPrefetch);
 	INSERT_CMD(luxInit);
 	INSERT_CMD(luxTranslate);
 	INSERT_CMD(luxRotate);
@@ -1166,7 +1378,8 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 			stream->timeout(boost::posix_time::seconds(30));
 			stream->get_socket().set_option(boost::asio::ip::tcp::no_delay(true));
 #else
-			tcp::iostream stream;
+			boost::shared_ptr<socket_stream_t> connection(new socket_stream_t());
+			socket_stream_t &stream(*connection);
 			acceptor.accept(*stream.rdbuf());
 			stream.rdbuf()->set_option(boost::asio::ip::tcp::no_delay(true));
 #endif
@@ -1183,6 +1396,15 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 						LOG(LUX_DEBUG,LUX_NOERROR) << "... processing command: '" << command << "'";
 					}
 
+#ifndef USE_SOCKET_DEVICE
+					// The connection is handed over to the prefetch
+					if (command == "ServerPrefetch") {
+						boost::thread(boost::bind(prefetchThread,
+							isLittleEndian, serverThread, connection));
+						break;
+					}
+#endif
+
 					if (cmds.find(command) != cmds.end()) {
 						cmdfunc_t cmdhandler = cmds.find(command)->second;
 						cmdhandler(stream);
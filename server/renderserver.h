@@ -25,8 +25,10 @@
 
 #include "lux.h"
 #include "api.h"
+#include "filecache.h"
 
 #include <fstream>
+#include <deque>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -92,7 +94,7 @@ class LUX_EXPORT RenderServer {
 public:
 	enum ServerState { UNSTARTED, READY, BUSY, STOPPED };
 
-	RenderServer(int threadCount, const std::string &serverPassword, int tcpPort = luxGetIntAttribute("render_farm", "defaultTcpPort"), bool writeFlmFile = false);
+	RenderServer(int threadCount, const std::string &serverPassword, int tcpPort = luxGetIntAttribute("render_farm", "defaultTcpPort"), bool writeFlmFile = false, unsigned int queueSize = 0, unsigned int cacheSize = 0);
 	~RenderServer();
 
 	void start();
@@ -100,10 +102,17 @@ public:
 	void stop();
 
 	int getServerPort() const { return tcpPort; }
-	ServerState getServerState() const { return  state; }
+	ServerState getServerState() const {
+		boost::mutex::scoped_lock lock(queueMutex);
+		return state;
+	}
 	void setServerState(ServerState newState) {
+		boost::mutex::scoped_lock lock(queueMutex);
 		state = newState;
 	}
+	// Makes a ready server busy with a new session, returns false if
+	// it was not ready
+	bool startSession();
 
 	std::string getServerPass() const {
 		return serverPass;
@@ -125,9 +134,35 @@ public:
 		return threadCount;
 	}
 
+	unsigned int getQueueSize() const {
+		return queueSize;
+	}
+
+	FileCache &getFileCache() {
+		return fileCache;
+	}
+
 	void createNewSessionID();
 
 	bool validateAccess(std::basic_istream<char> &stream) const;
+	bool validateAccess(const boost::uuids::uuid &sid) const;
+
+	// Sessions requested while busy wait in a queue and are started in
+	// order when the current session ends, their masters can upload the
+	// scene files in the meantime
+	bool queueSession(boost::uuids::uuid &sid);
+	bool isQueued(const boost::uuids::uuid &sid) const;
+	bool cancelQueuedSession(const boost::uuids::uuid &sid);
+	// Makes the first queued session the current one, returns false
+	// if there is none
+	bool startQueuedSession();
+	// The master of a started queued session has sent its scene
+	void sessionSceneReceived() {
+		boost::mutex::scoped_lock lock(queueMutex);
+		awaitingScene = false;
+	}
+	// True if a started queued session did not get its scene in time
+	bool queuedSessionExpired() const;
 
 	class ErrorMessage {
 	public:
@@ -155,6 +190,17 @@ private:
 	std::string serverPass;
 	boost::uuids::uuid currentSID;
 	NetworkRenderServerThread *serverThread;
+
+	unsigned int queueSize;
+	std::deque<boost::uuids::uuid> queuedSIDs;
+	// Guards the queue and the state of the server, which the queue
+	// changes when a session ends
+	mutable boost::mutex queueMutex;
+	bool awaitingScene;
+	boost::posix_time::ptime sessionStartTime;
+
+	// uploaded files, kept across sessions
+	FileCache fileCache;
 };
 
 }//namespace lux
@@ -748,6 +748,13 @@ void HairFile::Refine(vector<boost::shared_ptr<Shape> > &refined) const {
 							hairTransps, meshVerts, meshNorms, meshTris, meshUVs,
 							meshCols, meshTransps);
 					break;
+				case TESSEL_CURVE:
+					// Curves can not be sampled or used by the hybrid
+					// renderers, ribbons are the closest match
+					TessellateRibbon(hairPoints, hairSizes, hairCols, hairUVs,
+							hairTransps, meshVerts, meshNorms, meshTris, meshUVs,
+							meshCols, meshTransps);
+					break;
 				default:
 					LOG(LUX_ERROR, LUX_RANGE)<< "Unknown tessellation  type in an HairFile Shape";
 			}
@@ -820,6 +827,152 @@ void HairFile::Refine(vector<boost::shared_ptr<Shape> > &refined) const {
 	LOG(LUX_DEBUG, LUX_NOERROR) << "Refining time: " << std::setprecision(3) << dt << " secs";
 }
 
+void HairFile::Refine(vector<boost::shared_ptr<Primitive> > &refined,
+		const PrimitiveRefinementHints &refineHints,
+		const boost::shared_ptr<Primitive> &thisPtr) {
+	if (tesselType != TESSEL_CURVE || refineHints.forSampling) {
+		Shape::Refine(refined, refineHints, thisPtr);
+		return;
+	}
+
+	RefineCurves(refined, thisPtr);
+}
+
+template<class T>
+class HairElemSharedPtr : public T
+{
+public:
+	HairElemSharedPtr(const HairFile* h, u_int n,
+		const boost::shared_ptr<Primitive> &aPtr)
+	: T(h,n), ptr(aPtr) { }
+private:
+	const boost::shared_ptr<Primitive> ptr;
+};
+
+void HairFile::RefineCurves(vector<boost::shared_ptr<Primitive> > &refined,
+		const boost::shared_ptr<Primitive> &thisPtr) {
+	const cyHairFileHeader &header = hairFile->GetHeader();
+	const u_short *segments = hairFile->GetSegmentsArray();
+	if (header.hair_count == 0 || (!segments && (header.d_segments == 0))) {
+		// Particles files are still refined as a set of spheres
+		Shape::Refine(refined, PrimitiveRefinementHints(false), thisPtr);
+		return;
+	}
+
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Refining " << header.hair_count << " strands as curves";
+	const double start = luxrays::WallClockTime();
+
+	const float *points = hairFile->GetPointsArray();
+	const float *thickness = hairFile->GetThicknessArray();
+	const float *colors = hairFile->GetColorsArray();
+	const float *transparency = hairFile->GetTransparencyArray();
+	const float *uvs = hairFile->GetUVsArray();
+
+	// Only the control points are stored, in world space, no vertices
+	// are generated
+	if (curvePoints.size() == 0) {
+		curvePoints.reserve(header.point_count);
+		curveRadii.reserve(header.point_count);
+		curveUVs.reserve(2 * header.point_count);
+		for (u_int i = 0; i < header.point_count; ++i) {
+			const Point p(points[i * 3], points[i * 3 + 1], points[i * 3 + 2]);
+			curvePoints.push_back(ObjectToWorld * p);
+			// Radii are scaled like the ribbon width would be
+			const Vector radius(ObjectToWorld * Vector(((thickness) ? thickness[i] : header.d_thickness) * .5f, 0.f, 0.f));
+			curveRadii.push_back(radius.Length());
+		}
+
+		u_int pointIndex = 0;
+		for (u_int i = 0; i < header.hair_count; ++i) {
+			const int segmentSize = segments ? segments[i] : header.d_segments;
+			for (int j = 0; j <= segmentSize; ++j) {
+				if (uvs) {
+					curveUVs.push_back(uvs[pointIndex * 2]);
+					curveUVs.push_back(uvs[pointIndex * 2 + 1]);
+				} else {
+					curveUVs.push_back(0.f);
+					curveUVs.push_back(segmentSize > 0 ? j / (float)segmentSize : 0.f);
+				}
+				++pointIndex;
+			}
+		}
+
+		// Check if I have to include vertex color too
+		bool useColor = false;
+		if (colors) {
+			for (u_int i = 0; i < 3 * header.point_count; ++i) {
+				if (colors[i] != 1.f) {
+					useColor = true;
+					break;
+				}
+			}
+		} else
+			useColor = (header.d_color[0] != 1.f) || (header.d_color[1] != 1.f) || (header.d_color[2] != 1.f);
+
+		if (useColor) {
+			LOG(LUX_DEBUG, LUX_NOERROR) << "Strands use colors";
+			curveCols.reserve(3 * header.point_count);
+			for (u_int i = 0; i < header.point_count; ++i) {
+				for (u_int c = 0; c < 3; ++c) {
+					const float col = colors ? colors[i * 3 + c] : header.d_color[c];
+					curveCols.push_back(colorGamma == 1.f ? col : powf(col, colorGamma));
+				}
+			}
+		}
+
+		// Check if I have to include vertex alpha too
+		bool useAlpha = false;
+		if (transparency) {
+			for (u_int i = 0; i < header.point_count; ++i) {
+				if (transparency[i] != 0.f) {
+					useAlpha = true;
+					break;
+				}
+			}
+		} else
+			useAlpha = (header.d_transparency != 0.f);
+
+		if (useAlpha) {
+			LOG(LUX_DEBUG, LUX_NOERROR) << "Strands use alphas";
+			curveAlphas.reserve(header.point_count);
+			for (u_int i = 0; i < header.point_count; ++i)
+				curveAlphas.push_back(1.f - (transparency ? transparency[i] : header.d_transparency));
+		}
+	}
+
+	vector<boost::shared_ptr<Primitive> > segmentPrims;
+	u_int pointIndex = 0;
+	for (u_int i = 0; i < header.hair_count; ++i) {
+		const int segmentSize = segments ? segments[i] : header.d_segments;
+		for (int j = 0; j < segmentSize; ++j) {
+			HairStrandSegment *segment;
+			// The first segment keeps the hair data alive
+			if (segmentPrims.size() > 0)
+				segment = new HairStrandSegment(this, pointIndex + j);
+			else
+				segment = new HairElemSharedPtr<HairStrandSegment>(this, pointIndex + j, thisPtr);
+			if (!segment->isDegenerate())
+				segmentPrims.push_back(boost::shared_ptr<Primitive>(segment));
+			else
+				delete segment;
+		}
+		pointIndex += segmentSize + 1;
+	}
+
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Strands curves: " << segmentPrims.size() << " segments";
+
+	if (segmentPrims.size() > 0) {
+		boost::shared_ptr<Aggregate> accel(MakeAccelerator(accelType,
+			segmentPrims, ParamSet()));
+		if (!accel)
+			accel = MakeAccelerator("qbvh", segmentPrims, ParamSet());
+		refined.push_back(accel);
+	}
+
+	const float dt = luxrays::WallClockTime() - start;
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Refining time: " << std::setprecision(3) << dt << " secs";
+}
+
 void HairFile::Tessellate(vector<luxrays::TriangleMesh *> *meshList,
 		vector<const Primitive *> *primitiveList) const {
 	// Refine the primitive
@@ -858,6 +1011,8 @@ Shape *HairFile::CreateShape(const Transform &o2w, bool reverseOrientation, cons
 		tessellationType = TESSEL_SOLID;
 	else if (tessellationTypeStr == "solidadaptive")
 		tessellationType = TESSEL_SOLID_ADAPTIVE;
+	else if (tessellationTypeStr == "curve")
+		tessellationType = TESSEL_CURVE;
 	else {
 		SHAPE_LOG(name, LUX_WARNING, LUX_BADTOKEN) << "Tessellation type  '" << tessellationTypeStr << "' unknown. Using \"ribbon\".";
 		tessellationType = TESSEL_RIBBON;
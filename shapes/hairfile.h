@@ -34,7 +34,7 @@ class HairFile : public Shape {
 public:
 	enum TessellationType {
 		TESSEL_RIBBON, TESSEL_RIBBON_ADAPTIVE,
-		TESSEL_SOLID, TESSEL_SOLID_ADAPTIVE
+		TESSEL_SOLID, TESSEL_SOLID_ADAPTIVE, TESSEL_CURVE
 	};
 
 	HairFile(const Transform &o2w, bool ro, const string &name, const Point *cameraPos,
@@ -48,6 +48,9 @@ public:
 	virtual bool CanIntersect() const { return false; }
 	virtual bool CanSample() const { return false; }
 
+	virtual void Refine(vector<boost::shared_ptr<Primitive> > &refined,
+		const PrimitiveRefinementHints &refineHints,
+		const boost::shared_ptr<Primitive> &thisPtr);
 	virtual void Refine(vector<boost::shared_ptr<Shape> > &refined) const;
 
 	virtual void Tessellate(vector<luxrays::TriangleMesh *> *meshList,
@@ -58,7 +61,11 @@ public:
 	static Shape *CreateShape(const Transform &o2w, bool reverseOrientation,
 		const ParamSet &params);
 
+	friend class HairStrandSegment;
+
 protected:
+	void RefineCurves(vector<boost::shared_ptr<Primitive> > &refined,
+		const boost::shared_ptr<Primitive> &thisPtr);
 	void TessellateRibbon(const vector<Point> &hairPoints,
 		const vector<float> &hairSizes, const vector<RGBColor> &hairCols,
 		const vector<luxrays::UV> &hairUVs, const vector<float> &hairTransps,
@@ -94,6 +101,61 @@ protected:
 
 	// I need to keep alive refined Shapes for Tessellate() and ExtTessellate() methods
 	mutable vector<boost::shared_ptr<Shape> > refinedHairs;
+
+	// Curve data, one entry per control point in world space, only used
+	// with the "curve" tessellation type
+	vector<Point> curvePoints;
+	vector<float> curveRadii;
+	vector<float> curveUVs;
+	vector<float> curveCols;
+	vector<float> curveAlphas;
+};
+
+//------------------------------------------------------------------------------
+// Curve primitive
+//------------------------------------------------------------------------------
+
+// A linear strand segment intersected as a ribbon always facing the ray,
+// with a round shading normal across its width
+class HairStrandSegment : public Primitive {
+public:
+	HairStrandSegment(const HairFile *h, u_int n) : hair(h), index(n) { }
+	virtual ~HairStrandSegment() { }
+
+	virtual BBox WorldBound() const;
+	virtual const Volume *GetExterior() const { return hair->GetExterior(); }
+	virtual const Volume *GetInterior() const { return hair->GetInterior(); }
+
+	virtual bool CanIntersect() const { return true; }
+	virtual bool Intersect(const Ray &ray, Intersection *isect) const;
+	virtual bool IntersectP(const Ray &ray) const;
+
+	virtual void GetShadingGeometry(const Transform &obj2world,
+		const DifferentialGeometry &dg,
+		DifferentialGeometry *dgShading) const;
+	virtual void GetShadingInformation(const DifferentialGeometry &dgShading,
+		RGBColor *color, float *alpha) const;
+
+	virtual bool CanSample() const { return false; }
+	virtual Transform GetLocalToWorld(float time) const {
+		return hair->GetLocalToWorld(time);
+	}
+
+	// Segments without length or width can't be hit
+	bool isDegenerate() const {
+		return DistanceSquared(hair->curvePoints[index],
+			hair->curvePoints[index + 1]) == 0.f ||
+			!(hair->curveRadii[index] > 0.f ||
+			hair->curveRadii[index + 1] > 0.f);
+	}
+
+private:
+	bool IntersectSegment(const Ray &ray, float *tHit, float *u,
+		float *w) const;
+
+	const HairFile *hair;
+	// Index of the first control point of the segment
+	const u_int index;
 };
 
 }//namespace lux
@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+#include "hairfile.h"
+
+using namespace luxrays;
+using namespace lux;
+
+BBox HairStrandSegment::WorldBound() const
+{
+	BBox p0(hair->curvePoints[index]);
+	p0.Expand(hair->curveRadii[index]);
+	BBox p1(hair->curvePoints[index + 1]);
+	p1.Expand(hair->curveRadii[index + 1]);
+	return Union(p0, p1);
+}
+
+bool HairStrandSegment::IntersectSegment(const Ray &ray, float *tHit,
+	float *u, float *w) const
+{
+	const Point &p0 = hair->curvePoints[index];
+	const Point &p1 = hair->curvePoints[index + 1];
+	const Vector e(p1 - p0);
+	const Vector w0(ray.o - p0);
+
+	// Find the closest points between the ray and the segment axis
+	const float a = Dot(ray.d, ray.d);
+	const float b = Dot(ray.d, e);
+	const float c = Dot(e, e);
+	const float d = Dot(ray.d, w0);
+	const float f = Dot(e, w0);
+	const float denom = a * c - b * b;
+	// Rays parallel to the strand can't see a ribbon facing them
+	if (!(denom > 1e-7f * a * c))
+		return false;
+	const float invDenom = 1.f / denom;
+	const float s = (a * f - b * d) * invDenom;
+	if (s < 0.f || s > 1.f)
+		return false;
+	const float t = (b * f - c * d) * invDenom;
+	if (t < ray.mint || t > ray.maxt)
+		return false;
+
+	// Check the distance against the interpolated radius
+	const float radius = hair->curveRadii[index] +
+		s * (hair->curveRadii[index + 1] - hair->curveRadii[index]);
+	// The tip of a tapered strand has no width, the side and the
+	// ribbon width would be undefined there
+	if (!(radius > 0.f))
+		return false;
+	const Vector dist(w0 + t * ray.d - s * e);
+	const float dist2 = dist.LengthSquared();
+	if (dist2 > radius * radius)
+		return false;
+
+	*tHit = t;
+	*u = s;
+	// Signed position across the ribbon in [-1, 1]
+	const float side = sqrtf(dist2) / radius;
+	*w = Dot(dist, Cross(e, ray.d)) < 0.f ? -side : side;
+	return true;
+}
+
+bool HairStrandSegment::Intersect(const Ray &ray, Intersection *isect) const
+{
+	float t, s, w;
+	if (!IntersectSegment(ray, &t, &s, &w))
+		return false;
+
+	const Point &p0 = hair->curvePoints[index];
+	const Point &p1 = hair->curvePoints[index + 1];
+	const Vector e(p1 - p0);
+	const float radius = hair->curveRadii[index] +
+		s * (hair->curveRadii[index + 1] - hair->curveRadii[index]);
+
+	// The ribbon faces the ray, its normal is the ray direction
+	// orthogonalized against the strand direction
+	const Vector dperp(ray.d - (Dot(ray.d, e) / Dot(e, e)) * e);
+	const Normal nn(-Normalize(dperp));
+	const Vector dpdu(e);
+	const Vector dpdv(Normalize(Cross(Vector(nn), e)) * (2.f * radius));
+
+	const float *uvs = &hair->curveUVs[2 * index];
+	const float tu = uvs[0] + s * (uvs[2] - uvs[0]);
+	const float tv = uvs[1] + s * (uvs[3] - uvs[1]);
+
+	isect->dg = DifferentialGeometry(ray(t), nn, dpdu, dpdv,
+		Normal(0, 0, 0), Normal(0, 0, 0), tu, tv, this);
+	isect->Set(hair->ObjectToWorld, this, hair->GetMaterial(),
+		hair->GetExterior(), hair->GetInterior());
+	isect->dg.iData.curve.u = s;
+	isect->dg.iData.curve.w = w;
+	ray.maxt = t;
+
+	return true;
+}
+
+bool HairStrandSegment::IntersectP(const Ray &ray) const
+{
+	float t, s, w;
+	return IntersectSegment(ray, &t, &s, &w);
+}
+
+void HairStrandSegment::GetShadingGeometry(const Transform &obj2world,
+	const DifferentialGeometry &dg, DifferentialGeometry *dgShading) const
+{
+	// Bend the normal across the ribbon width to mimic a round strand
+	const float w = dg.iData.curve.w;
+	const Vector across(Normalize(dg.dpdv));
+	const Normal ns(Normalize(sqrtf(max(0.f, 1.f - w * w)) * dg.nn +
+		Normal(w * across)));
+
+	Vector ts(Normalize(Cross(ns, dg.dpdu)));
+	Vector ss(Cross(ts, ns));
+	ts *= Dot(dg.dpdv, ts) > 0.f ? 1.f : -1.f;
+
+	// the length of dpdu/dpdv can be important for bumpmapping
+	ss *= dg.dpdu.Length();
+	ts *= dg.dpdv.Length();
+
+	*dgShading = DifferentialGeometry(dg.p, ns, ss, ts,
+		Normal(0, 0, 0), Normal(0, 0, 0), dg.u, dg.v, this);
+	dgShading->iData = dg.iData;
+}
+
+void HairStrandSegment::GetShadingInformation(const DifferentialGeometry &dgShading,
+	RGBColor *color, float *alpha) const
+{
+	const float s = dgShading.iData.curve.u;
+
+	if (hair->curveCols.size() > 0) {
+		const RGBColor *c0 = (const RGBColor *)(&hair->curveCols[index * 3]);
+		const RGBColor *c1 = (const RGBColor *)(&hair->curveCols[(index + 1) * 3]);
+
+		*color = (1.f - s) * (*c0) + s * (*c1);
+	} else
+		*color = RGBColor(1.f);
+
+	if (hair->curveAlphas.size() > 0)
+		*alpha = (1.f - s) * hair->curveAlphas[index] +
+			s * hair->curveAlphas[index + 1];
+	else
+		*alpha = 1.f;
+}
@@ -25,21 +25,71 @@
 #include "paramset.h"
 #include "dynload.h"
 
+using namespace luxrays;
 using namespace lux;
 
 // Heightfield Method Definitions
 Heightfield::Heightfield(const Transform &o2w, bool ro, const string &name, 
-		u_int x, u_int y, const float *zs)
+		u_int x, u_int y, const float *zs, bool a)
 	: Shape(o2w, ro, name) {
 	nx = x;
 	ny = y;
 	z = new float[nx*ny];
 	memcpy(z, zs, nx*ny*sizeof(float));
+	// A grid without cells has nothing to intersect
+	analytic = a && nx > 1 && ny > 1;
+	if (analytic)
+		BuildPyramid();
 }
 Heightfield::~Heightfield() {
 	delete[] z;
 }
+void Heightfield::BuildPyramid() {
+	// Level 0: bounds of each cell
+	levelWidth.push_back(nx - 1);
+	levelHeight.push_back(ny - 1);
+	levelMin.push_back(vector<float>((nx - 1) * (ny - 1)));
+	levelMax.push_back(vector<float>((nx - 1) * (ny - 1)));
+	for (u_int y = 0; y < ny - 1; ++y) {
+		for (u_int x = 0; x < nx - 1; ++x) {
+			const float z00 = z[x + y * nx];
+			const float z10 = z[x + 1 + y * nx];
+			const float z01 = z[x + (y + 1) * nx];
+			const float z11 = z[x + 1 + (y + 1) * nx];
+			levelMin[0][x + y * (nx - 1)] = min(min(z00, z10), min(z01, z11));
+			levelMax[0][x + y * (nx - 1)] = max(max(z00, z10), max(z01, z11));
+		}
+	}
+
+	// Following levels: bounds of up to 2x2 nodes of the previous level
+	while (levelWidth.back() > 1 || levelHeight.back() > 1) {
+		const u_int l = levelWidth.size() - 1;
+		const u_int pw = levelWidth[l], ph = levelHeight[l];
+		const u_int w = (pw + 1) / 2, h = (ph + 1) / 2;
+		vector<float> mins(w * h), maxs(w * h);
+		for (u_int y = 0; y < h; ++y) {
+			for (u_int x = 0; x < w; ++x) {
+				float minz = INFINITY, maxz = -INFINITY;
+				for (u_int cy = 2 * y; cy < min(2 * y + 2, ph); ++cy) {
+					for (u_int cx = 2 * x; cx < min(2 * x + 2, pw); ++cx) {
+						minz = min(minz, levelMin[l][cx + cy * pw]);
+						maxz = max(maxz, levelMax[l][cx + cy * pw]);
+					}
+				}
+				mins[x + y * w] = minz;
+				maxs[x + y * w] = maxz;
+			}
+		}
+		levelWidth.push_back(w);
+		levelHeight.push_back(h);
+		levelMin.push_back(mins);
+		levelMax.push_back(maxs);
+	}
+}
 BBox Heightfield::ObjectBound() const {
+	if (analytic)
+		return BBox(Point(0, 0, levelMin.back()[0]),
+			Point(1, 1, levelMax.back()[0]));
 	float minz = z[0], maxz = z[0];
 	for (u_int i = 1; i < nx*ny; ++i) {
 		if (z[i] < minz) minz = z[i];
@@ -48,7 +98,195 @@ BBox Heightfield::ObjectBound() const {
 	return BBox(Point(0,0,minz), Point(1,1,maxz));
 }
 bool Heightfield::CanIntersect() const {
-	return false;
+	return analytic;
+}
+
+// Slab test of the ray against an axis aligned box, invDir is the
+// inverse of the ray direction
+static inline bool IntersectNode(const Ray &ray, const Vector &invDir,
+	const Point &pMin, const Point &pMax, float maxt, float *tEntry)
+{
+	float t0 = ray.mint, t1 = maxt;
+	for (u_int i = 0; i < 3; ++i) {
+		float tNear = (pMin[i] - ray.o[i]) * invDir[i];
+		float tFar = (pMax[i] - ray.o[i]) * invDir[i];
+		if (tNear > tFar)
+			swap(tNear, tFar);
+		t0 = tNear > t0 ? tNear : t0;
+		t1 = tFar < t1 ? tFar : t1;
+		if (t0 > t1)
+			return false;
+	}
+	*tEntry = t0;
+	return true;
+}
+
+static inline bool IntersectTriangle(const Ray &ray, const Point &p1,
+	const Point &p2, const Point &p3, float maxt, float *tHit)
+{
+	const Vector e1(p2 - p1);
+	const Vector e2(p3 - p1);
+	const Vector s1(Cross(ray.d, e2));
+	const float divisor = Dot(s1, e1);
+	if (divisor == 0.f)
+		return false;
+	const float invDivisor = 1.f / divisor;
+	// Compute first barycentric coordinate
+	const Vector d(ray.o - p1);
+	const float b1 = Dot(d, s1) * invDivisor;
+	if (b1 < 0.f)
+		return false;
+	// Compute second barycentric coordinate
+	const Vector s2(Cross(d, e1));
+	const float b2 = Dot(ray.d, s2) * invDivisor;
+	if (b2 < 0.f || b1 + b2 > 1.f)
+		return false;
+	// Compute _t_ to intersection point
+	const float t = Dot(e2, s2) * invDivisor;
+	if (t < ray.mint || t > maxt)
+		return false;
+	*tHit = t;
+	return true;
+}
+
+void Heightfield::GetCellTriangle(u_int x, u_int y, bool upper,
+	Point *p0, Point *p1, Point *p2) const {
+	// Same triangulation as the refined mesh
+	const float dx = 1.f / (nx - 1), dy = 1.f / (ny - 1);
+	*p0 = Point(x * dx, y * dy, z[x + y * nx]);
+	if (!upper) {
+		*p1 = Point((x + 1) * dx, y * dy, z[x + 1 + y * nx]);
+		*p2 = Point((x + 1) * dx, (y + 1) * dy, z[x + 1 + (y + 1) * nx]);
+	} else {
+		*p1 = Point((x + 1) * dx, (y + 1) * dy, z[x + 1 + (y + 1) * nx]);
+		*p2 = Point(x * dx, (y + 1) * dy, z[x + (y + 1) * nx]);
+	}
+}
+
+bool Heightfield::IntersectGrid(const Ray &ray, float *tHit, u_int *cellX,
+	u_int *cellY, bool *upper) const {
+	const Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+	const float dx = 1.f / (nx - 1), dy = 1.f / (ny - 1);
+
+	// Nodes are visited front to back, the search stops as soon as the
+	// closest pending node starts behind the closest hit
+	struct Node {
+		u_int level, x, y;
+		float tEntry;
+	};
+	Node stack[4 * 33];
+	u_int stackSize = 0;
+	float tBest = ray.maxt;
+	bool hit = false;
+
+	const u_int top = levelWidth.size() - 1;
+	float tEntry;
+	if (!IntersectNode(ray, invDir, Point(0.f, 0.f, levelMin[top][0]),
+		Point(1.f, 1.f, levelMax[top][0]), tBest, &tEntry))
+		return false;
+	stack[stackSize].level = top;
+	stack[stackSize].x = 0;
+	stack[stackSize].y = 0;
+	stack[stackSize++].tEntry = tEntry;
+
+	while (stackSize > 0) {
+		const Node node(stack[--stackSize]);
+		if (node.tEntry > tBest)
+			continue;
+
+		if (node.level == 0) {
+			// Leaf: only now build the two triangles of the cell
+			for (u_int t = 0; t < 2; ++t) {
+				Point p0, p1, p2;
+				GetCellTriangle(node.x, node.y, t == 1, &p0, &p1, &p2);
+				float tTri;
+				if (IntersectTriangle(ray, p0, p1, p2, tBest, &tTri)) {
+					tBest = tTri;
+					*cellX = node.x;
+					*cellY = node.y;
+					*upper = (t == 1);
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		// Collect the children hit by the ray
+		const u_int l = node.level - 1;
+		const u_int cellSize = 1 << l;
+		Node children[4];
+		u_int childCount = 0;
+		for (u_int cy = 2 * node.y; cy < min(2 * node.y + 2, levelHeight[l]); ++cy) {
+			for (u_int cx = 2 * node.x; cx < min(2 * node.x + 2, levelWidth[l]); ++cx) {
+				const u_int idx = cx + cy * levelWidth[l];
+				const Point pMin(cx * cellSize * dx, cy * cellSize * dy,
+					levelMin[l][idx]);
+				const Point pMax(min((cx + 1) * cellSize, nx - 1) * dx,
+					min((cy + 1) * cellSize, ny - 1) * dy,
+					levelMax[l][idx]);
+				if (IntersectNode(ray, invDir, pMin, pMax, tBest, &tEntry)) {
+					children[childCount].level = l;
+					children[childCount].x = cx;
+					children[childCount].y = cy;
+					children[childCount++].tEntry = tEntry;
+				}
+			}
+		}
+
+		// Push the farthest children first so the nearest is popped first
+		for (u_int i = 1; i < childCount; ++i)
+			for (u_int j = i; j > 0 && children[j - 1].tEntry < children[j].tEntry; --j)
+				swap(children[j - 1], children[j]);
+		for (u_int i = 0; i < childCount; ++i)
+			stack[stackSize++] = children[i];
+	}
+
+	if (hit)
+		*tHit = tBest;
+	return hit;
+}
+
+bool Heightfield::Intersect(const Ray &r, Intersection *isect) const {
+	// Transform _Ray_ to object space
+	const Ray ray(Inverse(ObjectToWorld) * r);
+	float tHit;
+	u_int x, y;
+	bool upper;
+	if (!IntersectGrid(ray, &tHit, &x, &y, &upper))
+		return false;
+	r.maxt = tHit;
+
+	Point p0, p1, p2;
+	GetCellTriangle(x, y, upper, &p0, &p1, &p2);
+	const Vector e1(p1 - p0);
+	const Vector e2(p2 - p0);
+	const Point pHit(ray(tHit));
+
+	// The parametric coordinates are the grid x and y coordinates
+	const float determinant = e1.x * e2.y - e1.y * e2.x;
+	const float invdet = 1.f / determinant;
+	const Vector dpdu((e2.y * e1 - e1.y * e2) * invdet);
+	const Vector dpdv((e1.x * e2 - e2.x * e1) * invdet);
+
+	isect->dg = DifferentialGeometry(ObjectToWorld * pHit,
+		Normalize(ObjectToWorld * Normal(Cross(e1, e2))),
+		ObjectToWorld * dpdu, ObjectToWorld * dpdv,
+		Normal(0, 0, 0), Normal(0, 0, 0), pHit.x, pHit.y, this);
+	// Same orientation as the refined triangle mesh
+	if (reverseOrientation)
+		isect->dg.nn = -isect->dg.nn;
+	isect->Set(ObjectToWorld, this, GetMaterial(),
+		GetExterior(), GetInterior());
+	return true;
+}
+
+bool Heightfield::IntersectP(const Ray &r) const {
+	// Transform _Ray_ to object space
+	const Ray ray(Inverse(ObjectToWorld) * r);
+	float tHit;
+	u_int x, y;
+	bool upper;
+	return IntersectGrid(ray, &tHit, &x, &y, &upper);
 }
 void Heightfield::Refine(vector<boost::shared_ptr<Shape> > &refined) const {
 	const u_int nVerts = nx * ny;
@@ -92,6 +330,15 @@ void Heightfield::Refine(vector<boost::shared_ptr<Shape> > &refined) const {
 	delete[] uvs;
 	delete[] verts;
 }
+void Heightfield::Refine(vector<boost::shared_ptr<Primitive> > &refined,
+	const PrimitiveRefinementHints &refineHints,
+	const boost::shared_ptr<Primitive> &thisPtr)
+{
+	if (analytic && !refineHints.forSampling)
+		refined.push_back(thisPtr);
+	else
+		Shape::Refine(refined, refineHints, thisPtr);
+}
 Shape* Heightfield::CreateShape(const Transform &o2w,
 		bool reverseOrientation, const ParamSet &params) {
 	string name = params.FindOneString("name", "'heightfield'");
@@ -103,7 +350,10 @@ Shape* Heightfield::CreateShape(const Transform &o2w,
 		return NULL;
 	BOOST_ASSERT(nItems == static_cast<u_int>(nu*nv));
 	BOOST_ASSERT(nu != -1 && nv != -1 && Pz != NULL);
-	return new Heightfield(o2w, reverseOrientation, name, nu, nv, Pz);
+	// Intersect the grid directly instead of refining it into a mesh
+	const bool analytic = params.FindOneBool("analytic", true);
+	return new Heightfield(o2w, reverseOrientation, name, nu, nv, Pz,
+		analytic);
 }
 
 static DynamicLoader::RegisterShape<Heightfield> r("heightfield");
@@ -33,17 +33,39 @@ class Heightfield : public Shape {
 public:
 	// Heightfield Public Methods
 	Heightfield(const Transform &o2w, bool ro, const string &name, 
-		u_int nu, u_int nv, const float *zs);
+		u_int nu, u_int nv, const float *zs, bool analytic);
 	virtual ~Heightfield();
 	virtual bool CanIntersect() const;
 	virtual void Refine(vector<boost::shared_ptr<Shape> > &refined) const;
+	// Refined to the triangle mesh for sampling even when analytic
+	virtual void Refine(vector<boost::shared_ptr<Primitive> > &refined,
+		const PrimitiveRefinementHints &refineHints,
+		const boost::shared_ptr<Primitive> &thisPtr);
 	virtual BBox ObjectBound() const;
+
+	virtual bool Intersect(const Ray &ray, Intersection *isect) const;
+	virtual bool IntersectP(const Ray &ray) const;
+	// Sampling goes through the refined triangle mesh
+	virtual bool CanSample() const { return false; }
 	
 	static Shape* CreateShape(const Transform &o2w, bool reverseOrientation, const ParamSet &params);
 private:
+	void BuildPyramid();
+	bool IntersectGrid(const Ray &ray, float *tHit, u_int *cellX,
+		u_int *cellY, bool *upper) const;
+	void GetCellTriangle(u_int x, u_int y, bool upper, Point *p0,
+		Point *p1, Point *p2) const;
+
 	// Heightfield Data
 	float *z;
 	u_int nx, ny;
+
+	// Analytic intersection data: a min/max pyramid over the grid cells,
+	// level 0 has one entry per cell and each following level halves
+	// the resolution until a single node covers the whole grid
+	bool analytic;
+	vector<u_int> levelWidth, levelHeight;
+	vector<vector<float> > levelMin, levelMax;
 };
 
 }//namespace lux
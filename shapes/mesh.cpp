@@ -230,6 +230,9 @@ Mesh::Mesh(const Transform &o2w, bool ro, const string &name,
 
 Mesh::~Mesh()
 {
+	if (triType == TRI_MICRODISPLACEMENT)
+		MeshMicroDisplacementTriangle::InvalidateCache();
+
 	delete[] triVertexIndex;
 	delete[] quadVertexIndex;
 	delete[] p;
@@ -418,6 +421,8 @@ void Mesh::Refine(vector<boost::shared_ptr<Primitive> > &refined,
 			}
 			break;
 		case TRI_MICRODISPLACEMENT:
+			if (!microGridStatistics)
+				microGridStatistics = MeshMicroDisplacementTriangle::GetCacheStatistics();
 			for (u_int i = 0; i < ntris; ++i) {
 				MeshMicroDisplacementTriangle *currTri;
 				if (refinedPrims.size() > 0)
@@ -1083,7 +1088,8 @@ static Shape *CreateShape(const Transform &o2w, bool reverseOrientation, const P
 
 		if (!displacementMap) {
 			SHAPE_LOG(name, LUX_WARNING,LUX_SYNTAX) << "Unknown float texture '" << displacementMapName << "'.";
-		}
+		} else
+			displacementMap->Resolve();
 	} else
 		displacementMap = params.GetFloatTexture("displacementmap");
 
@@ -28,6 +28,8 @@
 namespace lux
 {
 
+class Queryable;
+
 class Mesh : public Shape {
 public:
 	enum MeshTriangleType { TRI_WALD, TRI_BARY, TRI_MICRODISPLACEMENT, TRI_AUTO };
@@ -126,6 +128,10 @@ protected:
 
 	// for error reporting
 	mutable u_int inconsistentShadingTris;
+
+	// Statistics of the micro-grid caches, kept while the mesh
+	// has microdisplacement triangles
+	boost::shared_ptr<Queryable> microGridStatistics;
 };
 
 //------------------------------------------------------------------------------
@@ -277,6 +283,13 @@ public:
 	Point GetDisplacedP(const Point &pbase, const Vector &n, const float u, const float v, const float w) const;
 	Vector GetN(u_int i) const;
 
+	// Invalidates the displaced micro-grids cached by all threads, has to
+	// be called when microdisplacement triangles are destroyed
+	static void InvalidateCache();
+	// Returns the "microdisplacement_cache" object summing the statistics
+	// of the caches of all threads, it is registered while referenced
+	static boost::shared_ptr<Queryable> GetCacheStatistics();
+
 	// BaryTriangle Data
 	const Mesh *mesh;
 	const int *v;
@@ -27,12 +27,210 @@
 
 #include "mesh.h"
 #include "texture.h"
+#include "osfunc.h"
+#include "queryable.h"
 #include "luxrays/core/color/spectrumwavelengths.h"
 #include <algorithm>
+#include <list>
+#include <map>
+#include <set>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/weak_ptr.hpp>
 
 using namespace luxrays;
 using namespace lux;
 
+// Micro-grid vertices cache
+//
+// Evaluating the displacement map is by far the most expensive part of the
+// intersection, and close-up shots hit the same triangles over and over.
+// Each thread keeps the displaced vertices of the micro-grids it has
+// traversed, keyed by triangle, and evicts the least recently used grids
+// once the vertex budget is exceeded. The cache is per thread so lookups
+// don't need any locking, its counters are only written by its thread and
+// summed over all the caches when the statistics are queried.
+
+// Maximum number of displaced vertices cached by each thread
+static const size_t microGridCacheSize = 1 << 20;
+
+// Incremented each time microdisplacement triangles are destroyed, so that
+// stale grids are never looked up by a new triangle at the same address
+static u_int microGridCacheEpoch = 0;
+
+// Statistics, in vertex lookups and evicted grids
+struct MicroGridCounters {
+	MicroGridCounters() : hits(0.), misses(0.), evictions(0.) { }
+	double hits, misses, evictions;
+};
+
+class MicroGridCache;
+
+// Caches of the running threads and the counters of the exited ones
+static boost::mutex microGridCachesMutex;
+static std::set<const MicroGridCache *> microGridCaches;
+static MicroGridCounters microGridRetiredCounters;
+
+class MicroGridCache {
+public:
+	class Grid {
+	public:
+		Grid(const MeshMicroDisplacementTriangle *t, u_int n) :
+			triangle(t), N(n), p((n + 1) * (n + 2) / 2),
+			valid(p.size(), false) { }
+
+		const MeshMicroDisplacementTriangle *triangle;
+		u_int N;
+		vector<Point> p;
+		vector<bool> valid;
+	};
+
+	MicroGridCache() : size(0) {
+		epoch = osAtomicRead(&microGridCacheEpoch);
+		boost::mutex::scoped_lock lock(microGridCachesMutex);
+		microGridCaches.insert(this);
+	}
+	~MicroGridCache() {
+		boost::mutex::scoped_lock lock(microGridCachesMutex);
+		microGridRetiredCounters.hits += counters.hits;
+		microGridRetiredCounters.misses += counters.misses;
+		microGridRetiredCounters.evictions += counters.evictions;
+		microGridCaches.erase(this);
+	}
+
+	Grid &Lookup(const MeshMicroDisplacementTriangle *triangle, u_int N) {
+		// Drop everything if some triangles have been destroyed
+		const u_int currentEpoch = osAtomicRead(&microGridCacheEpoch);
+		if (epoch != currentEpoch) {
+			grids.clear();
+			index.clear();
+			size = 0;
+			epoch = currentEpoch;
+		}
+
+		IndexType::iterator it = index.find(triangle);
+		if (it != index.end()) {
+			// Move to the front of the LRU list
+			grids.splice(grids.begin(), grids, it->second);
+			return grids.front();
+		}
+
+		grids.push_front(Grid(triangle, N));
+		index[triangle] = grids.begin();
+		size += grids.front().p.size();
+
+		// Evict the least recently used grids, never the one just added
+		while (size > microGridCacheSize && grids.size() > 1) {
+			size -= grids.back().p.size();
+			index.erase(grids.back().triangle);
+			grids.pop_back();
+			counters.evictions += 1.;
+		}
+
+		return grids.front();
+	}
+
+	MicroGridCounters counters;
+
+private:
+	typedef std::list<Grid> GridList;
+	typedef std::map<const MeshMicroDisplacementTriangle *, GridList::iterator> IndexType;
+
+	GridList grids;
+	IndexType index;
+	size_t size;
+	u_int epoch;
+};
+
+static boost::thread_specific_ptr<MicroGridCache> microGridCache;
+
+void MeshMicroDisplacementTriangle::InvalidateCache()
+{
+	osAtomicInc(&microGridCacheEpoch);
+}
+
+class MicroGridCacheStatistics : public Queryable {
+public:
+	MicroGridCacheStatistics() : Queryable("microdisplacement_cache") {
+		AddDoubleAttribute(*this, "hits", "Number of displaced vertices found in the micro-grid caches", &MicroGridCacheStatistics::GetHits);
+		AddDoubleAttribute(*this, "misses", "Number of displaced vertices computed", &MicroGridCacheStatistics::GetMisses);
+		AddDoubleAttribute(*this, "evictions", "Number of micro-grids evicted to stay in the budget", &MicroGridCacheStatistics::GetEvictions);
+		AddDoubleAttribute(*this, "hitRate", "Percentage of the displaced vertex lookups found in the caches", &MicroGridCacheStatistics::GetHitRate);
+	}
+
+private:
+	static MicroGridCounters Sum() {
+		boost::mutex::scoped_lock lock(microGridCachesMutex);
+		MicroGridCounters total(microGridRetiredCounters);
+		for (std::set<const MicroGridCache *>::const_iterator it =
+			microGridCaches.begin(); it != microGridCaches.end(); ++it) {
+			total.hits += (*it)->counters.hits;
+			total.misses += (*it)->counters.misses;
+			total.evictions += (*it)->counters.evictions;
+		}
+		return total;
+	}
+	double GetHits() { return Sum().hits; }
+	double GetMisses() { return Sum().misses; }
+	double GetEvictions() { return Sum().evictions; }
+	double GetHitRate() {
+		const MicroGridCounters total(Sum());
+		const double lookups = total.hits + total.misses;
+		return lookups > 0. ? 100. * total.hits / lookups : 0.;
+	}
+};
+
+// Shared by all the meshes with microdisplacement triangles
+static boost::mutex microGridStatisticsMutex;
+static boost::weak_ptr<Queryable> microGridStatistics;
+
+boost::shared_ptr<Queryable> MeshMicroDisplacementTriangle::GetCacheStatistics()
+{
+	boost::mutex::scoped_lock lock(microGridStatisticsMutex);
+	boost::shared_ptr<Queryable> statistics(microGridStatistics.lock());
+	if (!statistics) {
+		statistics.reset(new MicroGridCacheStatistics());
+		microGridStatistics = statistics;
+	}
+	return statistics;
+}
+
+static MicroGridCache::Grid &GetMicroGrid(const MeshMicroDisplacementTriangle *triangle,
+	u_int N)
+{
+	MicroGridCache *cache = microGridCache.get();
+	if (!cache) {
+		cache = new MicroGridCache();
+		microGridCache.reset(cache);
+	}
+	return cache->Lookup(triangle, N);
+}
+
+// Returns the displaced vertex of the micro-grid at barycentric
+// coordinates (u, v, w), which are multiples of 1/N
+static Point GetCachedDisplacedP(const MeshMicroDisplacementTriangle *triangle,
+	MicroGridCache::Grid &grid, const Point &pbase, const Vector &n,
+	const float u, const float v, const float w)
+{
+	const int N = static_cast<int>(grid.N);
+	const int j = Clamp(Round2Int(v * N), 0, N);
+	const int k = Clamp(Round2Int(w * N), 0, N - j);
+	// Row k of the triangular grid holds N + 1 - k vertices
+	const u_int idx = k * (N + 1) - (k * (k - 1)) / 2 + j;
+
+	MicroGridCache *cache = microGridCache.get();
+	if (grid.valid[idx]) {
+		cache->counters.hits += 1.;
+		return grid.p[idx];
+	}
+	cache->counters.misses += 1.;
+
+	grid.p[idx] = triangle->GetDisplacedP(pbase, n, u, v, w);
+	grid.valid[idx] = true;
+	return grid.p[idx];
+}
+
 // Bilinear patch class
 // created by Shaun David Ramsey and Kristin Potter copyright (c) 2003
 // email ramsey()cs.utah.edu with any quesitons
@@ -421,6 +619,9 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 	if (i < 0 || j < 0 || k < 0)
 		return false;	
 
+	// Only rays entering the displaced volume use the micro-grid
+	MicroGridCache::Grid &grid(GetMicroGrid(this, N));
+
 
 	// initialize microtriangle vertices a,b,c
 	// order doesnt matter since we wont traverse
@@ -467,9 +668,9 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 		const Point pb = p1 * ub + p2 * vb + p3 * wb;
 		const Point pc = p1 * uc + p2 * vc + p3 * wc;
 
-		a = GetDisplacedP(pa, na, ua, va, wa);
-		b = GetDisplacedP(pb, nb, ub, vb, wb);
-		c = GetDisplacedP(pc, nc, uc, vc, wc);
+		a = GetCachedDisplacedP(this, grid, pa, na, ua, va, wa);
+		b = GetCachedDisplacedP(this, grid, pb, nb, ub, vb, wb);
+		c = GetCachedDisplacedP(this, grid, pc, nc, uc, vc, wc);
 
 		if (enterSide < 0) {
 			// ray enters through one of the caps, and possibly exits through one side
@@ -690,7 +891,7 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 		// interpolated normal
 		nc = Normalize(n1 * uc + n2 * vc + n3 * wc);
 
-		c = GetDisplacedP(pc, nc, uc, vc, wc);
+		c = GetCachedDisplacedP(this, grid, pc, nc, uc, vc, wc);
 	}
 
 	// something went wrong
@@ -444,7 +444,8 @@ Shape* PlyMesh::CreateShape(const Transform &o2w,
 
 		if (!displacementMap) {
 			SHAPE_LOG(name, LUX_WARNING,LUX_SYNTAX) << "Unknown float texture '" << displacementMapName << "'.";
-		}
+		} else
+			displacementMap->Resolve();
 	} else
 		displacementMap = params.GetFloatTexture("displacementmap");
 
@@ -0,0 +1,210 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+// bake.cpp*
+#include "bake.h"
+#include "primitive.h"
+#include "osfunc.h"
+#include "dynload.h"
+
+#include <boost/bind.hpp>
+
+using namespace luxrays;
+using namespace lux;
+
+// Baked textures are evaluated with object space equal to world space
+class BakePrimitive : public Primitive {
+public:
+	virtual ~BakePrimitive() { }
+	virtual BBox WorldBound() const { return BBox(); }
+	virtual bool CanIntersect() const { return false; }
+	virtual bool CanSample() const { return false; }
+	virtual Transform GetLocalToWorld(float time) const {
+		return Transform();
+	}
+};
+static BakePrimitive bakePrimitive;
+
+// BakedTexture Method Definitions
+BakedTexture::BakedTexture(const boost::shared_ptr<Texture<float> > &t,
+	TextureMapping2D *m, u_int res, u_int spp,
+	ImageTextureFilterType filterType, float maxAniso) :
+	Texture("BakedTexture-" + boost::lexical_cast<string>(this)),
+	tex(t), resolution(res), samples(spp), values(res * res),
+	mapping(m)
+{
+	osParallelFor(resolution, boost::bind(&BakedTexture::BakeRow,
+		this, _1));
+	SetStatistics();
+
+	vector<TextureColor<float, 1> > texels(values.begin(), values.end());
+	mipmap.reset(new MIPMapFastImpl<TextureColor<float, 1> >(filterType,
+		resolution, resolution, &texels[0], maxAniso, TEXTURE_REPEAT));
+	values.clear();
+}
+
+BakedTexture::BakedTexture(const boost::shared_ptr<Texture<float> > &t,
+	TextureMapping3D *m, u_int res, u_int spp,
+	DensityGridTexture::WrapMode wrapMode) :
+	Texture("BakedTexture-" + boost::lexical_cast<string>(this)),
+	tex(t), resolution(res), samples(spp),
+	values(res * res * res), mapping(NULL)
+{
+	const Transform textureToWorld(Inverse(m->WorldToTexture));
+	osParallelFor(resolution, boost::bind(&BakedTexture::BakeSlice,
+		this, boost::cref(textureToWorld), _1));
+	SetStatistics();
+
+	grid.reset(new DensityGridTexture(resolution, resolution, resolution,
+		&values[0], wrapMode, m));
+	values.clear();
+}
+
+float BakedTexture::Sample(const Point &p, float u, float v) const
+{
+	const SpectrumWavelengths sw;
+	DifferentialGeometry dg(p, Normal(0.f, 0.f, 1.f),
+		Vector(1.f, 0.f, 0.f), Vector(0.f, 1.f, 0.f),
+		Normal(0.f, 0.f, 0.f), Normal(0.f, 0.f, 0.f), u, v,
+		&bakePrimitive);
+	dg.time = 0.f;
+	return tex->Evaluate(sw, dg);
+}
+
+void BakedTexture::BakeRow(u_int t)
+{
+	// Texels are the average of samples x samples stratified samples
+	const float invRes = 1.f / resolution, invSamples = 1.f / samples;
+	for (u_int s = 0; s < resolution; ++s) {
+		float sum = 0.f;
+		for (u_int j = 0; j < samples; ++j) {
+			const float v = (t + (j + .5f) * invSamples) * invRes;
+			for (u_int i = 0; i < samples; ++i) {
+				const float u = (s + (i + .5f) * invSamples) *
+					invRes;
+				sum += Sample(Point(u, v, 0.f), u, v);
+			}
+		}
+		values[t * resolution + s] = sum * invSamples * invSamples;
+	}
+}
+
+void BakedTexture::BakeSlice(const Transform &textureToWorld, u_int z)
+{
+	// Grid values are at the voxel corners, averaged over samples^3
+	// stratified samples around them
+	const float invRes = 1.f / resolution, invSamples = 1.f / samples;
+	for (u_int y = 0; y < resolution; ++y) {
+		for (u_int x = 0; x < resolution; ++x) {
+			float sum = 0.f;
+			for (u_int k = 0; k < samples; ++k) {
+				const float pz = (z + (k + .5f) * invSamples - .5f) *
+					invRes;
+				for (u_int j = 0; j < samples; ++j) {
+					const float py = (y + (j + .5f) *
+						invSamples - .5f) * invRes;
+					for (u_int i = 0; i < samples; ++i) {
+						const float px = (x + (i + .5f) *
+							invSamples - .5f) * invRes;
+						sum += Sample(textureToWorld *
+							Point(px, py, pz), px, py);
+					}
+				}
+			}
+			values[(z * resolution + y) * resolution + x] = sum *
+				invSamples * invSamples * invSamples;
+		}
+	}
+}
+
+void BakedTexture::SetStatistics()
+{
+	minV = INFINITY;
+	maxV = -INFINITY;
+	float sum = 0.f;
+	for (size_t i = 0; i < values.size(); ++i) {
+		minV = min(minV, values[i]);
+		maxV = max(maxV, values[i]);
+		sum += values[i];
+	}
+	mean = sum / values.size();
+}
+
+Texture<float> * BakedTexture::CreateFloatTexture(const Transform &tex2world,
+	const ParamSet &tp)
+{
+	boost::shared_ptr<Texture<float> > tex(tp.GetFloatTexture("texture"));
+	if (!tex) {
+		LOG(LUX_ERROR, LUX_MISSINGDATA) << "No \"texture\" to bake";
+		return NULL;
+	}
+	const string mode = tp.FindOneString("mode", "uv");
+	// Resolution and samples per texel trade exactness for memory and
+	// baking time
+	const int resolution = tp.FindOneInt("resolution",
+		mode == "grid" ? 64 : 1024);
+	const int samples = tp.FindOneInt("samples", 1);
+	if (resolution < 1 || samples < 1) {
+		LOG(LUX_ERROR, LUX_RANGE) << "Invalid bake resolution " <<
+			resolution << " with " << samples << " samples";
+		return NULL;
+	}
+
+	if (mode == "grid") {
+		// Only mappings of positions can be baked
+		const string coords = tp.FindOneString("coordinates", "global");
+		if (coords != "global" && coords != "local") {
+			LOG(LUX_ERROR, LUX_BADTOKEN) << "Unable to bake a grid with '" <<
+				coords << "' coordinates";
+			return NULL;
+		}
+		DensityGridTexture::WrapMode wrapMode =
+			DensityGridTexture::WRAP_CLAMP;
+		const string wrap = tp.FindOneString("wrap", "clamp");
+		if (wrap == "repeat")
+			wrapMode = DensityGridTexture::WRAP_REPEAT;
+		else if (wrap == "black")
+			wrapMode = DensityGridTexture::WRAP_BLACK;
+		else if (wrap == "white")
+			wrapMode = DensityGridTexture::WRAP_WHITE;
+		return new BakedTexture(tex, TextureMapping3D::Create(tex2world,
+			tp), resolution, samples, wrapMode);
+	} else if (mode != "uv") {
+		LOG(LUX_ERROR, LUX_BADTOKEN) << "Unknown bake mode '" << mode <<
+			"', using 'uv' instead";
+	}
+
+	const string sFilterType = tp.FindOneString("filtertype", "bilinear");
+	ImageTextureFilterType filterType = BILINEAR;
+	if (sFilterType == "mipmap_trilinear")
+		filterType = MIPMAP_TRILINEAR;
+	else if (sFilterType == "mipmap_ewa")
+		filterType = MIPMAP_EWA;
+	else if (sFilterType == "nearest")
+		filterType = NEAREST;
+	// MIPMaps resample other resolutions, clamping negative values
+	return new BakedTexture(tex, TextureMapping2D::Create(tex2world, tp),
+		RoundUpPow2(static_cast<u_int>(resolution)), samples, filterType,
+		tp.FindOneFloat("maxanisotropy", 8.f));
+}
+
+static DynamicLoader::RegisterFloatTexture<BakedTexture> r("bake");
@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+// bake.h*
+#include "lux.h"
+#include "texture.h"
+#include "mipmap.h"
+#include "densitygrid.h"
+#include "geometry/raydifferential.h"
+#include "paramset.h"
+
+#include <boost/scoped_ptr.hpp>
+
+namespace lux
+{
+
+// BakedTexture Declarations
+// A float texture rasterized once at a given resolution, lookups replace the
+// evaluation of the whole texture graph. The "uv" mode bakes u,v in [0,1)
+// into a MIPMap, the "grid" mode bakes the unit cube of its 3D mapping
+// into a density grid
+class BakedTexture : public Texture<float> {
+public:
+	// BakedTexture Public Methods
+	BakedTexture(const boost::shared_ptr<Texture<float> > &t,
+		TextureMapping2D *m, u_int resolution, u_int samples,
+		ImageTextureFilterType filterType, float maxAniso);
+	BakedTexture(const boost::shared_ptr<Texture<float> > &t,
+		TextureMapping3D *m, u_int resolution, u_int samples,
+		DensityGridTexture::WrapMode wrapMode);
+	virtual ~BakedTexture() { delete mapping; }
+
+	virtual float Evaluate(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg) const {
+		if (grid)
+			return grid->Evaluate(sw, dg);
+		float s, t;
+		mapping->Map(dg, &s, &t);
+		return mipmap->LookupFloat(CHANNEL_MEAN, s, t);
+	}
+	virtual float Y() const { return mean; }
+	virtual void GetDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		if (grid) {
+			grid->GetDuv(sw, dg, delta, du, dv);
+			return;
+		}
+		float s, t, dsdu, dtdu, dsdv, dtdv;
+		mapping->MapDuv(dg, &s, &t, &dsdu, &dtdu, &dsdv, &dtdv);
+		float ds, dt;
+		mipmap->GetDifferentials(CHANNEL_MEAN, s, t, &ds, &dt);
+		*du = ds * dsdu + dt * dtdu;
+		*dv = ds * dsdv + dt * dtdv;
+	}
+	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
+		*minValue = minV;
+		*maxValue = maxV;
+	}
+
+	static Texture<float> * CreateFloatTexture(const Transform &tex2world, const ParamSet &tp);
+
+private:
+	// BakedTexture Private Methods
+	void BakeRow(u_int t);
+	void BakeSlice(const Transform &textureToWorld, u_int z);
+	float Sample(const Point &p, float u, float v) const;
+	void SetStatistics();
+
+	// BakedTexture Private Data
+	boost::shared_ptr<Texture<float> > tex;
+	u_int resolution, samples;
+	vector<float> values;
+	TextureMapping2D *mapping;
+	boost::scoped_ptr<MIPMap> mipmap;
+	boost::scoped_ptr<DensityGridTexture> grid;
+	float minV, maxV, mean;
+};
+
+}//namespace lux
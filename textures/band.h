@@ -89,10 +89,8 @@ public:
 			offsets.begin();
 		float dua, dva, du1, dv1, du2, dv2;
 		amount->GetDuv(sw, dg, delta, &dua, &dva);
-		tex[p - 1]->GetDuv(sw, dg, delta, &du1, &dv1);
-		tex[p]->GetDuv(sw, dg, delta, &du2, &dv2);
-		float d = tex[p]->EvalFloat(sw, dg) -
-			tex[p - 1]->EvalFloat(sw, dg);
+		const float d = tex[p]->EvalFloatDuv(sw, dg, delta, &du2, &dv2) -
+			tex[p - 1]->EvalFloatDuv(sw, dg, delta, &du1, &dv1);
 		*du = luxrays::Lerp(a, du1, du2) + d * dua;
 		*dv = luxrays::Lerp(a, dv1, dv2) + d * dva;
 	}
@@ -212,13 +212,7 @@ private:
 
 	float CloudNoise(const Point &p, float omegaValue, u_int octaves) const {
 		// Compute sum of octaves of noise
-		float sum = 0.f, lambda = 1.f, o = 1.f;
-		for (u_int i = 0; i < octaves; ++i) {
-			sum += o * Noise(lambda * p);
-			lambda *= 1.99f;
-			o *= omegaValue;
-		}
-		return sum;
+		return FBm(p, omegaValue, octaves);
 	}
 
 	// CloudTexture Private Data
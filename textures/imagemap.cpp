@@ -24,8 +24,14 @@
 #include "imagemap.h"
 #include "dynload.h"
 #include "filedata.h"
+#include "loadprofiler.h"
+#include "osfunc.h"
+#include "texturecache.h"
+#include "context.h"
 #include "geometry/raydifferential.h"
 
+#include <boost/bind.hpp>
+
 using namespace lux;
 
 void NormalMapTexture::GetDuv(const SpectrumWavelengths &sw,
@@ -122,6 +128,7 @@ Texture<float> *ImageFloatTexture::CreateFloatTexture(const Transform &tex2world
 	FileData::decode(tp, "filename");
 	string filename = tp.FindOneString("filename", "");
 	int discardmm = tp.FindOneInt("discardmipmaps", 0);
+	bool compress = tp.FindOneBool("compress", false);
 
 	string channel = tp.FindOneString("channel", "mean");
 	Channel ch;
@@ -143,7 +150,7 @@ Texture<float> *ImageFloatTexture::CreateFloatTexture(const Transform &tex2world
 		ch = CHANNEL_MEAN;
 	}
 
-	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma);
+	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma, compress);
 	ImageFloatTexture *tex = new ImageFloatTexture(texInfo, TextureMapping2D::Create(tex2world, tp), ch);
 
 	return tex;
@@ -185,8 +192,9 @@ Texture<SWCSpectrum> *ImageSpectrumTexture::CreateSWCSpectrumTexture(const Trans
 	FileData::decode(tp, "filename");
 	string filename = tp.FindOneString("filename", "");
 	int discardmm = tp.FindOneInt("discardmipmaps", 0);
+	bool compress = tp.FindOneBool("compress", false);
 
-	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma);
+	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma, compress);
 	ImageSpectrumTexture *tex = new ImageSpectrumTexture(texInfo, TextureMapping2D::Create(tex2world, tp));
 
 	return tex;
@@ -226,14 +234,136 @@ Texture<float> *NormalMapTexture::CreateFloatTexture(const Transform &tex2world,
 	FileData::decode(tp, "filename");
 	string filename = tp.FindOneString("filename", "");
 	int discardmm = tp.FindOneInt("discardmipmaps", 0);
+	bool compress = tp.FindOneBool("compress", false);
 
-	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma);
+	TexInfo texInfo(filterType, filename, discardmm, maxAniso, wrapMode, gain, gamma, compress);
 	NormalMapTexture *tex = new NormalMapTexture(texInfo, TextureMapping2D::Create(tex2world, tp));
 
 	return tex;
 }
 
-map<TexInfo, boost::shared_ptr<MIPMap> > ImageTexture::textures;
+map<TexInfo, boost::shared_ptr<PendingMIPMap> > ImageTexture::textures;
+
+PendingMIPMap::PendingMIPMap(const TexInfo &texInfo) : info(texInfo),
+	cache(Context::GetActiveTextureCache())
+{
+	// Build in a new thread as long as there are idle cores,
+	// otherwise in the calling thread
+	if (osAcquireWorkers(1) > 0)
+		thread.reset(new boost::thread(boost::bind(
+			&PendingMIPMap::BuildThread, this)));
+	else
+		Build();
+}
+
+const boost::shared_ptr<MIPMap> &PendingMIPMap::Get()
+{
+	boost::mutex::scoped_lock lock(threadMutex);
+	if (thread) {
+		thread->join();
+		thread.reset();
+	}
+	return mipmap;
+}
+
+void PendingMIPMap::BuildThread()
+{
+	try {
+		Build();
+	} catch (std::exception &e) {
+		LOG(LUX_SEVERE, LUX_SYSTEM) << "Exception while building imagemap '" <<
+			info.filename << "': " << e.what();
+		mipmap.reset();
+	}
+	osReleaseWorkers(1);
+}
+
+// Float maps are stored with shared exponents when requested or when they
+// are larger than the compression threshold
+static bool IsCompressed(const TexInfo &info, const MIPMap &mipmap,
+	const boost::shared_ptr<TextureCache> &cache)
+{
+	if (cache && !cache->IsCompressionEnabled())
+		return false;
+	const u_int threshold = TextureCache::GetCompressionThreshold();
+	return info.compress || (threshold > 0 &&
+		mipmap.GetTexelMemory() / (1024 * 1024) >= threshold);
+}
+
+void PendingMIPMap::Build()
+{
+	LoadPhase phase("texture.image");
+	const string cacheFile(MIPMapCacheFilename(info.filename,
+		info.filterType, info.wrapMode));
+	boost::shared_ptr<MIPMap> ret;
+	if (!cacheFile.empty()) {
+		ret = boost::shared_ptr<MIPMap>(ReadMIPMapCache(cacheFile,
+			info.filterType, info.maxAniso, info.wrapMode,
+			info.gain, info.gamma, cache));
+		if (ret)
+			LOG(LUX_INFO, LUX_NOERROR) << "Using cached mipmap '" <<
+				cacheFile << "' for imagemap '" << info.filename << "'";
+	}
+	std::auto_ptr<ImageData> imgdata(ret ? NULL : ReadImage(info.filename));
+	if (imgdata.get() != NULL) {
+		ret = boost::shared_ptr<MIPMap>(imgdata->createMIPMap(
+				info.filterType, info.maxAniso, info.wrapMode, info.gain, info.gamma));
+		// Large maps are paged from the stored file rather than
+		// from a copy of their tiles
+		if (ret && !cacheFile.empty() &&
+			WriteMIPMapCache(cacheFile, *imgdata, *ret) &&
+			cache && cache->IsEnabled() &&
+			!IsCompressed(info, *ret, cache) &&
+			ret->GetMemoryUsed() > 4 * TextureCache::slotSize) {
+			MIPMap *mapped = ReadMIPMapCache(cacheFile,
+				info.filterType, info.maxAniso,
+				info.wrapMode, info.gain, info.gamma, cache);
+			if (mapped)
+				ret = boost::shared_ptr<MIPMap>(mapped);
+		}
+	} else if (!ret) {
+		// Create one-valued _MIPMap_
+		TextureColor<float, 1> oneVal(1.f);
+
+		ret = boost::shared_ptr<MIPMap>(new MIPMapFastImpl<TextureColor<float, 1> >(
+				info.filterType, 1, 1, &oneVal));
+	}
+	if (ret) {
+		if (info.discardmm > 0 && (info.filterType == MIPMAP_TRILINEAR ||
+			info.filterType == MIPMAP_EWA)) {
+			ret->DiscardMipmaps(info.discardmm);
+
+			LOG(LUX_INFO, LUX_NOERROR) << "Discarded " <<
+				info.discardmm << " mipmap levels";
+		}
+
+		if (IsCompressed(info, *ret, cache)) {
+			MIPMap *compressed = ret->Compress();
+			if (compressed) {
+				ret = boost::shared_ptr<MIPMap>(compressed);
+				LOG(LUX_INFO, LUX_NOERROR) << "Imagemap '" <<
+					info.filename << "' is stored compressed";
+			}
+		}
+
+		// Large maps are paged in tiles under the texture cache budget
+		if (ret->GetMemoryUsed() > 4 * TextureCache::slotSize &&
+			ret->MoveToTextureCache(cache))
+			LOG(LUX_INFO, LUX_NOERROR) << "Imagemap '" <<
+				info.filename << "' is paged by the texture cache";
+
+		LOG(LUX_INFO, LUX_NOERROR) << "Memory used for imagemap '" <<
+			info.filename << "': " << (ret->GetMemoryUsed() / 1024) <<
+			"KBytes";
+		phase.SetMemory(ret->GetMemoryUsed());
+
+		mipmap = ret;
+		return;
+	}
+	LOG(LUX_ERROR, LUX_SYSTEM) << "Creation of imagemap '" << info.filename <<
+		"' failed";
+}
+
 
 static DynamicLoader::RegisterFloatTexture<ImageFloatTexture> r1("imagemap");
 static DynamicLoader::RegisterSWCSpectrumTexture<ImageSpectrumTexture> r2("imagemap");
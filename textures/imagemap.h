@@ -30,7 +30,11 @@ using luxrays::RGBIllumSPD;
 #include "imagereader.h"
 #include "paramset.h"
 #include "error.h"
+#include "context.h"
 #include <map>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 using std::map;
 
 // TODO - radiance - add methods for Power and Illuminant propagation
@@ -41,9 +45,10 @@ namespace lux
 class TexInfo {
 public:
 	TexInfo(ImageTextureFilterType type, const string &f, int dm,
-		float ma, ImageWrap wm, float ga, float gam) :
+		float ma, ImageWrap wm, float ga, float gam, bool c) :
 		filterType(type), filename(f), discardmm(dm),
-		maxAniso(ma), wrapMode(wm), gain(ga), gamma(gam) { }
+		maxAniso(ma), wrapMode(wm), gain(ga), gamma(gam),
+		compress(c) { }
 
 	ImageTextureFilterType filterType;
 	string filename;
@@ -52,6 +57,8 @@ public:
 	ImageWrap wrapMode;
 	float gain;
 	float gamma;
+	// Store float maps with shared exponents
+	bool compress;
 
 	bool operator<(const TexInfo &t2) const {
 		if (filterType != t2.filterType)
@@ -66,23 +73,48 @@ public:
 			return wrapMode < t2.wrapMode;
 		if (gain != t2.gain)
 			return gain < t2.gain;
-		return gamma < t2.gamma;
+		if (gamma != t2.gamma)
+			return gamma < t2.gamma;
+		return compress < t2.compress;
 	}
 };
 
+// A MIPMap built in a background thread while the scene is parsed, image
+// maps declared one after the other are decoded and built concurrently
+class PendingMIPMap {
+public:
+	PendingMIPMap(const TexInfo &texInfo);
+	~PendingMIPMap() { Get(); }
+
+	// Waits for the MIPMap to be built, NULL if it couldn't be
+	const boost::shared_ptr<MIPMap> &Get();
+
+private:
+	void Build();
+	void BuildThread();
+
+	TexInfo info;
+	boost::shared_ptr<TextureCache> cache;
+	boost::shared_ptr<MIPMap> mipmap;
+	boost::mutex threadMutex;
+	boost::scoped_ptr<boost::thread> thread;
+};
+
 class ImageTexture {
 public:
 	// ImageTexture Public Methods
 	ImageTexture(const TexInfo &texInfo, TextureMapping2D *m) : info(texInfo) {
 		mapping = m;
-		mipmap = GetTexture(info);
+		pending = GetTexture(info);
 	}
 	virtual ~ImageTexture() {
 		// If the map isn't used anymore, remove it from the cache
 		// The last user still has 2 references:
 		// 1 from the texture and 1 from the dictionary
-		for (map<TexInfo, boost::shared_ptr<MIPMap> >::iterator t = textures.begin(); t != textures.end(); ++t) {
-			if ((*t).second.get() == mipmap.get() &&
+		// In animation mode the context holds one more reference
+		// to keep the map for the next scenes
+		for (map<TexInfo, boost::shared_ptr<PendingMIPMap> >::iterator t = textures.begin(); t != textures.end(); ++t) {
+			if ((*t).second == pending &&
 				(*t).second.use_count() == 2) {
 				textures.erase(t);
 				break;
@@ -91,18 +123,35 @@ public:
 		delete mapping;
 	}
 
-	const MIPMap *GetMIPMap() const { return mipmap.get(); }
+	const MIPMap *GetMIPMap() const { return pending->Get().get(); }
 	const TextureMapping2D *GetTextureMapping2D() const { return mapping; }
 	const TexInfo &GetInfo() const { return info; }
 
+	// Removes the maps only referenced by the dictionary
+	static void ReleaseUnused() {
+		for (map<TexInfo, boost::shared_ptr<PendingMIPMap> >::iterator t = textures.begin(); t != textures.end();) {
+			if ((*t).second.use_count() == 1)
+				textures.erase(t++);
+			else
+				++t;
+		}
+	}
+
 private:
-	static map<TexInfo, boost::shared_ptr<MIPMap> > textures;
+	static map<TexInfo, boost::shared_ptr<PendingMIPMap> > textures;
 
 	// ImageTexture Private Methods
-	static boost::shared_ptr<MIPMap> GetTexture(const TexInfo &texInfo);
+	static boost::shared_ptr<PendingMIPMap> GetTexture(const TexInfo &texInfo);
 
 protected:
+	// Lookups use mipmap, which is set once the texture is resolved
+	void ResolveMIPMap() {
+		if (!mipmap)
+			mipmap = pending->Get();
+	}
+
 	// ImageTexture Protected Data
+	boost::shared_ptr<PendingMIPMap> pending;
 	boost::shared_ptr<MIPMap> mipmap;
 	TextureMapping2D *mapping;
 	TexInfo info;
@@ -125,8 +174,9 @@ public:
 		return mipmap->LookupFloat(channel, s, t);
 	}
 	virtual float Y() const {
-		return mipmap->LookupFloat(channel, .5f, .5f, .5f);
+		return GetMIPMap()->LookupFloat(channel, .5f, .5f, .5f);
 	}
+	virtual void Resolve() { ResolveMIPMap(); }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
@@ -139,7 +189,7 @@ public:
 	}
 
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
-		mipmap->GetMinMaxFloat(channel, minValue, maxValue);
+		GetMIPMap()->GetMinMaxFloat(channel, minValue, maxValue);
 	}
 
 	Channel GetChannel() const { return channel; }
@@ -171,12 +221,13 @@ public:
 	}
 	virtual float Y() const {
 		return (isIlluminant ? whiteRGBIllum.Y() : 1.f) * 
-			mipmap->LookupFloat(CHANNEL_WMEAN, .5f, .5f, .5f);
+			GetMIPMap()->LookupFloat(CHANNEL_WMEAN, .5f, .5f, .5f);
 	}
 	virtual float Filter() const {
 		return (isIlluminant ? whiteRGBIllum.Filter() : 1.f) *
-			mipmap->LookupFloat(CHANNEL_MEAN, .5f, .5f, .5f);
+			GetMIPMap()->LookupFloat(CHANNEL_MEAN, .5f, .5f, .5f);
 	}
+	virtual void Resolve() { ResolveMIPMap(); }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
@@ -215,6 +266,7 @@ public:
 	virtual float Y() const {
 		return 0.f;
 	}
+	virtual void Resolve() { ResolveMIPMap(); }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const;
@@ -231,45 +283,18 @@ private:
 };
 
 // ImageTexture Method Definitions
-inline boost::shared_ptr<MIPMap> ImageTexture::GetTexture(const TexInfo &texInfo) {
+inline boost::shared_ptr<PendingMIPMap> ImageTexture::GetTexture(const TexInfo &texInfo) {
 	// Look for texture in texture cache
 	if (textures.find(texInfo) != textures.end()) {
 		LOG(LUX_INFO, LUX_NOERROR) << "Reusing data for imagemap '" <<
 			texInfo.filename << "'";
+		Context::KeepActiveMIPMap(textures[texInfo]);
 		return textures[texInfo];
 	}
-	std::auto_ptr<ImageData> imgdata(ReadImage(texInfo.filename));
-	boost::shared_ptr<MIPMap> ret;
-	if (imgdata.get() != NULL) {
-		ret = boost::shared_ptr<MIPMap>(imgdata->createMIPMap(
-				texInfo.filterType, texInfo.maxAniso, texInfo.wrapMode, texInfo.gain, texInfo.gamma));
-	} else {
-		// Create one-valued _MIPMap_
-		TextureColor<float, 1> oneVal(1.f);
-
-		ret = boost::shared_ptr<MIPMap>(new MIPMapFastImpl<TextureColor<float, 1> >(
-				texInfo.filterType, 1, 1, &oneVal));
-	}
-	if (ret) {
-		if (texInfo.discardmm > 0 && (texInfo.filterType == MIPMAP_TRILINEAR ||
-			texInfo.filterType == MIPMAP_EWA)) {
-			ret->DiscardMipmaps(texInfo.discardmm);
-
-			LOG(LUX_INFO, LUX_NOERROR) << "Discarded " <<
-				texInfo.discardmm << " mipmap levels";
-		}
-
-		LOG(LUX_INFO, LUX_NOERROR) << "Memory used for imagemap '" <<
-			texInfo.filename << "': " << (ret->GetMemoryUsed() / 1024) <<
-			"KBytes";
-
-		textures[texInfo] = ret;
-		return textures[texInfo];
-	}
-	LOG(LUX_ERROR, LUX_SYSTEM) << "Creation of imagemap '" << texInfo.filename <<
-		"' failed";
-
-	return boost::shared_ptr<MIPMap>();
+	boost::shared_ptr<PendingMIPMap> ret(new PendingMIPMap(texInfo));
+	textures[texInfo] = ret;
+	Context::KeepActiveMIPMap(ret);
+	return ret;
 }
 
 }//namespace lux
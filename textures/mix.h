@@ -53,17 +53,20 @@ public:
 	virtual float Filter() const { return luxrays::Lerp(amount->Y(), tex1->Filter(),
 		tex2->Filter()); }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		this->EvalFloatDuv(sw, dg, delta, du, dv);
+	}
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
 		float dua, dva, du1, dv1, du2, dv2;
-		amount->GetDuv(sw, dg, delta, &dua, &dva);
-		tex1->GetDuv(sw, dg, delta, &du1, &dv1);
-		tex2->GetDuv(sw, dg, delta, &du2, &dv2);
-		float a = amount->Evaluate(sw, dg);
-		float d = tex2->EvalFloat(sw, dg) -
-			tex1->EvalFloat(sw, dg);
-		*du = luxrays::Lerp(a, du1, du2) + d * dua;
-		*dv = luxrays::Lerp(a, dv1, dv2) + d * dva;
+		const float a = amount->EvalFloatDuv(sw, dg, delta, &dua, &dva);
+		const float t1 = tex1->EvalFloatDuv(sw, dg, delta, &du1, &dv1);
+		const float t2 = tex2->EvalFloatDuv(sw, dg, delta, &du2, &dv2);
+		*du = luxrays::Lerp(a, du1, du2) + (t2 - t1) * dua;
+		*dv = luxrays::Lerp(a, dv1, dv2) + (t2 - t1) * dva;
+		return luxrays::Lerp(a, t1, t2);
 	}
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
 		float mina, min1, min2;
@@ -53,15 +53,19 @@ public:
 	virtual float Y() const { return tex1->Filter() * tex2->Y(); }
 	virtual float Filter() const { return tex1->Filter() * tex2->Filter(); }
 	virtual void GetDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		this->EvalFloatDuv(sw, dg, delta, du, dv);
+	}
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
 		float du1, dv1, du2, dv2;
-		tex1->GetDuv(sw, dg, delta, &du1, &dv1);
-		tex2->GetDuv(sw, dg, delta, &du2, &dv2);
-		float t1 = tex1->EvalFloat(sw, dg);
-		float t2 = tex2->EvalFloat(sw, dg);
+		const float t1 = tex1->EvalFloatDuv(sw, dg, delta, &du1, &dv1);
+		const float t2 = tex2->EvalFloatDuv(sw, dg, delta, &du2, &dv2);
 		*du = t1 * du2 + t2 * du1;
 		*dv = t1 * dv2 + t2 * dv1;
+		return t1 * t2;
 	}
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
 		float min1, min2;
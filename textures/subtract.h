@@ -64,13 +64,19 @@ public:
 	}
 	
 	virtual void GetDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		this->EvalFloatDuv(sw, dg, delta, du, dv);
+	}
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
 		float du1, dv1, du2, dv2;
-		tex1->GetDuv(sw, dg, delta, &du1, &dv1);
-		tex2->GetDuv(sw, dg, delta, &du2, &dv2);
+		const float t1 = tex1->EvalFloatDuv(sw, dg, delta, &du1, &dv1);
+		const float t2 = tex2->EvalFloatDuv(sw, dg, delta, &du2, &dv2);
 		*du = du1 - du2;
 		*dv = dv1 - dv2;
+		return t1 - t2;
 	}
 	
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
@@ -50,30 +50,24 @@ public:
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
-		//FIXME: Generic derivative computation, replace with exact
-		DifferentialGeometry dgTemp = dg;
-		// Calculate bump map value at intersection point
-		const float base = Evaluate(sw, dg);
-
-		// Compute offset positions and evaluate displacement texture
-		const Point origP(dgTemp.p);
-		const Normal origN(dgTemp.nn);
-		const float origU = dgTemp.u;
-
-		// Shift _dgTemp_ _du_ in the $u$ direction and calculate value
-		const float uu = delta / dgTemp.dpdu.Length();
-		dgTemp.p += uu * dgTemp.dpdu;
-		dgTemp.u += uu;
-		dgTemp.nn = Normalize(origN + uu * dgTemp.dndu);
-		*du = (Evaluate(sw, dgTemp) - base) / uu;
-
-		// Shift _dgTemp_ _dv_ in the $v$ direction and calculate value
-		const float vv = delta / dgTemp.dpdv.Length();
-		dgTemp.p = origP + vv * dgTemp.dpdv;
-		dgTemp.u = origU;
-		dgTemp.v += vv;
-		dgTemp.nn = Normalize(origN + vv * dgTemp.dndv);
-		*dv = (Evaluate(sw, dgTemp) - base) / vv;
+		EvalFloatDuv(sw, dg, delta, du, dv);
+	}
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		// Analytic gradient of the noise
+		Vector dpdu, dpdv;
+		const Point P(mapping->MapDuv(dg, &dpdu, &dpdv));
+		Vector dWdP, dHdP;
+		const float windStrength = FBm(.1f * P, .5f, 3, &dWdP);
+		const float waveHeight = FBm(P, .5f, 6, &dHdP);
+		// The wind strength varies at a tenth of the wave frequency
+		const float sign = windStrength < 0.f ? -.1f : .1f;
+		const Vector dVdP(sign * waveHeight * dWdP +
+			fabsf(windStrength) * dHdP);
+		*du = Dot(dVdP, dpdu);
+		*dv = Dot(dVdP, dpdv);
+		return fabsf(windStrength) * waveHeight;
 	}
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
 		// FBm is computed as a geometric series Sum(Ar^k) with A ~ [-1, 1]
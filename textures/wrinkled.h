@@ -52,30 +52,19 @@ public:
 	virtual void GetDuv(const SpectrumWavelengths &sw,
 		const DifferentialGeometry &dg, float delta,
 		float *du, float *dv) const {
-		//FIXME: Generic derivative computation, replace with exact
-		DifferentialGeometry dgTemp = dg;
-		// Calculate bump map value at intersection point
-		const float base = Evaluate(sw, dg);
-
-		// Compute offset positions and evaluate displacement texture
-		const Point origP(dgTemp.p);
-		const Normal origN(dgTemp.nn);
-		const float origU = dgTemp.u;
-
-		// Shift _dgTemp_ _du_ in the $u$ direction and calculate value
-		const float uu = delta / dgTemp.dpdu.Length();
-		dgTemp.p += uu * dgTemp.dpdu;
-		dgTemp.u += uu;
-		dgTemp.nn = Normalize(origN + uu * dgTemp.dndu);
-		*du = (Evaluate(sw, dgTemp) - base) / uu;
-
-		// Shift _dgTemp_ _dv_ in the $v$ direction and calculate value
-		const float vv = delta / dgTemp.dpdv.Length();
-		dgTemp.p = origP + vv * dgTemp.dpdv;
-		dgTemp.u = origU;
-		dgTemp.v += vv;
-		dgTemp.nn = Normalize(origN + vv * dgTemp.dndv);
-		*dv = (Evaluate(sw, dgTemp) - base) / vv;
+		EvalFloatDuv(sw, dg, delta, du, dv);
+	}
+	virtual float EvalFloatDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		// Analytic gradient of the noise
+		Vector dpdu, dpdv;
+		const Point P(mapping->MapDuv(dg, &dpdu, &dpdv));
+		Vector dTdP;
+		const float value = Turbulence(P, omega, octaves, &dTdP);
+		*du = Dot(dTdP, dpdu);
+		*dv = Dot(dTdP, dpdv);
+		return value;
 	}
 	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
 		// Turbulence is computed as a geometric series Sum(|A|r^k) with A ~ [-1, 1]
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+// Builds the mipmaps of image maps ahead of rendering, in the directory
+// used by the texture cache (see the texturecachedir option of luxconsole)
+
+#include <string>
+#include <memory>
+#include <exception>
+#include <iostream>
+
+#include "api.h"
+#include "imagereader.h"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+
+using namespace lux;
+namespace po = boost::program_options;
+
+static bool IsImageFile(const boost::filesystem::path &path) {
+	static const char *extensions[] = { ".bmp", ".dds", ".exr", ".gif",
+		".hdr", ".jpeg", ".jpg", ".pfm", ".png", ".ppm", ".psd", ".tga",
+		".tif", ".tiff", NULL };
+	const string extension(boost::algorithm::to_lower_copy(path.extension().string()));
+	for (u_int i = 0; extensions[i]; ++i) {
+		if (extension == extensions[i])
+			return true;
+	}
+	return false;
+}
+
+static bool BakeImage(const string &filename, ImageTextureFilterType filterType,
+	ImageWrap wrapMode, bool force) {
+	const string cacheFile(MIPMapCacheFilename(filename, filterType, wrapMode));
+	if (cacheFile.empty()) {
+		LOG(LUX_ERROR,LUX_NOFILE) << "Unable to open image file '" << filename << "'";
+		return false;
+	}
+	if (!force && boost::filesystem::exists(cacheFile)) {
+		LOG(LUX_INFO,LUX_NOERROR) << "Image file '" << filename << "' is already in '" << cacheFile << "'";
+		return true;
+	}
+
+	std::auto_ptr<ImageData> imgdata(ReadImage(filename));
+	if (!imgdata.get())
+		return false;
+	// Gain, gamma and anisotropy don't change the stored texels
+	boost::scoped_ptr<MIPMap> mipmap(imgdata->createMIPMap(filterType, 8.f, wrapMode));
+	return mipmap && WriteMIPMapCache(cacheFile, *imgdata, *mipmap);
+}
+
+int main(int ac, char *av[]) {
+
+	try {
+		// Declare a group of options that will be
+		// allowed only on command line
+		po::options_description generic("Generic options");
+		generic.add_options()
+				("version,v", "Print version string")
+				("help,h", "Produce help message")
+				("output,o", po::value< std::string >()->default_value("."), "Texture cache directory")
+				("filtertype,f", po::value< std::string >()->default_value("mipmap_ewa"), "Filter type of the image maps: nearest, bilinear, mipmap_trilinear or mipmap_ewa")
+				("wrap,w", po::value< std::string >()->default_value("repeat"), "Wrap mode of the image maps: repeat, black, white or clamp")
+				("recursive,r", "Also process the subdirectories of the given directories")
+				("force,F", "Rebuild the mipmaps already in the cache")
+				("verbose,V", "Increase output verbosity (show DEBUG messages)")
+				("quiet,q", "Reduce output verbosity (hide INFO messages)")
+				;
+
+		// Hidden options, will be allowed both on command line and
+		// in config file, but will not be shown to the user.
+		po::options_description hidden("Hidden options");
+		hidden.add_options()
+				("input-file", po::value< vector<string> >(), "input file")
+				;
+
+		po::options_description cmdline_options;
+		cmdline_options.add(generic).add(hidden);
+
+		po::options_description visible("Allowed options");
+		visible.add(generic);
+
+		po::positional_options_description p;
+
+		p.add("input-file", -1);
+
+		po::variables_map vm;
+		store(po::command_line_parser(ac, av).
+				options(cmdline_options).positional(p).run(), vm);
+
+		if (vm.count("help")) {
+			LOG( LUX_ERROR,LUX_SYSTEM) << "Usage: luxmipmap [options] file|directory...\n" << visible;
+			return 0;
+		}
+
+		LOG(LUX_INFO,LUX_NOERROR) << "Lux version " << luxVersion() << " of " << __DATE__ << " at " << __TIME__;
+		if (vm.count("version"))
+			return 0;
+
+		if (vm.count("verbose")) {
+			luxErrorFilter(LUX_DEBUG);
+		}
+
+		if (vm.count("quiet")) {
+			luxErrorFilter(LUX_WARNING);
+		}
+
+		const string sFilterType = vm["filtertype"].as<string>();
+		ImageTextureFilterType filterType = BILINEAR;
+		if (sFilterType == "nearest")
+			filterType = NEAREST;
+		else if (sFilterType == "mipmap_trilinear")
+			filterType = MIPMAP_TRILINEAR;
+		else if (sFilterType == "mipmap_ewa")
+			filterType = MIPMAP_EWA;
+		else if (sFilterType != "bilinear") {
+			LOG( LUX_ERROR,LUX_BADTOKEN) << "Unknown filter type '" << sFilterType << "'";
+			return 1;
+		}
+
+		const string wrap = vm["wrap"].as<string>();
+		ImageWrap wrapMode = TEXTURE_REPEAT;
+		if (wrap == "black")
+			wrapMode = TEXTURE_BLACK;
+		else if (wrap == "white")
+			wrapMode = TEXTURE_WHITE;
+		else if (wrap == "clamp")
+			wrapMode = TEXTURE_CLAMP;
+		else if (wrap != "repeat") {
+			LOG( LUX_ERROR,LUX_BADTOKEN) << "Unknown wrap mode '" << wrap << "'";
+			return 1;
+		}
+
+		if (!vm.count("input-file")) {
+			LOG( LUX_ERROR,LUX_SYSTEM) << "luxmipmap: no input file";
+			return 1;
+		}
+
+		luxInit();
+
+		const string outputDir = vm["output"].as<string>();
+		luxSetStringAttribute("texture_cache", "directory", outputDir.c_str());
+		if (TextureCache::GetDirectory() != outputDir) {
+			luxCleanup();
+			return 2;
+		}
+
+		const bool force = vm.count("force") > 0;
+		u_int bakedCount = 0, failedCount = 0;
+		const std::vector<std::string> &v = vm["input-file"].as < vector<string> > ();
+		for (unsigned int i = 0; i < v.size(); i++) {
+			const boost::filesystem::path path(v[i]);
+			if (!boost::filesystem::is_directory(path)) {
+				if (BakeImage(path.string(), filterType, wrapMode, force))
+					++bakedCount;
+				else
+					++failedCount;
+				continue;
+			}
+
+			// Only files with an image extension are taken from directories
+			vector<boost::filesystem::path> files;
+			if (vm.count("recursive")) {
+				for (boost::filesystem::recursive_directory_iterator it(path), end; it != end; ++it) {
+					if (boost::filesystem::is_regular_file(it->status()) && IsImageFile(it->path()))
+						files.push_back(it->path());
+				}
+			} else {
+				for (boost::filesystem::directory_iterator it(path), end; it != end; ++it) {
+					if (boost::filesystem::is_regular_file(it->status()) && IsImageFile(it->path()))
+						files.push_back(it->path());
+				}
+			}
+			for (size_t j = 0; j < files.size(); ++j) {
+				if (BakeImage(files[j].string(), filterType, wrapMode, force))
+					++bakedCount;
+				else
+					++failedCount;
+			}
+		}
+
+		luxCleanup();
+
+		LOG( LUX_INFO,LUX_NOERROR) << bakedCount << " image files in '" << outputDir << "', " << failedCount << " failed";
+		if (failedCount > 0)
+			return 2;
+	} catch (std::exception & e) {
+		LOG( LUX_SEVERE,LUX_SYNTAX)
+			<< "Command line argument parsing failed with error '" << e.what()
+			<< "', please use the --help option to view the allowed syntax.";
+		return 1;
+	}
+	return 0;
+}